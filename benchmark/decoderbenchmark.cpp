@@ -0,0 +1,108 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+// Throughput of the decoder of the terminal input (detail::KeyDecoder)
+// on some typical mixes of keys.
+// Usage: decoderbenchmark [megabytes per mix]
+
+#include <cli/detail/keydecoder.h>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace cli::detail;
+using namespace std;
+
+namespace
+{
+
+struct Mix
+{
+    const char* name;
+    vector<string> keys;
+};
+
+// builds an input of about size bytes choosing pseudo-randomly among keys
+string Generate(const vector<string>& keys, size_t size)
+{
+    string input;
+    input.reserve(size + 16);
+    unsigned seed = 42;
+    while (input.size() < size)
+    {
+        seed = seed * 1103515245u + 12345u;
+        input += keys[(seed >> 16) % keys.size()];
+    }
+    return input;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    const size_t megabytes = argc > 1 ? static_cast<size_t>(atoi(argv[1])) : 64;
+    const size_t size = megabytes * 1024 * 1024;
+    const size_t burst = 4096; // bytes received at once
+
+    const vector<Mix> mixes = {
+        {"typing", {"a", "b", "c", "d", "e", " ", "1", "2", "-", "\r\n"}},
+        {"telnet enter", {"show\r", string("\r\0", 2), "ls\r\n"}},
+        {"cursor keys", {"\x1B[A", "\x1B[B", "\x1B[C", "\x1B[D", "\x1B[H", "\x1B[F", "\x1B[3~", "x"}},
+        {"modifiers", {"\x1B[1;5C", "\x1B[1;5D", "\x1B[1;2A", "\x1B[3;5~", "y"}},
+        {"function keys", {"\x1BOP", "\x1B[15~", "\x1B[24~", "\x1B[99;1Z", "z"}},
+    };
+
+    cout << left << setw(16) << "mix" << right << setw(12) << "MB/s" << setw(16) << "Mkeys/s" << '\n';
+    for (const auto& mix: mixes)
+    {
+        const auto input = Generate(mix.keys, size);
+        KeyDecoder decoder;
+        size_t keys = 0;
+        size_t checksum = 0;
+        const auto start = chrono::steady_clock::now();
+        for (size_t pos = 0; pos < input.size(); pos += burst)
+        {
+            const auto n = min(burst, input.size() - pos);
+            decoder.Decode(input.data() + pos, n, [&](const KeyDecoder::Key& k)
+            {
+                ++keys;
+                checksum += static_cast<size_t>(k.first) + static_cast<unsigned char>(k.second);
+            });
+        }
+        const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        cout << left << setw(16) << mix.name << right << fixed << setprecision(1)
+             << setw(12) << (input.size() / 1048576.0) / elapsed.count()
+             << setw(16) << (keys / 1e6) / elapsed.count()
+             << "   (checksum " << checksum << ")\n";
+    }
+    return 0;
+}
@@ -0,0 +1,204 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+// Writes and latency of the output of the telnet sessions with the
+// different socket options (see CliTelnetServer::SetTcpOptions),
+// measured by a client on the loopback interface, and the throughput
+// of many clients at the same time.
+// The program is built twice: telnetbenchmark uses the asio sockets and
+// telnetbenchmark_uring (linux only) defines CLI_USE_IO_URING.
+// Usage: telnetbenchmark [commands per configuration] [first port] [clients]
+
+#include <cli/cli.h>
+#include <cli/remotecli.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace cli;
+using namespace std;
+using boost::asio::ip::tcp;
+
+namespace
+{
+
+// counts the writes on the sockets of the sessions
+class SendCounter : public Tracer
+{
+public:
+    void Begin(TraceStage stage, size_t, const string&) override
+    {
+        if (stage == TraceStage::send) ++sends;
+    }
+    void End(TraceStage, size_t, const string&) override {}
+    atomic<size_t> sends{0};
+};
+
+// reads until the prompt, returning the number of reads
+size_t ReadPrompt(tcp::socket& socket)
+{
+    static const string prompt = "cli> ";
+    string received;
+    char buffer[4096];
+    size_t reads = 0;
+    while (received.size() < prompt.size() || received.compare(received.size() - prompt.size(), prompt.size(), prompt) != 0)
+    {
+        const auto n = socket.read_some(boost::asio::buffer(buffer));
+        received.append(buffer, n);
+        ++reads;
+    }
+    return reads;
+}
+
+struct Config
+{
+    const char* name;
+    TcpOptions options;
+};
+
+// sends the command and waits for the prompt
+void Run(tcp::socket& client, size_t commands)
+{
+    for (size_t i = 0; i < commands; ++i)
+    {
+        boost::asio::write(client, boost::asio::buffer(string("dump\r\n")));
+        ReadPrompt(client);
+    }
+}
+
+TcpOptions Options(bool noDelay, bool batchOutput)
+{
+    TcpOptions o;
+    o.noDelay = noDelay;
+    o.batchOutput = batchOutput;
+    return o;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    const size_t commands = argc > 1 ? static_cast<size_t>(atoi(argv[1])) : 200;
+    unsigned short port = argc > 2 ? static_cast<unsigned short>(atoi(argv[2])) : 5123;
+    const size_t clients = argc > 3 ? static_cast<size_t>(atoi(argv[3])) : 32;
+
+    auto rootMenu = make_unique<Menu>("cli");
+    // an output of 100 lines written piece by piece
+    rootMenu->Insert("dump", [](ostream& out)
+    {
+        for (int i = 0; i < 100; ++i)
+            out << "line " << i << ": " << string(40, 'x') << '\n';
+    });
+    Cli cli(move(rootMenu));
+    auto counter = make_shared<SendCounter>();
+    cli.SetTracer(counter);
+
+    const vector<Config> configs = {
+        {"nagle", Options(false, false)},
+        {"nodelay", Options(true, false)},
+        {"nagle+batch", Options(false, true)},
+        {"nodelay+batch", Options(true, true)},
+    };
+
+    bool ioUring = false;
+    cout << left << setw(16) << "options" << right
+         << setw(14) << "writes/cmd" << setw(14) << "reads/cmd"
+         << setw(14) << "median(us)" << setw(14) << "max(us)" << '\n';
+    for (const auto& config: configs)
+    {
+        boost::asio::io_context ios;
+        CliTelnetServer server(ios, "127.0.0.1", port, cli);
+        server.SetTcpOptions(config.options);
+        ioUring = server.UsesIoUring();
+        thread serverThread([&ios](){ ios.run(); });
+
+        tcp::socket client(ios);
+        client.connect(tcp::endpoint(boost::asio::ip::address_v4::loopback(), port++));
+        client.set_option(tcp::no_delay(true));
+        ReadPrompt(client);
+
+        counter->sends = 0;
+        size_t reads = 0;
+        vector<double> latencies;
+        for (size_t i = 0; i < commands; ++i)
+        {
+            const auto start = chrono::steady_clock::now();
+            boost::asio::write(client, boost::asio::buffer(string("dump\r\n")));
+            reads += ReadPrompt(client);
+            latencies.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+        }
+        sort(latencies.begin(), latencies.end());
+
+        cout << left << setw(16) << config.name << right << fixed << setprecision(1)
+             << setw(14) << static_cast<double>(counter->sends) / commands
+             << setw(14) << static_cast<double>(reads) / commands
+             << setw(14) << latencies[latencies.size() / 2]
+             << setw(14) << latencies.back() << '\n';
+
+        client.close();
+        ios.stop();
+        serverThread.join();
+    }
+
+    // the clients send the commands at the same time
+    {
+        boost::asio::io_context ios;
+        CliTelnetServer server(ios, "127.0.0.1", port, cli);
+        thread serverThread([&ios](){ ios.run(); });
+
+        vector<thread> threads;
+        const auto start = chrono::steady_clock::now();
+        for (size_t c = 0; c < clients; ++c)
+            threads.emplace_back([port, commands]()
+            {
+                boost::asio::io_context clientIos;
+                tcp::socket client(clientIos);
+                client.connect(tcp::endpoint(boost::asio::ip::address_v4::loopback(), port));
+                client.set_option(tcp::no_delay(true));
+                ReadPrompt(client);
+                Run(client, commands);
+            });
+        for (auto& t: threads)
+            t.join();
+        const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+        cout << '\n' << clients << " clients: " << fixed << setprecision(0)
+             << static_cast<double>(clients * commands) / elapsed.count() << " commands/s\n";
+        ios.stop();
+        serverThread.join();
+    }
+    cout << "backend: " << (ioUring ? "io_uring" : "asio") << '\n';
+    return 0;
+}
@@ -0,0 +1,140 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+// Cost of scheduling and moving one timer per session with the timing
+// wheel (detail::TimingWheel) and with an asio steady_timer per session.
+// Usage: timerbenchmark [sessions]
+
+#include <cli/detail/timingwheel.h>
+#include <boost/asio.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using namespace cli::detail;
+using namespace std;
+
+namespace
+{
+
+// pseudo-random delays from 1 to 60000 ticks (10 minutes at 10ms)
+vector<uint64_t> Delays(size_t n)
+{
+    vector<uint64_t> delays(n);
+    unsigned seed = 42;
+    for (auto& d: delays)
+    {
+        seed = seed * 1103515245u + 12345u;
+        d = 1 + (seed >> 8) % 60000;
+    }
+    return delays;
+}
+
+template <typename F>
+double NsPerOp(size_t ops, F&& f)
+{
+    const auto start = chrono::steady_clock::now();
+    f();
+    const chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+    return elapsed.count() / static_cast<double>(ops);
+}
+
+void Print(const char* name, double schedule, double move, double expire)
+{
+    cout << left << setw(16) << name << right << fixed << setprecision(1)
+         << setw(14) << schedule << setw(14) << move << setw(14) << expire << '\n';
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    const size_t sessions = argc > 1 ? static_cast<size_t>(atoi(argv[1])) : 100000;
+    const auto delays = Delays(sessions);
+    size_t fired = 0;
+
+    cout << "ns per timer, " << sessions << " sessions\n";
+    cout << left << setw(16) << "timers" << right
+         << setw(14) << "schedule" << setw(14) << "move" << setw(14) << "expire" << '\n';
+
+    {
+        TimingWheel wheel;
+        vector<TimingWheel::Id> ids(sessions);
+        const auto schedule = NsPerOp(sessions, [&]()
+        {
+            for (size_t i = 0; i < sessions; ++i)
+                ids[i] = wheel.Add(delays[i], [&fired](){ ++fired; });
+        });
+        // e.g. an idle timeout moved by the input of the session
+        const auto move = NsPerOp(sessions, [&]()
+        {
+            for (size_t i = 0; i < sessions; ++i)
+            {
+                wheel.Cancel(ids[i]);
+                ids[i] = wheel.Add(delays[sessions - 1 - i], [&fired](){ ++fired; });
+            }
+        });
+        const auto expire = NsPerOp(sessions, [&](){ wheel.Advance(60001); });
+        Print("timing wheel", schedule, move, expire);
+    }
+
+    {
+        // the asio timers are not waited for: they're cancelled at the end
+        boost::asio::io_context ios;
+        vector<unique_ptr<boost::asio::steady_timer>> timers;
+        timers.reserve(sessions);
+        const auto tick = chrono::milliseconds(10);
+        const auto schedule = NsPerOp(sessions, [&]()
+        {
+            for (size_t i = 0; i < sessions; ++i)
+            {
+                timers.push_back(make_unique<boost::asio::steady_timer>(ios, tick * static_cast<long>(delays[i])));
+                timers.back()->async_wait([&fired](const boost::system::error_code& ec){ if (!ec) ++fired; });
+            }
+        });
+        const auto move = NsPerOp(sessions, [&]()
+        {
+            for (size_t i = 0; i < sessions; ++i)
+            {
+                timers[i]->expires_after(tick * static_cast<long>(delays[sessions - 1 - i]));
+                timers[i]->async_wait([&fired](const boost::system::error_code& ec){ if (!ec) ++fired; });
+            }
+        });
+        for (auto& t: timers)
+            t->cancel();
+        ios.run();
+        Print("asio timers", schedule, move, 0.0);
+    }
+
+    cout << "(fired " << fired << ")\n";
+    return 0;
+}
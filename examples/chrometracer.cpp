@@ -0,0 +1,153 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#include <cli/clilocalsession.h> // include boost asio
+#include <cli/remotecli.h>
+// TODO. NB: remotecli.h and clilocalsession.h both includes boost asio,
+// so in Windows it should appear before cli.h that include rang
+// (consider to provide a global header file for the library)
+#include <cli/cli.h>
+#include <cli/tracer.h>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+using namespace cli;
+using namespace std;
+
+// A tracer that writes the stages of the commands in the Chrome trace event format.
+// Open the resulting file with chrome://tracing (or https://ui.perfetto.dev):
+// each session is shown as a separate thread.
+class ChromeTracer : public Tracer
+{
+public:
+    explicit ChromeTracer(const string& fileName) :
+        file(fileName),
+        start(chrono::steady_clock::now())
+    {
+        file << "[\n";
+    }
+    ~ChromeTracer() override
+    {
+        file << "\n]\n";
+    }
+    void Begin(TraceStage stage, size_t sessionId, const string& command) override
+    {
+        Event('B', stage, sessionId, command);
+    }
+    void End(TraceStage stage, size_t sessionId, const string& command) override
+    {
+        Event('E', stage, sessionId, command);
+    }
+
+private:
+    void Event(char phase, TraceStage stage, size_t sessionId, const string& command)
+    {
+        const auto ts = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+        lock_guard<mutex> lock(mtx);
+        if (!first) file << ",\n";
+        first = false;
+        file << R"({"name":")" << ToString(stage)
+             << R"(","cat":"cli","ph":")" << phase
+             << R"(","ts":)" << ts
+             << R"(,"pid":1,"tid":)" << sessionId
+             << R"(,"args":{"command":")";
+        Escape(command);
+        file << R"("}})";
+    }
+    void Escape(const string& s)
+    {
+        for (char c: s)
+        {
+            switch (c)
+            {
+                case '"': file << "\\\""; break;
+                case '\\': file << "\\\\"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) file << ' ';
+                    else file << c;
+            }
+        }
+    }
+
+    ofstream file;
+    const chrono::steady_clock::time_point start;
+    mutex mtx;
+    bool first = true;
+};
+
+int main()
+{
+#if BOOST_VERSION < 106600
+    boost::asio::io_service ios;
+#else
+    boost::asio::io_context ios;
+#endif
+
+    auto rootMenu = make_unique< Menu >( "cli" );
+    rootMenu -> Insert(
+            "hello",
+            [](std::ostream& out){ out << "Hello, world\n"; },
+            "Print hello world" );
+    rootMenu -> Insert(
+            "add", {"first_term", "second_term"},
+            [](std::ostream& out, int x, int y)
+            {
+                out << x << " + " << y << " = " << (x+y) << "\n";
+            },
+            "Print the sum of the two numbers" );
+    rootMenu -> Insert(
+            "sleep", {"milliseconds"},
+            [](std::ostream& out, unsigned int ms)
+            {
+                this_thread::sleep_for(chrono::milliseconds(ms));
+                out << "done\n";
+            },
+            "Wait for the given time (to see a slow handler in the trace)" );
+
+    Cli cli( std::move(rootMenu) );
+    cli.SetTracer( make_shared<ChromeTracer>("trace.json") );
+    cli.ExitAction( [](auto& out){ out << "The trace is in trace.json\n"; } );
+
+    CliLocalTerminalSession localSession(cli, ios, std::cout);
+    localSession.ExitAction(
+        [&ios](auto& out) // session exit action
+        {
+            out << "Closing App...\n";
+            ios.stop();
+        }
+    );
+
+    // connect with telnet to port 5000 to trace also the send stage
+    CliTelnetServer server(ios, 5000, cli);
+    ios.run();
+
+    return 0;
+}
@@ -163,6 +163,10 @@ int main()
     Cli cli( std::move(rootMenu), std::make_unique<FileHistoryStorage>(".cli") );
     // global exit action
     cli.ExitAction( [](auto& out){ out << "Goodbye and thanks for all the fish.\n"; } );
+    // the commands "sessions" and "kill-session"
+    cli.SessionCommands();
+    // an alias for all the sessions (e.g. "both 42")
+    cli.Alias("both", "answer $1 ; sub ; hello");
 
     CliLocalTerminalSession localSession(cli, ios, std::cout, 200);
     localSession.ExitAction(
@@ -178,6 +182,17 @@ int main()
     CliTelnetServer server(ios, 5000, cli);
     // exit action for all the connections
     server.ExitAction( [](auto& out) { out << "Terminating this session...\n"; } );
+    // socket options of the connections (these are the defaults)
+    TcpOptions tcpOptions;
+    tcpOptions.noDelay = true;     // send the echo of the keys at once
+    tcpOptions.batchOutput = true; // send the output of a command in large writes
+    server.SetTcpOptions(tcpOptions);
+    // close the connections left idle
+    server.IdleTimeout(std::chrono::minutes(30));
+    // refuse the new connections while the io context lags behind
+    server.ShedLoad(std::chrono::milliseconds(500));
+    // report the commands that block all the sessions
+    cli.SlowCommandLog(std::chrono::milliseconds(200));
     ios.run();
 
     return 0;
@@ -0,0 +1,67 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_AUDITSINK_H_
+#define CLI_AUDITSINK_H_
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+namespace cli
+{
+
+// What is recorded for each command executed in a session
+struct AuditRecord
+{
+    std::chrono::system_clock::time_point time; // when the command was issued
+    std::size_t sessionId = 0;                  // see CliSession::Id()
+    std::string peer;                           // remote address (empty for local sessions)
+    std::string menuPath;                       // path of the current menu (e.g. "/sub/subsub")
+    std::string command;                        // the whole command line
+    bool executed = false;                      // false if the command was not found
+    int status = 0;                             // see Status
+    std::chrono::microseconds duration{0};      // time spent to execute the command
+};
+
+// Destination of the audit records.
+// An instance can be installed in the Cli with Cli::SetAuditSink.
+// Store is called on the thread running the session, after each command:
+// it should return quickly (see FileAuditSink for an asynchronous implementation)
+// and must be thread safe if the sessions run on more threads.
+class AuditSink
+{
+public:
+    virtual ~AuditSink() = default;
+    virtual void Store(AuditRecord record) = 0;
+};
+
+} // namespace cli
+
+#endif // CLI_AUDITSINK_H_
@@ -30,20 +30,50 @@
 #ifndef CLI_H_
 #define CLI_H_
 
+// #define CLI_NO_BENCHMARK_CMDS
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <memory>
+#include <mutex>
 #include <functional>
 #include <algorithm>
 #include <cctype> // std::isspace
+#include <random>
 #include <type_traits>
 #include "colorprofile.h"
 #include "detail/history.h"
+#include "detail/commandlog.h"
+#include "detail/macro.h"
+#include "detail/script.h"
 #include "detail/split.h"
 #include "detail/fromstring.h"
+#include "detail/cmdline.h"
+#include "detail/commandmemory.h"
+#include "detail/prefixindex.h"
+#include "detail/symboltable.h"
+#include "detail/outputcounter.h"
+#include "detail/sessionbuffer.h"
+#include "detail/deadline.h"
+#include "detail/cputime.h"
+#include "detail/sessionstate.h"
 #include "historystorage.h"
 #include "volatilehistorystorage.h"
+#include "tracer.h"
+#include "auditsink.h"
+#include "sessioninfo.h"
+#include "sourceprogress.h"
+#include "status.h"
+#include "completionprovider.h"
 
 // #define CLI_DEPRECATED_API
 
@@ -72,9 +102,37 @@ namespace cli
 
     // ********************************************************************
 
+    namespace detail
+    {
+        inline std::string TrimLeft(std::string s)
+        {
+            s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](int ch) { return !std::isspace(ch); }));
+            return s;
+        }
+
+        // e.g. "12.345ms"
+        inline std::string FormatDuration(std::chrono::nanoseconds d)
+        {
+            const auto us = std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+            auto frac = std::to_string(us % 1000);
+            frac.insert(0, 3 - frac.size(), '0');
+            return std::to_string(us / 1000) + '.' + frac + "ms";
+        }
+    }
+
+    // ********************************************************************
+
+    // Set of roles, one per bit (e.g. enum : cli::Roles { admin = 1, operators = 2, bots = 4 }).
+    // A command is visible to a session when they share at least a role.
+    using Roles = std::uint32_t;
+    constexpr Roles allRoles = ~Roles(0);
+
+    // ********************************************************************
+
     // forward declarations
     class Menu;
     class CliSession;
+    namespace detail { class TraceSpan; class DeadlineScope; }
 
 
     class Cli
@@ -122,6 +180,8 @@ namespace cli
         // end inner class
 
     public:
+        class ChannelStream;
+
         Cli(
             std::unique_ptr<Menu>&& _rootMenu,
             std::function< void(std::ostream&)> _exitAction = {},
@@ -131,6 +191,8 @@ namespace cli
             rootMenu(std::move(_rootMenu)),
             exitAction(_exitAction)
         {
+            // the menus are ready: the sessions look up the names without locks
+            Symbols()->Freeze();
         }
 
         Cli(std::unique_ptr<Menu> _rootMenu, std::unique_ptr<HistoryStorage> historyStorage) :
@@ -143,6 +205,8 @@ namespace cli
         Cli& operator = (const Cli&) = delete;
 
         Menu* RootMenu() { return rootMenu.get(); }
+        // The names of the commands of the menus of this cli
+        const std::shared_ptr<detail::SymbolTable>& Symbols() const;
         void ExitAction( std::function< void(std::ostream&)> action ) { exitAction = action; }
         void ExitAction( std::ostream& out ) { if ( exitAction ) exitAction( out ); }
 
@@ -165,12 +229,275 @@ namespace cli
             return globalHistoryStorage->Commands();
         }
 
+        // The history of a key (see CliSession::HistoryKey)
+        void StoreCommands(const std::string& key, const std::vector<std::string>& cmds)
+        {
+            globalHistoryStorage->StoreFor(key, cmds);
+        }
+
+        std::vector<std::string> GetCommands(const std::string& key) const
+        {
+            return globalHistoryStorage->CommandsFor(key);
+        }
+
+        // The history of a key, with the result of the commands
+        void StoreEntries(const std::string& key, const std::vector<HistoryEntry>& entries)
+        {
+            globalHistoryStorage->StoreEntries(key, entries);
+        }
+
+        std::vector<HistoryEntry> GetEntries(const std::string& key) const
+        {
+            return globalHistoryStorage->EntriesFor(key);
+        }
+
+        // Accept the unique prefixes of the command and menu names, at every level
+        // (e.g. "sh int br" for "show interfaces brief"), optionally ignoring the case.
+        // It should be called before starting the sessions.
+        void AbbreviatedCommands(bool enable, bool ignoreCase = false)
+        {
+            abbreviations = enable;
+            abbreviationsIgnoreCase = ignoreCase;
+        }
+        bool AbbreviatedCommands() const { return abbreviations; }
+        bool AbbreviationsIgnoreCase() const { return abbreviationsIgnoreCase; }
+
+        // Enable the script statements in the sessions (see detail::Script):
+        // variables ("name=value" and "$name"), "for <name> in <first>..<last>" (or a list of items),
+        // "if [!] <command>", "else" and "end". The keywords hide the commands with the same name.
+        // It should be called before starting the sessions.
+        void Scripting(bool enable) { scripting = enable; }
+        bool Scripting() const { return scripting; }
+
+        // Install a tracer that receives the stages of the commands of all the sessions.
+        // It should be called before starting the sessions.
+        void SetTracer(std::shared_ptr<cli::Tracer> t) { tracer = std::move(t); }
+        cli::Tracer* GetTracer() const { return tracer.get(); }
+
+        // Install a sink that receives a record for each command executed in any session.
+        // It should be called before starting the sessions.
+        void SetAuditSink(std::shared_ptr<AuditSink> sink) { auditSink = std::move(sink); }
+        AuditSink* GetAuditSink() const { return auditSink.get(); }
+
+        // Number of commands that passed their deadline, in all the sessions
+        // (see CliSession::CommandDeadline and CmdHandler::SetDeadline)
+        std::size_t TimedOutCommands() const { return timedOutCommands; }
+
+        // Report the commands whose execution takes longer than threshold:
+        // a command runs on the thread of its session, so it delays all the
+        // sessions sharing it (e.g., the telnet sessions of an io context).
+        // log receives the record of the command on the thread of the session,
+        // after the command (by default, a line is written on std::cerr).
+        // A zero threshold (the default) disables the check.
+        // It should be called before starting the sessions.
+        void SlowCommandLog(std::chrono::milliseconds threshold, std::function<void(const AuditRecord&)> log = {})
+        {
+            slowThreshold = threshold;
+            slowLog = std::move(log);
+        }
+        std::chrono::milliseconds SlowCommandThreshold() const { return slowThreshold; }
+
+        // Number of commands that took longer than the SlowCommandLog threshold
+        std::size_t SlowCommands() const { return slowCommands; }
+
+        // Number of command lines that failed (or were not found), in all the sessions
+        // (see CliSession::LastStatus)
+        std::size_t FailedCommands() const { return failedCommands; }
+
+        // The state of the sessions of this cli, as published by them
+        // (it can be called from any thread)
+        std::vector<SessionInfo> Sessions() const;
+
+        // Closes the session with the id given, as with the command exit,
+        // on the thread of the session (see CliSession::SetExecutor).
+        // Returns false if there is no such session.
+        bool KillSession(std::size_t id);
+
+        // Writes the text on the sessions of this cli that joined the group
+        // (see CliSession::Join) or, if the group is empty, on all of them.
+        // The text is written by each session in its own thread (see
+        // CliSession::SetExecutor), so a slow session doesn't delay the others.
+        // Returns the number of sessions reached.
+        std::size_t Broadcast(const std::string& group, const std::string& text);
+
+        // A stream whose output is formatted once and written on the sessions
+        // of the group (as with Broadcast) at each flush and at its destruction,
+        // e.g. cli.Channel("alarms") << "temperature: " << t << std::endl;
+        ChannelStream Channel(std::string group);
+
+        // Add the commands "sessions" (the table of the sessions) and
+        // "kill-session <id>" to the sessions created from now on,
+        // visible only to the roles given
+        void SessionCommands(Roles roles = allRoles)
+        {
+            sessionCommands = true;
+            sessionCommandRoles = roles;
+        }
+
+        // Add the command "source <file>" (see CliSession::Source) to the sessions
+        // created from now on, visible only to the roles given.
+        // The command reads only the files in directory (and its subdirectories),
+        // given with a relative path: the files are read by the process,
+        // beware of giving it to remote users.
+        void SourceCommand(Roles roles = allRoles, std::string directory = ".")
+        {
+            sourceCommand = true;
+            sourceCommandRoles = roles;
+            sourceDirectory = std::move(directory);
+        }
+
+        // Defines an alias for all the sessions of this cli (see CliSession::Alias),
+        // e.g. cli.Alias("up", "interface $1 ; no shutdown ; exit").
+        // An empty definition removes the alias.
+        void Alias(const std::string& name, const std::string& definition)
+        {
+            std::vector<std::string> tokens;
+            detail::split(tokens, definition);
+            std::lock_guard<std::mutex> lock(aliasesMtx);
+            aliases.Define(name, tokens);
+            hasAliases = !aliases.Empty();
+        }
+
+        // (name, definition) of the aliases of this cli, sorted by name
+        std::vector<std::pair<std::string, std::string>> Aliases() const
+        {
+            std::lock_guard<std::mutex> lock(aliasesMtx);
+            return aliases.List();
+        }
+
     private:
+        friend class detail::DeadlineScope;
+        friend class CliSession;
+
+        void Add(CliSession& s)
+        {
+            std::lock_guard<std::mutex> lock(sessionsMtx);
+            sessions.push_back(&s);
+        }
+        void Remove(CliSession& s)
+        {
+            std::lock_guard<std::mutex> lock(sessionsMtx);
+            sessions.erase(std::remove(sessions.begin(), sessions.end(), &s), sessions.end());
+            for (auto& g: groups)
+                g.second.erase(std::remove(g.second.begin(), g.second.end(), &s), g.second.end());
+        }
+        void Join(CliSession& s, const std::string& group)
+        {
+            std::lock_guard<std::mutex> lock(sessionsMtx);
+            auto& members = groups[group];
+            if (std::find(members.begin(), members.end(), &s) == members.end())
+                members.push_back(&s);
+        }
+        void Leave(CliSession& s, const std::string& group)
+        {
+            std::lock_guard<std::mutex> lock(sessionsMtx);
+            auto i = groups.find(group);
+            if (i == groups.end()) return;
+            i->second.erase(std::remove(i->second.begin(), i->second.end(), &s), i->second.end());
+            if (i->second.empty()) groups.erase(i);
+        }
+        std::vector<std::string> GroupsOf(const CliSession& s) const
+        {
+            std::lock_guard<std::mutex> lock(sessionsMtx);
+            std::vector<std::string> result;
+            for (const auto& g: groups)
+                if (std::find(g.second.begin(), g.second.end(), &s) != g.second.end())
+                    result.push_back(g.first);
+            std::sort(result.begin(), result.end());
+            return result;
+        }
+
+        std::shared_ptr<const detail::Macro> FindAlias(const std::string& name) const
+        {
+            if (!hasAliases) return {};
+            std::lock_guard<std::mutex> lock(aliasesMtx);
+            return aliases.Find(name);
+        }
+
+        void SlowCommand(const AuditRecord& record)
+        {
+            ++slowCommands;
+            if (slowLog)
+                slowLog(record);
+            else
+                std::cerr << "slow command (" << detail::FormatDuration(record.duration)
+                          << ") in session " << record.sessionId
+                          << (record.peer.empty() ? "" : " from ") << record.peer
+                          << ": " << record.command << std::endl;
+        }
+
         std::unique_ptr<HistoryStorage> globalHistoryStorage;
         std::unique_ptr<Menu> rootMenu; // just to keep it alive
         std::function<void(std::ostream&)> exitAction;
+        std::shared_ptr<cli::Tracer> tracer;
+        std::shared_ptr<AuditSink> auditSink;
+        bool abbreviations = false;
+        bool abbreviationsIgnoreCase = false;
+        bool scripting = false;
+        std::atomic<std::size_t> timedOutCommands{0};
+        std::chrono::milliseconds slowThreshold{0};
+        std::function<void(const AuditRecord&)> slowLog;
+        std::atomic<std::size_t> slowCommands{0};
+        std::atomic<std::size_t> failedCommands{0};
+        mutable std::mutex sessionsMtx;
+        std::vector<CliSession*> sessions; // the live sessions
+        std::unordered_map<std::string, std::vector<CliSession*>> groups; // the sessions of each group
+        bool sessionCommands = false;
+        Roles sessionCommandRoles = allRoles;
+        bool sourceCommand = false;
+        Roles sourceCommandRoles = allRoles;
+        std::string sourceDirectory;
+        mutable std::mutex aliasesMtx;
+        detail::MacroTable aliases;
+        std::atomic<bool> hasAliases{false};
+    };
+
+    // Output stream of a group of sessions (see Cli::Channel)
+    class Cli::ChannelStream : public std::ostream
+    {
+    public:
+        ChannelStream(Cli& cli, std::string group) :
+            std::ostream(&buffer), buffer(cli, std::move(group))
+        {}
+        ChannelStream(ChannelStream&& other) :
+            std::ostream(&buffer), buffer(std::move(other.buffer))
+        {}
+        ~ChannelStream() { buffer.pubsync(); }
+
+    private:
+        // collects the text until sync, then writes it on the sessions
+        class Buffer : public std::stringbuf
+        {
+        public:
+            Buffer(Cli& _cli, std::string _group) : cli(&_cli), group(std::move(_group)) {}
+            Buffer(Buffer&& other) :
+                std::stringbuf(other.str()), cli(other.cli), group(std::move(other.group))
+            {
+                other.str({});
+                other.cli = nullptr;
+            }
+        protected:
+            int sync() override
+            {
+                if (cli && pptr() != pbase())
+                {
+                    cli->Broadcast(group, str());
+                    str({});
+                }
+                return 0;
+            }
+        private:
+            Cli* cli;
+            std::string group;
+        };
+        Buffer buffer;
     };
 
+    inline Cli::ChannelStream Cli::Channel(std::string group)
+    {
+        return ChannelStream(*this, std::move(group));
+    }
+
     // ********************************************************************
 
     class Command
@@ -180,7 +507,27 @@ namespace cli
         virtual ~Command() = default;
         virtual void Enable() { enabled = true; }
         virtual void Disable() { enabled = false; }
+        // Set the roles that can see the command (by default, all of them)
+        void SetRoles(Roles r) { roles = r; }
+        Roles GetRoles() const { return roles; }
+        // Returns true if the command is enabled and visible to a session with the mask given
+        bool IsVisible(Roles mask) const { return enabled && (roles & mask) != 0; }
+        const std::string& Name() const { return name; }
+        // Adds the name of the command (and of its subcommands) to the table,
+        // when it is inserted in a menu
+        virtual void Intern(const std::shared_ptr<detail::SymbolTable>& table)
+        {
+            symbol = table->Intern(name);
+        }
         virtual bool Exec(const std::vector<std::string>& cmdLine, CliSession& session) = 0;
+        // Executes the command from a view of the tokens (the ones coming from
+        // CliSession::Feed are allocated in the session memory).
+        // The default implementation copies them and calls the method above:
+        // the library commands override it to avoid the copy.
+        virtual bool Exec(const detail::CmdLine& cmdLine, CliSession& session)
+        {
+            return Exec(cmdLine.ToVector(), session);
+        }
         virtual void Help(std::ostream& out) const = 0;
         // Returns the collection of completions relatives to this command.
         // For simple commands, provides a base implementation that use the name of the command
@@ -192,12 +539,54 @@ namespace cli
             if (name.rfind(line, 0) == 0) return {name}; // name starts_with line
             else return {};
         }
+        // Like the method above, for a session with the roles mask given.
+        // Aggregate commands redefine it to filter the subcommands
+        virtual std::vector<std::string> GetCompletionRecursive(const std::string& line, Roles mask) const
+        {
+            if (!IsVisible(mask)) return {};
+            return GetCompletionRecursive(line);
+        }
+        // Set the provider of the completions for the parameters of this command
+        void SetCompletionProvider(std::shared_ptr<CompletionProvider> provider)
+        {
+            completionProvider = std::move(provider);
+        }
+        // Set the maximum execution time of the command (0, the default,
+        // to use the deadline of the session). See cli::Cancelled
+        void SetDeadline(std::chrono::milliseconds d) { deadline = d; }
+        std::chrono::milliseconds GetDeadline() const { return deadline; }
+        // Returns the completion provider of the command in line (if any).
+        // head is set to the line preceding the parameters of the command
+        // and params to the parameters typed so far.
+        // Like GetCompletionRecursive, aggregate commands redefine it to look
+        // for the subcommands
+        virtual std::shared_ptr<CompletionProvider> GetCompletionProviderRecursive(
+            const std::string& line, std::string& head, std::string& params, Roles mask) const
+        {
+            if (!IsVisible(mask) || !completionProvider) return {};
+            if (line.size() <= name.size() || line.compare(0, name.size(), name) != 0 || !std::isspace(static_cast<unsigned char>(line[name.size()])))
+                return {};
+            head = name + ' ';
+            params = detail::TrimLeft(line.substr(name.size()));
+            return completionProvider;
+        }
     protected:
-        const std::string& Name() const { return name; }
         bool IsEnabled() const { return enabled; }
+        // Returns true if the first token of cmdLine is the name of the command
+        // (comparing the symbols, when available)
+        bool MatchesName(const detail::CmdLine& cmdLine) const
+        {
+            if (cmdLine.HasSymbols() && symbol != detail::noSymbol)
+                return cmdLine.SymbolAt(0) == symbol;
+            return cmdLine[0].compare(name) == 0;
+        }
     private:
         const std::string name;
+        detail::SymbolId symbol = detail::noSymbol;
         bool enabled;
+        Roles roles = allRoles;
+        std::shared_ptr<CompletionProvider> completionProvider;
+        std::chrono::milliseconds deadline{0};
     };
 
     // ********************************************************************
@@ -205,13 +594,14 @@ namespace cli
     // free utility function to get completions from a list of commands and the current line
     inline std::vector<std::string> GetCompletions(
         const std::shared_ptr<std::vector<std::shared_ptr<Command>>>& cmds,
-        const std::string& currentLine)
+        const std::string& currentLine,
+        Roles mask = allRoles)
     {
         std::vector<std::string> result;
         std::for_each(cmds->begin(), cmds->end(),
-            [&currentLine,&result](const auto& cmd)
+            [&currentLine,&result,mask](const auto& cmd)
             {
-                auto c = cmd->GetCompletionRecursive(currentLine);
+                auto c = cmd->GetCompletionRecursive(currentLine, mask);
                 result.insert(
                     result.end(),
                     std::make_move_iterator(c.begin()),
@@ -228,7 +618,12 @@ namespace cli
     {
     public:
         CliSession(Cli& _cli, std::ostream& _out, std::size_t historySize = 100);
-        virtual ~CliSession() { cli.UnRegister(out); }
+        virtual ~CliSession()
+        {
+            state->Close();
+            cli.Remove(*this);
+            cli.UnRegister(target);
+        }
 
         // disable value semantics
         CliSession(const CliSession&) = delete;
@@ -238,7 +633,7 @@ namespace cli
 
         void Prompt();
 
-        void Current(Menu* menu) { current = menu; }
+        void Current(Menu* menu);
 
         std::ostream& OutStream() { return out; }
 
@@ -246,11 +641,12 @@ namespace cli
 
         void Exit()
         {
+            exited = true;
+            cancelSource = true; // the file in execution, if any
             if (exitAction) exitAction(out);
             cli.ExitAction(out);
 
-            auto cmds = history.GetCommands();
-            cli.StoreCommands(cmds);
+            cli.StoreEntries(historyKey, log.NewEntries());
         }
 
         void ExitAction(const std::function<void(std::ostream&)>& action)
@@ -258,8 +654,85 @@ namespace cli
             exitAction = action;
         }
 
+        // True after Exit: the session runs no more commands
+        // (its exit actions ran and its history was stored)
+        bool Exited() const { return exited; }
+
         void ShowHistory() const { history.Show(out); }
 
+        // The "history" command: without arguments shows the history, otherwise
+        // the result of the commands matching the query:
+        // "slowest [n]", "failures" or "since <n>[s|m|h]"
+        void ShowHistory(const std::vector<std::string>& query) const;
+
+        // The last commands (up to the history size) with the result of their execution,
+        // the oldest first
+        std::vector<HistoryEntry> HistoryEntries() const { return log.Entries(); }
+
+        // Key of the history of the session (e.g., the user or the peer):
+        // the history of the key is loaded now, and the commands of the
+        // session are stored with it when the session exits
+        // (see KeyedHistoryStorage). By default, the key is empty.
+        void HistoryKey(const std::string& key);
+        const std::string& HistoryKey() const { return historyKey; }
+
+        // Defines an alias of this session, that takes precedence over the aliases
+        // of the cli and over the commands: a sequence of commands separated by ";",
+        // with the positional parameters $1, $2, ... and $* (see detail::Macro),
+        // e.g. session.Alias("up", "interface $1 ; no shutdown ; exit").
+        // The definition is tokenized once, here. An empty definition removes the alias.
+        void Alias(const std::string& name, const std::string& definition)
+        {
+            std::vector<std::string> tokens;
+            detail::split(tokens, definition);
+            aliases.Define(name, tokens);
+        }
+        // Removes an alias of this session (returns false if there is no such alias)
+        bool Unalias(const std::string& name) { return aliases.Remove(name); }
+
+        // Executes the lines of a file in this session (with its current menu, roles and output)
+        // as if they were typed, without adding them to the history. The file is read in chunks,
+        // and the lines starting with '#' are comments.
+        // Returns false if the file can't be read or the execution is canceled.
+        bool Source(const std::string& fileName);
+
+        // Stops the file in execution (see Source) after the current line.
+        // It can be called from any thread (e.g., by a command or by another session).
+        void CancelSource() { cancelSource = true; }
+
+        // Reports the progress of Source every interval, and at the end.
+        // By default, a line on the output of the session every second (but at the end).
+        void ReportSourceProgress(std::chrono::milliseconds interval, std::function<void(const SourceProgress&)> report = {})
+        {
+            sourceInterval = interval;
+            sourceReport = std::move(report);
+        }
+
+        // The status of the last command line executed: the one returned by
+        // the handler (see Status), Status::notFound if the command was not found,
+        // and a failure if the handler threw CommandError (or another exception).
+        // Within a handler, the status of the command being executed.
+        const Status& LastStatus() const { return lastStatus; }
+        // Sets the status of the command in execution (e.g., from a handler returning void)
+        void SetStatus(Status status) { lastStatus = std::move(status); }
+
+        // Stop the scripts, the files (see Source) and the input of a CliFileSession
+        // at the first command that fails
+        void StopOnError(bool enable) { stopOnError = enable; }
+        bool StopOnError() const { return stopOnError; }
+
+        // After each command line, write on the output a line with its status,
+        // for the programs driving the session: "%status <code>[ <message>]"
+        void StatusLine(bool enable) { statusLine = enable; }
+
+        // The variables of the scripts of this session (see Cli::Scripting)
+        void Variable(const std::string& name, const std::string& value) { script.Vars()[name] = value; }
+        std::string Variable(const std::string& name) const
+        {
+            auto v = script.Vars().find(name);
+            return v == script.Vars().end() ? std::string() : v->second;
+        }
+
         std::string PreviousCmd(const std::string& line)
         {
             return history.Previous(line);
@@ -272,35 +745,368 @@ namespace cli
 
         std::vector<std::string> GetCompletions(std::string currentLine) const;
 
+        // Returns the completion provider for the parameters of the command in currentLine (if any).
+        // See Command::GetCompletionProviderRecursive
+        std::shared_ptr<CompletionProvider> GetCompletionProvider(std::string currentLine, std::string& head, std::string& params) const;
+
+        // Maximum time the interactive session waits for the results of a CompletionProvider
+        void CompletionDeadline(std::chrono::milliseconds d) { completionDeadline = d; }
+        std::chrono::milliseconds CompletionDeadline() const { return completionDeadline; }
+
+        // Maximum execution time of the commands without a deadline of their own
+        // (0, the default, for no deadline). See cli::Cancelled
+        void CommandDeadline(std::chrono::milliseconds d) { commandDeadline = d; }
+        std::chrono::milliseconds CommandDeadline() const { return commandDeadline; }
+
+        // Unique identifier of the session in the process
+        std::size_t Id() const { return id; }
+
+        // Address of the remote peer (empty for local sessions)
+        virtual std::string Peer() const { return {}; }
+
+        // Set the roles of the session: only the commands having at least one
+        // of them are executed, shown in the help and completed
+        void SetRoles(Roles r) { roles = r; }
+        Roles GetRoles() const { return roles; }
+
+        // Size (in chars) and type of the terminal of the session, when known
+        // (e.g., negotiated by telnet): a width of 0 means unknown
+        void TerminalSize(std::size_t width, std::size_t height) { terminalWidth = width; terminalHeight = height; }
+        std::size_t TerminalWidth() const { return terminalWidth; }
+        std::size_t TerminalHeight() const { return terminalHeight; }
+        void TerminalType(std::string type) { terminalType = std::move(type); }
+        const std::string& TerminalType() const { return terminalType; }
+
+        // Number of columns taken by the prompt
+        std::size_t PromptSize() const;
+
+        // The state of the session, as published for the other threads (see Cli::Sessions)
+        SessionInfo Info() const { return state->Info(); }
+
+        // Closes the session from outside (see Cli::KillSession)
+        virtual void Kill() { Exit(); }
+
+        // Sets how the other threads post a task to the thread of the session
+        // (see Cli::KillSession and Cli::Broadcast): without an executor, the tasks run at once
+        // in the thread of the caller. The interactive sessions set it.
+        void SetExecutor(detail::SessionState::Executor ex) { state->SetExecutor(std::move(ex)); }
+
+        // The session receives the output sent to the group
+        // (see Cli::Broadcast and Cli::Channel) until it leaves it
+        void Join(const std::string& group) { cli.Join(*this, group); }
+        void Leave(const std::string& group) { cli.Leave(*this, group); }
+        // The groups joined, sorted
+        std::vector<std::string> Groups() const { return cli.GroupsOf(*this); }
+
+#ifdef CLI_HAS_PMR
+        // Memory resource for the allocations needed by the current command.
+        // Everything allocated here is released when the command ends.
+        std::pmr::memory_resource* MemoryResource() { return memory.Resource(); }
+#endif
+
+    protected:
+        // Called around the execution of each command line and the prompt,
+        // whose output can be sent at once (e.g., by a remote session)
+        virtual void OnOutputBegin() {}
+        virtual void OnOutputEnd() {}
+
+        // Publish the peer and the data received and sent by a remote session
+        // (by default, the data received are the command lines)
+        void PublishPeer(std::string peer) { state->Peer(std::move(peer)); }
+        void PublishTraffic(std::size_t in, std::size_t out, std::size_t pendingOutput)
+        {
+            remoteTraffic = true;
+            state->bytesIn = in;
+            state->bytesOut = out;
+            state->pendingOutput = pendingOutput;
+        }
+
     private:
+        friend class Cli; // for the stream and the state of the session
+        friend class detail::TraceSpan;
+        friend class detail::DeadlineScope;
+
+        bool Dispatch(const detail::CmdLine& cmdLine, Menu* scope = nullptr);
+        template <typename Tokens>
+        bool Execute(Tokens& tokens);
+        bool ExecutePrepared(const detail::CmdLine& cmdLine, Menu* pathMenu, bool resolved);
+        template <typename Tokens>
+        bool RunChain(Tokens& tokens, const std::vector<std::size_t>& operators, const std::string& text);
+        template <typename Tokens>
+        bool RunCommand(Tokens& tokens, const std::string& text);
+        template <typename Tokens>
+        void WrongCommand(const Tokens& tokens, const std::string& text);
+        bool WrongSourceLine();
+        template <typename Tokens>
+        bool RunAlias(const detail::Macro& alias, const Tokens& tokens);
+        bool RunScript(bool logged);
+        template <typename F>
+        bool Record(const std::string& text, bool logged, F&& f);
+        template <typename Tokens>
+        void Run(const std::string& cmd, Tokens& strs, const std::vector<std::size_t>& operators,
+                 const std::vector<std::size_t>& quoted, bool logged);
+        void SourceLine(const std::string& cmd);
+        bool SourcePath(const std::string& file, std::string& path) const;
+        // (the lookup of an alias needs a std::string)
+        bool HasAliases() const { return !aliases.Empty() || cli.hasAliases; }
+        std::shared_ptr<const detail::Macro> FindAlias(const std::string& name) const
+        {
+            auto alias = aliases.Find(name);
+            return alias ? alias : cli.FindAlias(name);
+        }
+        template <typename Tokens, typename Symbols>
+        bool Prepare(Tokens& tokens, Symbols& symbols, Menu*& pathMenu) const;
+        Menu* ResolvePath(detail::Token& token) const;
+        template <typename Container>
+        void ExpandAbbreviations(Container& tokens, const Menu* scope = nullptr) const;
+        void Audit(const std::string& cmd, std::string menuPath,
+                   std::chrono::system_clock::time_point time,
+                   std::chrono::steady_clock::time_point start);
+
+#ifndef CLI_NO_BENCHMARK_CMDS
+        // the built-in commands "time" and "repeat"
+        void Time(std::vector<std::string> args);
+        void Repeat(std::vector<std::string> args);
+#endif
+#ifndef CLI_NO_ALIAS_CMDS
+        // the built-in commands "alias" and "unalias"
+        void AliasCmd(std::vector<std::string> args);
+        Status UnaliasCmd(const std::string& name);
+#endif
+        // the commands "sessions" and "kill-session" (see Cli::SessionCommands)
+        void ShowSessions() const;
+        Status KillSession(std::size_t sessionId);
+
+        // Adds the CPU time spent by the thread during its lifetime to the session
+        class CpuScope
+        {
+        public:
+            explicit CpuScope(CliSession& _session) : session(_session), start(detail::ThreadCpuTime()) { ++session.cpuScopes; }
+            // the outermost one counts (e.g., the command "source" and the lines of its file)
+            ~CpuScope() { if (--session.cpuScopes == 0) session.state->cpuTime += (detail::ThreadCpuTime() - start).count(); }
+            CpuScope(const CpuScope&) = delete;
+            CpuScope& operator = (const CpuScope&) = delete;
+        private:
+            CliSession& session;
+            const std::chrono::microseconds start;
+        };
+
+        // Calls OnOutputBegin and OnOutputEnd around its lifetime
+        class OutputBatch
+        {
+        public:
+            explicit OutputBatch(CliSession& _session) : session(_session) { session.OnOutputBegin(); }
+            ~OutputBatch() { session.OnOutputEnd(); }
+            OutputBatch(const OutputBatch&) = delete;
+            OutputBatch& operator = (const OutputBatch&) = delete;
+        private:
+            CliSession& session;
+        };
+
+        // Sets the command in execution for its lifetime
+        // (commands executed from within another command restore the outer one)
+        class CommandScope
+        {
+        public:
+            CommandScope(CliSession& _session, const detail::Token& name) :
+                session(_session), previous(_session.currentCommand)
+            {
+                session.currentCommand = &name;
+            }
+            ~CommandScope() { session.currentCommand = previous; }
+            CommandScope(const CommandScope&) = delete;
+            CommandScope& operator = (const CommandScope&) = delete;
+        private:
+            CliSession& session;
+            const detail::Token* previous;
+        };
+
+        static std::size_t NewId()
+        {
+            static std::atomic<std::size_t> lastId{0};
+            return ++lastId;
+        }
+
+        const detail::Token& CurrentCommand() const
+        {
+            static const detail::Token none;
+            return currentCommand ? *currentCommand : none;
+        }
 
         Cli& cli;
         Menu* current;
         std::unique_ptr<Menu> globalScopeMenu;
-        std::ostream& out;
+        std::ostream& target; // the stream of the session, where the broadcasts are written
+        detail::SessionBuffer buffer; // counts the output and applies the deadlines
+        mutable std::ostream out; // on buffer: the output of the session and of its commands
         std::function< void(std::ostream&)> exitAction;
         detail::History history;
+        detail::CommandLog log;
+        detail::CommandMemory memory;
+        const std::size_t id;
+        const detail::Token* currentCommand = nullptr;
+        std::chrono::milliseconds completionDeadline{250};
+        Roles roles = allRoles;
+        std::size_t terminalWidth = 0;
+        std::size_t terminalHeight = 0;
+        std::string terminalType;
+        std::chrono::milliseconds commandDeadline{0};
+        detail::OutputDeadline* activeDeadline = nullptr; // of the command in execution
+        const std::shared_ptr<detail::SessionState> state; // published for the other threads
+        bool remoteTraffic = false; // see PublishTraffic
+        std::size_t cpuScopes = 0;
+        std::string historyKey;
+        detail::MacroTable aliases;
+        detail::Script script;
+        std::string blockHeader; // the first line of the script block being added
+        Status lastStatus;
+        bool stopOnError = false;
+        bool statusLine = false;
+        bool exited = false;
+        std::atomic<bool> cancelSource{false};
+        std::size_t sourceDepth = 0; // files in execution (see Source)
+        const std::string* sourceFile = nullptr; // the innermost one
+        std::size_t sourceLineNumber = 0; // of the line of sourceFile in execution
+        std::chrono::milliseconds sourceInterval{1000};
+        std::function<void(const SourceProgress&)> sourceReport;
+        enum { sourceChunk = 64 * 1024, maxSourceDepth = 16 };
+        enum : std::size_t { maxRepeat = 1000000, repeatSamples = 1024 }; // see Repeat
+    };
+
+    // ********************************************************************
+
+    namespace detail
+    {
+
+#ifndef CLI_NO_TRACING
+
+    // Notifies the tracer (if any) of the begin of a stage
+    // at construction and of its end at destruction (or at End())
+    class TraceSpan
+    {
+    public:
+        TraceSpan(CliSession& session, TraceStage _stage, const std::string& _command) :
+            tracer(session.cli.GetTracer()),
+            stage(_stage),
+            sessionId(session.id),
+            command(_command)
+        {
+            if (tracer) tracer->Begin(stage, sessionId, command);
+        }
+        // the stage is tagged with the command in execution in the session
+        TraceSpan(CliSession& session, TraceStage _stage) :
+            tracer(session.cli.GetTracer()),
+            stage(_stage),
+            sessionId(session.id),
+            name(tracer ? AsString(session.CurrentCommand()) : std::string()),
+            command(name)
+        {
+            if (tracer) tracer->Begin(stage, sessionId, command);
+        }
+        ~TraceSpan() { End(); }
+        TraceSpan(const TraceSpan&) = delete;
+        TraceSpan& operator = (const TraceSpan&) = delete;
+
+        void End()
+        {
+            if (tracer) tracer->End(stage, sessionId, command);
+            tracer = nullptr;
+        }
+
+    private:
+        Tracer* tracer;
+        const TraceStage stage;
+        const std::size_t sessionId;
+        const std::string name; // a copy of the command in execution (a token)
+        const std::string& command;
     };
 
+#else
+
+    class TraceSpan
+    {
+    public:
+        TraceSpan(CliSession&, TraceStage, const std::string&) {}
+        TraceSpan(CliSession&, TraceStage) {}
+        void End() {}
+    };
+
+#endif // CLI_NO_TRACING
+
+    // Applies the deadline of a command (or, if it has none, of the session)
+    // to its execution: after the deadline, its output is discarded and
+    // cli::Cancelled returns true. When the command returns after its
+    // deadline, the session reports it and counts it as timed out.
+    // The deadline of a command executed by another one can only be shorter.
+    class DeadlineScope
+    {
+    public:
+        DeadlineScope(CliSession& _session, std::chrono::milliseconds commandDeadline) :
+            session(_session), previous(_session.activeDeadline)
+        {
+            duration = commandDeadline.count() > 0 ? commandDeadline : session.commandDeadline;
+            if (duration.count() <= 0) return;
+            const auto deadline = std::chrono::steady_clock::now() + duration;
+            if (previous && previous->Deadline() <= deadline) return;
+            guard = std::make_unique<OutputDeadline>(session.out, deadline);
+            session.activeDeadline = guard.get();
+        }
+        ~DeadlineScope()
+        {
+            if (!guard) return;
+            const bool expired = guard->Expired();
+            guard.reset();
+            session.activeDeadline = previous;
+            if (expired)
+            {
+                session.out << "command timed out after " << FormatDuration(duration) << "\n";
+                ++session.cli.timedOutCommands;
+            }
+        }
+        DeadlineScope(const DeadlineScope&) = delete;
+        DeadlineScope& operator = (const DeadlineScope&) = delete;
+    private:
+        CliSession& session;
+        OutputDeadline* previous;
+        std::chrono::milliseconds duration;
+        std::unique_ptr<OutputDeadline> guard;
+    };
+
+    } // namespace detail
+
+    // Returns true when the command writing on out has passed its deadline
+    // (see CliSession::CommandDeadline and CmdHandler::SetDeadline).
+    // A long running handler can check it to stop: after the deadline
+    // its output is discarded anyway (and out is in a bad state).
+    inline bool Cancelled(std::ostream& out)
+    {
+        return detail::DeadlineExpired(out);
+    }
+
     // ********************************************************************
 
     class CmdHandler
     {
     public:
         using CmdVec = std::vector<std::shared_ptr<Command>>;
+        using CmdIndex = detail::PrefixIndex<Menu>;
         CmdHandler() : descriptor(std::make_shared<Descriptor>()) {}
-        CmdHandler(std::weak_ptr<Command> c, std::weak_ptr<CmdVec> v) :
-            descriptor(std::make_shared<Descriptor>(c, v))
+        CmdHandler(std::weak_ptr<Command> c, std::weak_ptr<CmdVec> v, std::weak_ptr<CmdIndex> i = {}, Menu* m = nullptr) :
+            descriptor(std::make_shared<Descriptor>(c, v, i, m))
         {}
         void Enable() { if (descriptor) descriptor->Enable(); }
         void Disable() { if (descriptor) descriptor->Disable(); }
         void Remove() { if (descriptor) descriptor->Remove(); }
+        void SetRoles(Roles r) { if (descriptor) descriptor->SetRoles(r); }
+        void SetCompletionProvider(std::shared_ptr<CompletionProvider> p) { if (descriptor) descriptor->SetCompletionProvider(std::move(p)); }
+        void SetDeadline(std::chrono::milliseconds d) { if (descriptor) descriptor->SetDeadline(d); }
     private:
         struct Descriptor
         {
             Descriptor() {}
-            Descriptor(const std::weak_ptr<Command>& c, const std::weak_ptr<CmdVec>& v) :
-                cmd(c), cmds(v)
+            Descriptor(const std::weak_ptr<Command>& c, const std::weak_ptr<CmdVec>& v,
+                       const std::weak_ptr<CmdIndex>& i, Menu* m) :
+                cmd(c), cmds(v), index(i), menu(m)
             {}
             void Enable()
             {
@@ -312,6 +1118,21 @@ namespace cli
                 if(auto c = cmd.lock())
                     c->Disable();
             }
+            void SetRoles(Roles r)
+            {
+                if(auto c = cmd.lock())
+                    c->SetRoles(r);
+            }
+            void SetCompletionProvider(std::shared_ptr<CompletionProvider> p)
+            {
+                if(auto c = cmd.lock())
+                    c->SetCompletionProvider(std::move(p));
+            }
+            void SetDeadline(std::chrono::milliseconds d)
+            {
+                if(auto c = cmd.lock())
+                    c->SetDeadline(d);
+            }
             void Remove()
             {
                 auto scmd = cmd.lock();
@@ -324,11 +1145,17 @@ namespace cli
                         [&](const auto& c){ return c.get() == scmd.get(); }
                     );
                     if (i != scmds->end())
+                    {
                         scmds->erase(i);
+                        if (auto sindex = index.lock())
+                            sindex->Remove(scmd->Name(), menu);
+                    }
                 }
             }
             std::weak_ptr<Command> cmd;
             std::weak_ptr<CmdVec> cmds;
+            std::weak_ptr<CmdIndex> index;
+            Menu* menu = nullptr; // if cmd is a menu
         };
         std::shared_ptr<Descriptor> descriptor;
     };
@@ -342,11 +1169,18 @@ namespace cli
         Menu(const Menu&) = delete;
         Menu& operator = (const Menu&) = delete;
 
-        Menu() : Command({}), parent(nullptr), description(), cmds(std::make_shared<Cmds>()) {}
+        using CmdMatch = detail::PrefixIndex<Menu>::Match;
+
+        Menu() : Command({}), parent(nullptr), description(), cmds(std::make_shared<Cmds>()), index(std::make_shared<CmdIndex>()), symbols(std::make_shared<detail::SymbolTable>())
+        {
+            Command::Intern(symbols);
+        }
 
         Menu(const std::string& _name, const std::string& desc = "(menu)") :
-            Command(_name), parent(nullptr), description(desc), cmds(std::make_shared<Cmds>())
-        {}
+            Command(_name), parent(nullptr), description(desc), cmds(std::make_shared<Cmds>()), index(std::make_shared<CmdIndex>()), symbols(std::make_shared<detail::SymbolTable>())
+        {
+            Command::Intern(symbols);
+        }
 
         template <typename F>
         CmdHandler Insert(const std::string& cmdName, F f, const std::string& help = "", const std::vector<std::string>& parDesc={})
@@ -375,6 +1209,8 @@ namespace cli
         void Add(std::unique_ptr<Command>&& cmd)
         {
             std::shared_ptr<Command> s(std::move(cmd));
+            s->Intern(symbols);
+            index->Insert(s->Name());
             cmds->push_back(s);
         }
 
@@ -383,6 +1219,8 @@ namespace cli
         {
             std::shared_ptr<Menu> s(std::move(menu));
             s->parent = this;
+            s->Intern(symbols);
+            index->Insert(s->Name(), s.get());
             cmds->push_back(s);
         }
 #endif // CLI_DEPRECATED_API
@@ -390,7 +1228,9 @@ namespace cli
         CmdHandler Insert(std::unique_ptr<Command>&& cmd)
         {
             std::shared_ptr<Command> scmd(std::move(cmd));
-            CmdHandler c(scmd, cmds);
+            CmdHandler c(scmd, cmds, index);
+            scmd->Intern(symbols);
+            index->Insert(scmd->Name());
             cmds->push_back(scmd);
             return c;
         }
@@ -398,17 +1238,25 @@ namespace cli
         CmdHandler Insert(std::unique_ptr<Menu>&& menu)
         {
             std::shared_ptr<Menu> smenu(std::move(menu));
-            CmdHandler c(smenu, cmds);
+            CmdHandler c(smenu, cmds, index, smenu.get());
             smenu->parent = this;
+            smenu->Intern(symbols);
+            index->Insert(smenu->Name(), smenu.get());
             cmds->push_back(smenu);
             return c;
         }
 
         bool Exec(const std::vector<std::string>& cmdLine, CliSession& session) override
         {
-            if (!IsEnabled())
+            const auto& tokens = detail::ToTokens(cmdLine);
+            return Exec(detail::CmdLine(tokens), session);
+        }
+
+        bool Exec(const detail::CmdLine& cmdLine, CliSession& session) override
+        {
+            if (!IsVisible(session.GetRoles()))
                 return false;
-            if (cmdLine[0] == Name())
+            if (MatchesName(cmdLine))
             {
                 if (cmdLine.size() == 1)
                 {
@@ -418,34 +1266,104 @@ namespace cli
                 else
                 {
                     // check also for subcommands
-                    std::vector<std::string > subCmdLine(cmdLine.begin()+1, cmdLine.end());
-                    for (auto& cmd: *cmds)
-                        if (cmd->Exec( subCmdLine, session )) return true;
+                    return ExecSubCmds(cmdLine.Tail(), session);
                 }
             }
             return false;
         }
 
+        // Executes cmdLine with the subcommands of the menu
+        bool ExecSubCmds(const detail::CmdLine& cmdLine, CliSession& session)
+        {
+            const auto mask = session.GetRoles();
+            for (auto& cmd: *cmds)
+                if (cmd->IsVisible(mask) && cmd->Exec( cmdLine, session )) return true;
+            return false;
+        }
+
         bool ScanCmds(const std::vector<std::string>& cmdLine, CliSession& session)
         {
-            if (!IsEnabled()) return false;
+            const auto& tokens = detail::ToTokens(cmdLine);
+            return ScanCmds(detail::CmdLine(tokens), session);
+        }
+
+        bool ScanCmds(const detail::CmdLine& cmdLine, CliSession& session)
+        {
+            const auto mask = session.GetRoles();
+            if (!IsVisible(mask)) return false;
             for (auto& cmd: *cmds)
-                if (cmd->Exec(cmdLine, session)) return true;
+                if (cmd->IsVisible(mask) && cmd->Exec(cmdLine, session)) return true;
             if (parent && parent->Exec(cmdLine, session)) return true;
             return false;
         }
 
+        // Looks for the subcommands visible with mask whose name starts
+        // with prefix (see ScanCmds): a hidden or disabled command
+        // neither is found nor makes a prefix ambiguous
+        void FindCmds(const std::string& prefix, bool ignoreCase, Roles mask, CmdMatch& m) const
+        {
+            CmdMatch all;
+            index->Find(prefix, ignoreCase, all);
+            if (!all.Unique() && all.count == 0) return; // no names with the prefix
+            if (all.Unique() && HasVisible(all.name, mask))
+            {
+                m.Add(all.name, all.value, prefix, ignoreCase);
+                return;
+            }
+            // some candidates are hidden: the visible ones are checked one by one
+            for (const auto& cmd: *cmds)
+            {
+                if (!cmd->IsVisible(mask) || !CmdIndex::StartsWith(cmd->Name(), prefix, ignoreCase)) continue;
+                CmdMatch exact;
+                index->Find(cmd->Name(), false, exact); // for the menu
+                m.Add(cmd->Name(), exact.value, prefix, ignoreCase);
+            }
+        }
+
+        // Looks for the commands visible with mask whose name starts with prefix
+        // among the ones considered by ScanCmds: the subcommands and the parent menu
+        void ScanCmds(const std::string& prefix, bool ignoreCase, Roles mask, CmdMatch& m) const
+        {
+            FindCmds(prefix, ignoreCase, mask, m);
+            if (parent && parent->IsVisible(mask)) m.Add(parent->Name(), parent, prefix, ignoreCase);
+        }
+
+        // Uses table for the names of this menu and of all its subcommands
+        // (i.e., the one of the menu where this is inserted)
+        void Intern(const std::shared_ptr<detail::SymbolTable>& table) override
+        {
+            // a single snapshot for the whole menu (see SymbolTable)
+            detail::SymbolTable::Batch batch(*table);
+            Command::Intern(table);
+            symbols = table;
+            for (auto& cmd: *cmds)
+                cmd->Intern(table);
+        }
+
+        const std::shared_ptr<detail::SymbolTable>& Symbols() const { return symbols; }
+
         std::string Prompt() const
         {
             return Name();
         }
 
-        void MainHelp(std::ostream& out)
+        // Path of the menu from the root menu (e.g. "/sub/subsub").
+        // The root menu path is "/"
+        std::string Path() const
         {
-            if (!IsEnabled()) return;
+            if (!parent) return "/";
+            auto path = parent->Path();
+            if (path.size() > 1) path += '/';
+            return path + Name();
+        }
+
+        void MainHelp(std::ostream& out, Roles mask = allRoles)
+        {
+            if (!IsVisible(mask)) return;
             for (const auto& cmd: *cmds)
-                cmd->Help(out);
-            if (parent) parent->Help(out);
+                if (cmd->IsVisible(mask))
+                    cmd->Help(out);
+            if (parent && parent->IsVisible(mask)) parent->Help(out);
         }
 
         void Help(std::ostream& out) const override
@@ -458,22 +1376,58 @@ namespace cli
         // - the completions of this menu command
         // - the recursive completions of subcommands
         // - the recursive completions of parent menu
-        std::vector<std::string> GetCompletions(const std::string& currentLine) const
+        std::vector<std::string> GetCompletions(const std::string& currentLine, Roles mask = allRoles) const
         {
-            auto result = cli::GetCompletions(cmds, currentLine);
+            auto result = cli::GetCompletions(cmds, currentLine, mask);
             if (parent)
             {
-                auto c = parent->GetCompletionRecursive(currentLine);
+                auto c = parent->GetCompletionRecursive(currentLine, mask);
                 result.insert(result.end(), std::make_move_iterator(c.begin()), std::make_move_iterator(c.end()));
             }
             return result;
         }
 
+        // returns the completion provider of:
+        // - the command of this menu in currentLine
+        // - the command of the parent menu (recursively) in currentLine
+        std::shared_ptr<CompletionProvider> GetCompletionProvider(const std::string& currentLine, std::string& head, std::string& params, Roles mask = allRoles) const
+        {
+            for (const auto& cmd: *cmds)
+                if (auto p = cmd->GetCompletionProviderRecursive(currentLine, head, params, mask))
+                    return p;
+            if (parent)
+                return parent->GetCompletionProviderRecursive(currentLine, head, params, mask);
+            return {};
+        }
+
+        // returns the completion provider of the subcommand in line (if any)
+        std::shared_ptr<CompletionProvider> GetCompletionProviderRecursive(const std::string& line, std::string& head, std::string& params, Roles mask) const override
+        {
+            if (!IsVisible(mask)) return {};
+            if (line.size() <= Name().size() || line.compare(0, Name().size(), Name()) != 0 || !std::isspace(static_cast<unsigned char>(line[Name().size()])))
+                return {};
+            const auto rest = detail::TrimLeft(line.substr(Name().size()));
+            for (const auto& cmd: *cmds)
+                if (auto p = cmd->GetCompletionProviderRecursive(rest, head, params, mask))
+                {
+                    head = Name() + ' ' + head; // concat submenu with command
+                    return p;
+                }
+            return {};
+        }
+
         // returns:
         // - the completion of this menu command
         // - the recursive completions of the subcommands
-        virtual std::vector<std::string> GetCompletionRecursive(const std::string& line) const override
+        std::vector<std::string> GetCompletionRecursive(const std::string& line) const override
+        {
+            return GetCompletionRecursive(line, allRoles);
+        }
+
+        // like the method above, considering only the commands visible with mask
+        std::vector<std::string> GetCompletionRecursive(const std::string& line, Roles mask) const override
         {
+            if (!IsVisible(mask)) return {};
             if (line.rfind(Name(), 0) == 0) // line starts_with Name()
             {
                 auto rest = line;
@@ -483,7 +1437,7 @@ namespace cli
                 std::vector<std::string> result;
                 for (const auto& cmd: *cmds)
                 {
-                    auto cs = cmd->GetCompletionRecursive(rest);
+                    auto cs = cmd->GetCompletionRecursive(rest, mask);
                     for (const auto& c: cs)
                         result.push_back(Name() + ' ' + c); // concat submenu with command
                 }
@@ -494,6 +1448,15 @@ namespace cli
 
     private:
 
+        // true if a subcommand with the name given is visible with mask
+        bool HasVisible(const std::string& name, Roles mask) const
+        {
+            return std::any_of(cmds->begin(), cmds->end(), [&](const std::shared_ptr<Command>& cmd)
+            {
+                return cmd->IsVisible(mask) && cmd->Name() == name;
+            });
+        }
+
 #ifdef CLI_DEPRECATED_API
         template <typename F, typename R>
         void Add(const std::string& name, const std::string& help, F& f,R (F::*mf)(std::ostream& out) const);
@@ -526,6 +1489,11 @@ namespace cli
         // for the CmdHandler::Descriptor
         using Cmds = std::vector<std::shared_ptr<Command>>;
         std::shared_ptr<Cmds> cmds;
+        // the names of cmds, for the abbreviations
+        using CmdIndex = detail::PrefixIndex<Menu>;
+        std::shared_ptr<CmdIndex> index;
+        // shared by all the menus of the tree
+        std::shared_ptr<detail::SymbolTable> symbols;
     };
 
     // ********************************************************************
@@ -762,18 +1730,41 @@ namespace cli
 
     // *******************************************
 
-    template <typename F, typename ... Args>
-    struct Select;
-
-    template <typename F, typename P, typename ... Args>
-    struct Select<F, P, Args...>
+    namespace detail
     {
-        template <typename InputIt>
-        static void Exec(const F& f, InputIt first, InputIt last)
+        // Calls the handler f of a command: if it returns a Status,
+        // it becomes the status of the session (see CliSession::LastStatus).
+        // Any other return type (e.g., bool) is ignored, as before Status existed.
+        template <typename F>
+        using ReturnsStatus = std::is_same<std::decay_t<decltype(std::declval<const F&>()())>, Status>;
+
+        template <typename F>
+        auto CallHandler(CliSession& session, const F& f)
+            -> typename std::enable_if<ReturnsStatus<F>::value>::type
+        {
+            session.SetStatus(f());
+        }
+
+        template <typename F>
+        auto CallHandler(CliSession&, const F& f)
+            -> typename std::enable_if<!ReturnsStatus<F>::value>::type
+        {
+            f();
+        }
+    }
+
+    template <typename F, typename ... Args>
+    struct Select;
+
+    template <typename F, typename P, typename ... Args>
+    struct Select<F, P, Args...>
+    {
+        template <typename InputIt>
+        static void Exec(const F& f, InputIt first, InputIt last)
         {
             assert( first != last );
             assert( std::distance(first, last) == 1+sizeof...(Args) );
-            const P p = detail::from_string<typename std::decay<P>::type>(*first);
+            const P p = detail::from_string<typename std::decay<P>::type>(detail::AsString(*first));
             auto g = [&](auto ... pars){ f(p, pars...); };
             Select<decltype(g), Args...>::Exec(g, std::next(first), last);
         }
@@ -830,15 +1821,28 @@ namespace cli
         }
 
         bool Exec(const std::vector< std::string >& cmdLine, CliSession& session) override
+        {
+            const auto& tokens = detail::ToTokens(cmdLine);
+            return Exec(detail::CmdLine(tokens), session);
+        }
+
+        bool Exec(const detail::CmdLine& cmdLine, CliSession& session) override
         {
             if (!IsEnabled()) return false;
             const std::size_t paramSize = sizeof...(Args);
             if (cmdLine.size() != paramSize+1) return false;
-            if (Name() == cmdLine[0])
+            if (MatchesName(cmdLine))
             {
                 try
                 {
-                    auto g = [&](auto ... pars){ func( session.OutStream(), pars... ); };
+                    detail::TraceSpan conversion(session, TraceStage::conversion, Name());
+                    auto g = [&](auto ... pars)
+                    {
+                        conversion.End();
+                        detail::DeadlineScope deadline(session, GetDeadline());
+                        detail::TraceSpan handler(session, TraceStage::handler, Name());
+                        detail::CallHandler(session, [&](){ return func( session.OutStream(), pars... ); });
+                    };
                     Select<decltype(g), Args...>::Exec(g, std::next(cmdLine.begin()), cmdLine.end());
                 }
                 catch (std::bad_cast&)
@@ -888,12 +1892,23 @@ namespace cli
         }
 
         bool Exec(const std::vector< std::string >& cmdLine, CliSession& session) override
+        {
+            const auto& tokens = detail::ToTokens(cmdLine);
+            return Exec(detail::CmdLine(tokens), session);
+        }
+
+        bool Exec(const detail::CmdLine& cmdLine, CliSession& session) override
         {
             if (!IsEnabled()) return false;
             assert(!cmdLine.empty());
-            if (Name() == cmdLine[0])
+            if (MatchesName(cmdLine))
             {
-                func(session.OutStream(), std::vector<std::string>(std::next(cmdLine.begin()), cmdLine.end()));
+                detail::DeadlineScope deadline(session, GetDeadline());
+                detail::TraceSpan handler(session, TraceStage::handler, Name());
+                detail::CallHandler(session, [&]()
+                {
+                    return func(session.OutStream(), std::vector<std::string>(std::next(cmdLine.begin()), cmdLine.end()));
+                });
                 return true;
             }
             return false;
@@ -915,6 +1930,15 @@ namespace cli
     };
 
 
+    // ********************************************************************
+
+    // Cli implementation
+
+    inline const std::shared_ptr<detail::SymbolTable>& Cli::Symbols() const
+    {
+        return rootMenu->Symbols();
+    }
+
     // ********************************************************************
 
     // CliSession implementation
@@ -923,12 +1947,24 @@ namespace cli
             cli(_cli),
             current(cli.RootMenu()),
             globalScopeMenu(std::make_unique< Menu >()),
-            out(_out),
-            history(historySize)
+            target(_out),
+            buffer(_out.rdbuf()),
+            out(&buffer),
+            history(historySize),
+            log(historySize),
+            id(NewId()),
+            state(std::make_shared<detail::SessionState>(id, std::chrono::system_clock::now()))
         {
-            history.LoadCommands(cli.GetCommands());
-
-            cli.Register(out);
+            state->MenuPath(current->Path());
+            const auto entries = cli.GetEntries(historyKey);
+            history.LoadCommands(detail::CommandsOf(entries));
+            log.Load(entries);
+
+            out.copyfmt(target);
+            out.pword(detail::SessionBufferIndex()) = &buffer;
+            cli.Register(target);
+            cli.Add(*this);
+            globalScopeMenu->Intern(cli.Symbols());
             globalScopeMenu->Insert(
                 "help",
                 [this](std::ostream&){ Help(); },
@@ -942,34 +1978,735 @@ namespace cli
 #ifdef CLI_HISTORY_CMD
             globalScopeMenu->Insert(
                 "history",
-                [this](std::ostream&){ ShowHistory(); },
-                "Show the history"
+                [this](std::ostream&, std::vector<std::string> query){ ShowHistory(query); },
+                "Show the history, or the commands: slowest [n], failures, since <n>[s|m|h]",
+                {"query"}
+            );
+#endif
+#ifndef CLI_NO_ALIAS_CMDS
+            globalScopeMenu->Insert(
+                "alias",
+                [this](std::ostream&, std::vector<std::string> args){ AliasCmd(std::move(args)); },
+                "Define an alias (commands separated by \";\", with the parameters $1, $2, ..., $*) or show the aliases",
+                {"name", "commands"}
+            );
+            globalScopeMenu->Insert(
+                "unalias",
+                [this](std::ostream&, const std::string& name){ return UnaliasCmd(name); },
+                "Remove an alias",
+                {"name"}
+            );
+#endif
+#ifndef CLI_NO_BENCHMARK_CMDS
+            globalScopeMenu->Insert(
+                "time",
+                [this](std::ostream&, std::vector<std::string> args){ Time(std::move(args)); },
+                "Execute a command and show its execution time and output size",
+                {"command"}
+            );
+            globalScopeMenu->Insert(
+                "repeat",
+                [this](std::ostream&, std::vector<std::string> args){ Repeat(std::move(args)); },
+                "Execute a command n times (up to 1000000) and show the min, median, max and mean execution time",
+                {"n", "command"}
             );
 #endif
+            if (cli.sourceCommand)
+            {
+                globalScopeMenu->Insert(
+                    "source",
+                    [this](std::ostream&, const std::string& file)
+                    {
+                        std::string path;
+                        if (!SourcePath(file, path))
+                        {
+                            out << "source: " << file << " is not in the source directory\n";
+                            return Status(Status::failed, "source " + file + " not allowed");
+                        }
+                        return Source(path) ? Status() : Status(Status::failed, "source " + file + " failed");
+                    },
+                    "Execute the commands of a file",
+                    {"file"}
+                ).SetRoles(cli.sourceCommandRoles);
+            }
+            if (cli.sessionCommands)
+            {
+                globalScopeMenu->Insert(
+                    "sessions",
+                    [this](std::ostream&){ ShowSessions(); },
+                    "Show the sessions"
+                ).SetRoles(cli.sessionCommandRoles);
+                globalScopeMenu->Insert(
+                    "kill-session",
+                    [this](std::ostream&, std::size_t sessionId){ return KillSession(sessionId); },
+                    "Close a session",
+                    {"id"}
+                ).SetRoles(cli.sessionCommandRoles);
+            }
         }
 
     inline void CliSession::Feed(const std::string& cmd)
     {
-        std::vector<std::string> strs;
-        detail::split(strs, cmd);
+        // everything allocated for this command is released at the end of the scope
+        detail::CommandMemory::Scope scope(memory);
+
+        auto strs = memory.MakeTokens();
+        std::vector<std::size_t> operators; // "&&" and "||", only in the scripts
+        std::vector<std::size_t> quoted; // the tokens not expanded by the scripts
+        {
+            detail::TraceSpan span(*this, TraceStage::tokenize, cmd);
+            if (cli.Scripting())
+                detail::split(strs, operators, quoted, cmd);
+            else
+                detail::split(strs, cmd);
+        }
+        if (!remoteTraffic)
+            state->bytesIn += cmd.size() + 1; // with the end of line
         if (strs.empty()) return; // just hit enter
 
         history.NewCommand(cmd); // add anyway to history
+        Run(cmd, strs, operators, quoted, true);
+    }
+
+    // Executes a line of a file (see Source): like Feed,
+    // but the line goes neither in the history nor in the command log
+    inline void CliSession::SourceLine(const std::string& cmd)
+    {
+        detail::CommandMemory::Scope scope(memory);
+
+        auto strs = memory.MakeTokens();
+        std::vector<std::size_t> operators;
+        std::vector<std::size_t> quoted;
+        {
+            detail::TraceSpan span(*this, TraceStage::tokenize, cmd);
+            if (cli.Scripting())
+                detail::split(strs, operators, quoted, cmd);
+            else
+                detail::split(strs, cmd);
+        }
+        if (strs.empty() || strs[0][0] == '#') return; // empty line or comment
+        Run(cmd, strs, operators, quoted, false);
+    }
+
+    // Executes a line split in tokens: the script statements, the aliases and
+    // the commands. If logged, the line goes in the command log with its result
+    // (a block of the script with its first line, and the commands it executes).
+    template <typename Tokens>
+    inline void CliSession::Run(const std::string& cmd, Tokens& strs, const std::vector<std::size_t>& operators,
+                                const std::vector<std::size_t>& quoted, bool logged)
+    {
+        // the script statements run when they're complete
+        using Line = detail::Script::Line;
+        auto line = Line::command;
+        std::string header; // of the block completed by this line
+        if (cli.Scripting())
+        {
+            const bool inBlock = script.Pending();
+            line = script.Add(strs, operators, quoted);
+            if (line == Line::error)
+                out << script.Error() << "\n";
+            if (line == Line::incomplete && !inBlock)
+                blockHeader = cmd;
+            if (line == Line::error || line == Line::incomplete)
+                return;
+            if (line == Line::complete && inBlock)
+                header = std::move(blockHeader);
+        }
+        ++state->commands;
+
+        OutputBatch batch(*this);
+        CpuScope cpu(*this);
+
+        bool ok = false;
+        try
+        {
+            ok = Record(header.empty() ? cmd : header, logged, [&]()
+            {
+                return (line == Line::complete) ? RunScript(logged) : RunChain(strs, operators, cmd);
+            });
+        }
+        catch (...)
+        {
+            ++cli.failedCommands;
+            throw;
+        }
+        if (!ok) ++cli.failedCommands;
+        if (statusLine)
+            out << "%status " << lastStatus.code << (lastStatus.message.empty() ? "" : " ") << lastStatus.message << "\n";
+    }
+
+    // Executes f (returning true if it succeeded) and records it as the command
+    // text: in the command log (if logged) and in the audit.
+    template <typename F>
+    inline bool CliSession::Record(const std::string& text, bool logged, F&& f)
+    {
+        const bool audit = cli.GetAuditSink() || cli.SlowCommandThreshold().count() > 0;
+        // the command can change the current menu
+        std::string menuPath;
+        if (audit) menuPath = current->Path();
+        const auto time = std::chrono::system_clock::now();
+        const auto start = std::chrono::steady_clock::now();
+        const auto elapsed = [start]()
+        {
+            return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        };
+        const auto run = [&]()
+        {
+            const bool ok = f();
+            // e.g. a script whose last command is the condition of an if
+            if (ok != lastStatus.Ok())
+                lastStatus = ok ? Status() : Status(Status::failed);
+            return ok;
+        };
+        bool ok = false;
+        try
+        {
+            if (logged)
+            {
+                const auto entry = log.Add(text, time);
+                detail::OutputCounter counter(out);
+                try
+                {
+                    ok = run();
+                }
+                catch (...)
+                {
+                    log.Complete(entry, elapsed(), counter.Count(), false);
+                    throw;
+                }
+                log.Complete(entry, elapsed(), counter.Count(), ok);
+            }
+            else
+                ok = run();
+        }
+        catch (...)
+        {
+            lastStatus = Status(Status::failed);
+            if (audit) Audit(text, std::move(menuPath), time, start);
+            throw;
+        }
+        if (audit) Audit(text, std::move(menuPath), time, start);
+        return ok;
+    }
+
+    inline bool CliSession::Dispatch(const detail::CmdLine& cmdLine, Menu* scope)
+    {
+        CommandScope command(*this, cmdLine[0]);
+        detail::TraceSpan span(*this, TraceStage::dispatch);
+
+        // command given with its absolute path
+        if (scope)
+        {
+            if (!cmdLine[0].empty())
+                return scope->ExecSubCmds(cmdLine, *this);
+            // the path of a menu (e.g. "/" or "/net/if/")
+            if (cmdLine.size() > 1)
+                return false;
+            Current(scope);
+            return true;
+        }
 
         // global cmds check
-        bool found = globalScopeMenu->ScanCmds(strs, *this);
+        bool found = globalScopeMenu->ScanCmds(cmdLine, *this);
 
         // root menu recursive cmds check
-        if (!found) found = current -> ScanCmds(std::move(strs), *this); // last use of strs
+        if (!found) found = current -> ScanCmds(cmdLine, *this);
+
+        return found;
+    }
+
+    // Executes a command already split in tokens (see Prepare and Dispatch),
+    // setting the status of the session (see LastStatus).
+    // Returns false if the command is not found.
+    template <typename Tokens>
+    inline bool CliSession::Execute(Tokens& tokens)
+    {
+        Menu* pathMenu = nullptr;
+        auto symbols = memory.MakeVector<detail::SymbolId>();
+        const bool resolved = Prepare(tokens, symbols, pathMenu);
+        return ExecutePrepared(detail::CmdLine(tokens, symbols), pathMenu, resolved);
+    }
+
+    // Executes a command prepared by Prepare (resolved is its result),
+    // as Execute does: a command can be prepared once and executed many times
+    inline bool CliSession::ExecutePrepared(const detail::CmdLine& cmdLine, Menu* pathMenu, bool resolved)
+    {
+        lastStatus = Status(); // unless the handler returns another one
+        try
+        {
+            if (resolved && Dispatch(cmdLine, pathMenu))
+                return true;
+        }
+        catch (const CommandError& e)
+        {
+            lastStatus = Status(e.Code(), e.what());
+            out << e.what() << "\n";
+            return true;
+        }
+        lastStatus = Status(Status::notFound, "wrong command");
+        return false;
+    }
+
+    // Executes the commands of a line, separated by "&&" (the next one runs
+    // only if the previous succeeded) or "||" (only if it failed), like a shell.
+    // operators are the positions of the "&&" and "||" not quoted (see detail::split),
+    // text is the line, for the error message (if empty, the tokens are used).
+    // Returns true if the last command executed succeeded.
+    template <typename Tokens>
+    inline bool CliSession::RunChain(Tokens& tokens, const std::vector<std::size_t>& operators, const std::string& text)
+    {
+        if (operators.empty())
+            return RunCommand(tokens, text);
+
+        // a line like "&& cmd" or "cmd &&" is rejected before running anything
+        const bool missing = operators.front() == 0 || operators.back() + 1 == tokens.size() ||
+            std::adjacent_find(operators.begin(), operators.end(), [](std::size_t a, std::size_t b){ return b == a + 1; })
+                != operators.end();
+        if (missing)
+        {
+            WrongCommand(tokens, text);
+            lastStatus = Status(Status::notFound, "wrong command");
+            return false;
+        }
+
+        auto command = memory.MakeTokens();
+        std::size_t begin = 0;
+        for (std::size_t op = 0; ; ++op)
+        {
+            const auto end = op < operators.size() ? operators[op] : tokens.size();
+            command.assign(tokens.begin() + begin, tokens.begin() + end);
+            const bool ok = RunCommand(command, {});
+            // the next command to run, skipping the ones after "&&" if ok is false (or after "||" if true)
+            while (op < operators.size() && (tokens[operators[op]] == "&&") != ok)
+                ++op;
+            if (op == operators.size()) return ok;
+            begin = operators[op] + 1;
+        }
+    }
+
+    // Executes a command or an alias, printing an error message if it's not found.
+    // Returns true if it succeeded.
+    template <typename Tokens>
+    inline bool CliSession::RunCommand(Tokens& tokens, const std::string& text)
+    {
+        if (HasAliases())
+            if (auto alias = FindAlias(detail::AsString(tokens[0])))
+            return RunAlias(*alias, tokens);
+        if (Execute(tokens))
+            return lastStatus.Ok();
+        WrongCommand(tokens, text);
+        return false;
+    }
 
-        if (!found) // error msg if not found
-            out << "wrong command: " << cmd << "\n";
+    // Prints the error for a command not found: text is the command line
+    // (if empty, the tokens are used)
+    template <typename Tokens>
+    inline void CliSession::WrongCommand(const Tokens& tokens, const std::string& text)
+    {
+        if (WrongSourceLine()) return;
+        out << "wrong command:";
+        if (text.empty())
+            for (const auto& t: tokens)
+                out << ' ' << t;
+        else
+            out << ' ' << text;
+        out << "\n";
+    }
 
-        return;
+    // Prints the error for a command not found in a line of a file (see Source)
+    // with the position of the line, not to show the content of the file.
+    // Returns false if no file is in execution.
+    inline bool CliSession::WrongSourceLine()
+    {
+        if (sourceFile == nullptr) return false;
+        out << "wrong command at " << *sourceFile << ':' << sourceLineNumber << "\n";
+        return true;
     }
 
+    // Executes the commands of an alias (tokens is the command line invoking it),
+    // stopping at the first one not found or failed.
+    // Returns true if all of them succeeded.
+    template <typename Tokens>
+    inline bool CliSession::RunAlias(const detail::Macro& alias, const Tokens& tokens)
+    {
+        const auto args = detail::CmdLine(tokens).Tail();
+        if (args.size() < alias.Parameters())
+        {
+            out << tokens[0] << ": " << alias.Parameters() << " arguments expected\n";
+            lastStatus = Status(Status::failed, "missing arguments");
+            return false;
+        }
+        auto command = memory.MakeTokens();
+        for (std::size_t i = 0; i < alias.Size(); ++i)
+        {
+            alias.Expand(i, args, command);
+            if (command.empty()) continue; // e.g. just "$*", without arguments
+            if (!Execute(command))
+            {
+                if (!WrongSourceLine())
+                    out << "wrong command: " << command[0] << " (in " << tokens[0] << ")\n";
+                return false;
+            }
+            if (!lastStatus.Ok()) return false;
+        }
+        return true;
+    }
+
+    // The path of a file for the command "source": file must be a relative path,
+    // without "..", in the directory given to Cli::SourceCommand.
+    // Returns false if it's not.
+    inline bool CliSession::SourcePath(const std::string& file, std::string& path) const
+    {
+        if (file.empty() || file[0] == '/' || file[0] == '\\' || file.find(':') != std::string::npos)
+            return false;
+        std::size_t begin = 0;
+        while (begin <= file.size())
+        {
+            auto end = file.find_first_of("/\\", begin);
+            if (end == std::string::npos) end = file.size();
+            if (file.compare(begin, end - begin, "..") == 0)
+                return false;
+            begin = end + 1;
+        }
+        const auto& directory = cli.sourceDirectory;
+        if (directory.empty() || directory == ".")
+            path = file;
+        else
+            path = directory.back() == '/' ? directory + file : directory + '/' + file;
+        return true;
+    }
+
+    inline bool CliSession::Source(const std::string& fileName)
+    {
+        std::ifstream in(fileName, std::ios_base::binary);
+        if (!in)
+        {
+            out << "source: cannot open " << fileName << "\n";
+            return false;
+        }
+        if (sourceDepth == maxSourceDepth)
+        {
+            out << "source: too many nested files\n";
+            return false;
+        }
+        if (sourceDepth == 0) cancelSource = false;
+
+        SourceProgress progress;
+        progress.file = fileName;
+        in.seekg(0, std::ios_base::end);
+        progress.size = static_cast<std::size_t>(in.tellg());
+        in.seekg(0);
+
+        auto lastReport = std::chrono::steady_clock::now();
+        const auto report = [&](bool done)
+        {
+            progress.done = done;
+            if (sourceReport)
+                sourceReport(progress);
+            else if (!done)
+                out << "source " << fileName << ": " << progress.lines << " lines, "
+                    << (progress.size ? progress.bytes * 100 / progress.size : 100) << "%\n";
+            // sends the output of the lines executed until now
+            OnOutputEnd();
+            OnOutputBegin();
+        };
+
+        ++sourceDepth;
+        const auto previousFile = sourceFile;
+        const auto previousLine = sourceLineNumber;
+        sourceFile = &fileName;
+        const auto restore = [&]()
+        {
+            --sourceDepth;
+            sourceFile = previousFile;
+            sourceLineNumber = previousLine;
+        };
+        try
+        {
+            std::vector<char> buffer(sourceChunk);
+            std::string line; // the part of the line in the previous chunks
+            while (!cancelSource && in)
+            {
+                in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                const auto size = static_cast<std::size_t>(in.gcount());
+                std::size_t begin = 0;
+                for (auto end = begin; !cancelSource && end < size; ++end)
+                {
+                    if (buffer[end] != '\n') continue;
+                    line.append(buffer.data() + begin, end - begin);
+                    progress.bytes += line.size() + 1;
+                    begin = end + 1;
+                    if (!line.empty() && line.back() == '\r') line.pop_back();
+                    sourceLineNumber = progress.lines + 1;
+                    SourceLine(line);
+                    line.clear();
+                    ++progress.lines;
+                    if (stopOnError && !lastStatus.Ok()) cancelSource = true;
+                    const auto now = std::chrono::steady_clock::now();
+                    if (now - lastReport >= sourceInterval)
+                    {
+                        lastReport = now;
+                        report(false);
+                    }
+                }
+                line.append(buffer.data() + begin, size - begin);
+            }
+            if (!cancelSource && !line.empty()) // the last line, without end of line
+            {
+                progress.bytes += line.size();
+                if (line.back() == '\r') line.pop_back();
+                sourceLineNumber = progress.lines + 1;
+                SourceLine(line);
+                ++progress.lines;
+            }
+        }
+        catch (...)
+        {
+            restore();
+            throw;
+        }
+        restore();
+
+        if (script.Pending()) // a block not closed in the file
+        {
+            script.Discard();
+            out << "source " << fileName << ": missing end\n";
+        }
+        report(true);
+        return !cancelSource && !in.bad();
+    }
+
+    // Runs the script statement completed by the last line (see Cli::Scripting),
+    // recording each command executed (see Record).
+    // Returns false if any of its commands failed.
+    inline bool CliSession::RunScript(bool logged)
+    {
+        const bool ok = script.Run(
+            [this, logged](std::vector<detail::Token>& tokens, const std::vector<std::size_t>& operators)
+            {
+                // the memory of each command of the loops is released after it
+                detail::CommandMemory::Scope scope(memory);
+                std::string text;
+                for (const auto& t: tokens)
+                    text += (text.empty() ? "" : " ") + t;
+                return Record(text, logged, [&](){ return RunChain(tokens, operators, {}); });
+            },
+            stopOnError
+        );
+        if (!script.Error().empty())
+            out << script.Error() << "\n";
+        return ok;
+    }
+
+    // Prepares the tokens of a command for Dispatch: resolves its absolute
+    // path (if any) in pathMenu and the abbreviations, and looks up the
+    // symbols of the tokens in command position (the command names are
+    // compared by symbol, the parameters are not looked up).
+    // Returns false if the path does not exist.
+    template <typename Tokens, typename Symbols>
+    inline bool CliSession::Prepare(Tokens& tokens, Symbols& symbols, Menu*& pathMenu) const
+    {
+        symbols.resize(tokens.size());
+
+        // absolute path of a command (e.g. "/net/if/show")
+        if (tokens[0].size() > 0 && tokens[0][0] == '/')
+        {
+            pathMenu = ResolvePath(tokens[0]);
+            if (!pathMenu) return false;
+        }
+
+        if (cli.AbbreviatedCommands())
+            ExpandAbbreviations(tokens, pathMenu);
+
+        cli.Symbols()->Find(tokens.begin(), tokens.end(), symbols.begin());
+        return true;
+    }
+
+    // Resolves the absolute path of a command (e.g. "/net/if/show") walking
+    // the name indexes of the menus from the root menu.
+    // Returns the menu of the command and leaves its name in token
+    // (nullptr if the path does not exist or is not visible).
+    inline Menu* CliSession::ResolvePath(detail::Token& token) const
+    {
+        const bool abbreviations = cli.AbbreviatedCommands();
+        const bool ignoreCase = abbreviations && cli.AbbreviationsIgnoreCase();
+        Menu* menu = cli.RootMenu();
+        if (!menu->IsVisible(roles)) return nullptr;
+        std::size_t begin = 1;
+        for (auto end = token.find('/', begin); end != std::string::npos; begin = end+1, end = token.find('/', begin))
+        {
+            Menu::CmdMatch match;
+            menu->FindCmds(std::string(token.data() + begin, end - begin), ignoreCase, roles, match);
+            if (!(abbreviations ? match.Unique() : match.exact)) return nullptr;
+            menu = match.value;
+            if (!menu || !menu->IsVisible(roles)) return nullptr;
+        }
+        token.erase(0, begin);
+        return menu;
+    }
+
+    // Replaces the unique prefixes of commands and menus with their names,
+    // following the menus in the same way Dispatch does
+    // (or from the menu scope, for the absolute paths)
+    template <typename Container>
+    inline void CliSession::ExpandAbbreviations(Container& tokens, const Menu* scope) const
+    {
+        const bool ignoreCase = cli.AbbreviationsIgnoreCase();
+        Menu::CmdMatch match;
+        if (scope)
+        {
+            if (tokens[0].empty()) return;
+            scope->FindCmds(detail::AsString(tokens[0]), ignoreCase, roles, match);
+        }
+        else
+        {
+            const auto& name = detail::AsString(tokens[0]);
+            globalScopeMenu->ScanCmds(name, ignoreCase, roles, match);
+            current->ScanCmds(name, ignoreCase, roles, match);
+        }
+        for (std::size_t i = 0; match.Unique(); )
+        {
+            tokens[i] = match.name;
+            // the tokens after a command are its parameters
+            const Menu* menu = match.value;
+            if (!menu || ++i == tokens.size()) return;
+            match = {};
+            menu->FindCmds(detail::AsString(tokens[i]), ignoreCase, roles, match);
+        }
+    }
+
+    // Sends the record of the command to the audit sink and,
+    // if it's slow, to the slow command log
+    inline void CliSession::Audit(const std::string& cmd, std::string menuPath,
+                                  std::chrono::system_clock::time_point time,
+                                  std::chrono::steady_clock::time_point start)
+    {
+        AuditRecord record;
+        record.time = time;
+        record.sessionId = id;
+        record.peer = Peer();
+        record.menuPath = std::move(menuPath);
+        record.command = cmd;
+        record.executed = lastStatus.code != Status::notFound;
+        record.status = lastStatus.code;
+        record.duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        const auto threshold = cli.SlowCommandThreshold();
+        if (threshold.count() > 0 && record.duration >= threshold)
+            cli.SlowCommand(record);
+        if (auto sink = cli.GetAuditSink())
+            sink->Store(std::move(record));
+    }
+
+#ifndef CLI_NO_BENCHMARK_CMDS
+
+    inline void CliSession::Time(std::vector<std::string> args)
+    {
+        if (args.empty())
+        {
+            out << "usage: time <command>\n";
+            return;
+        }
+        auto tokens = memory.MakeTokens();
+        tokens.assign(std::make_move_iterator(args.begin()), std::make_move_iterator(args.end()));
+
+        const auto cpuStart = detail::ThreadCpuTime();
+        const auto start = std::chrono::steady_clock::now();
+        std::size_t bytes = 0;
+        {
+            detail::OutputCounter counter(out);
+            RunCommand(tokens, {});
+            bytes = counter.Count();
+        }
+        const auto real = std::chrono::steady_clock::now() - start;
+        const auto cpu = detail::ThreadCpuTime() - cpuStart;
+
+        if (lastStatus.code == Status::notFound)
+            return;
+        out << "real " << detail::FormatDuration(real)
+            << ", cpu " << detail::FormatDuration(cpu)
+            << ", output " << bytes << " bytes\n";
+    }
+
+    inline void CliSession::Repeat(std::vector<std::string> args)
+    {
+        std::size_t n = 0;
+        try
+        {
+            if (args.size() > 1)
+                n = detail::from_string<std::size_t>(args[0]);
+        }
+        catch (std::bad_cast&)
+        {
+        }
+        if (n == 0 || n > maxRepeat)
+        {
+            out << "usage: repeat <n> <command>\n";
+            return;
+        }
+        auto tokens = memory.MakeTokens();
+        tokens.assign(std::make_move_iterator(args.begin() + 1), std::make_move_iterator(args.end()));
+
+        // the command is parsed once, and executed n times
+        // (an alias is expanded at each run, as RunCommand does)
+        std::shared_ptr<const detail::Macro> alias;
+        if (HasAliases())
+            alias = FindAlias(detail::AsString(tokens[0]));
+        Menu* pathMenu = nullptr;
+        auto symbols = memory.MakeVector<detail::SymbolId>();
+        bool resolved = true;
+        if (alias)
+            symbols.resize(tokens.size()); // (the command line is not used)
+        else
+            resolved = Prepare(tokens, symbols, pathMenu);
+        const detail::CmdLine cmdLine(tokens, symbols);
+
+        // min, max and mean on all the runs, the median on a uniform sample
+        // of at most repeatSamples runs (reservoir sampling)
+        using Duration = std::chrono::steady_clock::duration;
+        Duration min = Duration::max();
+        Duration max = Duration::zero();
+        Duration sum = Duration::zero();
+        std::vector<Duration> sample;
+        std::minstd_rand random;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            // past the deadline of the command (see Cancelled) the runs left are dropped
+            if (Cancelled(out))
+                return;
+            const auto start = std::chrono::steady_clock::now();
+            if (alias)
+                RunAlias(*alias, tokens);
+            else if (!ExecutePrepared(cmdLine, pathMenu, resolved))
+                WrongCommand(tokens, {});
+            if (!lastStatus.Ok()) // not found or failed (the error is shown)
+                return;
+            const auto t = std::chrono::steady_clock::now() - start;
+            min = std::min(min, t);
+            max = std::max(max, t);
+            sum += t;
+            if (sample.size() < repeatSamples)
+                sample.push_back(t);
+            else
+            {
+                const auto j = std::uniform_int_distribution<std::size_t>(0, i)(random);
+                if (j < repeatSamples) sample[j] = t;
+            }
+        }
+
+        std::sort(sample.begin(), sample.end());
+        const auto m = sample.size();
+        const auto median = (sample[(m-1)/2] + sample[m/2]) / 2;
+        out << n << " runs: min " << detail::FormatDuration(min)
+            << ", median " << detail::FormatDuration(median)
+            << ", max " << detail::FormatDuration(max)
+            << ", mean " << detail::FormatDuration(sum / static_cast<Duration::rep>(n)) << "\n";
+    }
+
+#endif // CLI_NO_BENCHMARK_CMDS
+
     inline void CliSession::Prompt()
     {
+        OutputBatch batch(*this);
         out << beforePrompt
             << current->Prompt()
             << afterPrompt
@@ -977,19 +2714,235 @@ namespace cli
             << std::flush;
     }
 
+    inline std::size_t CliSession::PromptSize() const
+    {
+        return current->Prompt().size() + 2; // "> "
+    }
+
+    inline void CliSession::HistoryKey(const std::string& key)
+    {
+        if (key == historyKey) return;
+        // the commands executed until now go with the old key
+        const auto done = log.NewEntries();
+        if (!done.empty())
+            cli.StoreEntries(historyKey, done);
+        historyKey = key;
+        const auto entries = cli.GetEntries(historyKey);
+        history.Reset(detail::CommandsOf(entries));
+        log.Load(entries);
+    }
+
+#ifndef CLI_NO_ALIAS_CMDS
+
+    inline void CliSession::AliasCmd(std::vector<std::string> args)
+    {
+        if (args.size() > 1)
+        {
+            const auto& tokens = detail::ToTokens(args);
+            aliases.Define(args[0], detail::CmdLine(tokens).Tail());
+            return;
+        }
+        // the aliases of the session, then the ones of the cli not overridden
+        auto list = aliases.List();
+        for (auto& a: cli.Aliases())
+            if (!aliases.Find(a.first))
+                list.push_back(std::move(a));
+        bool found = false;
+        for (const auto& a: list)
+        {
+            if (!args.empty() && a.first != args[0]) continue;
+            out << a.first << " = " << a.second << '\n';
+            found = true;
+        }
+        if (!found && !args.empty())
+            out << "no alias " << args[0] << '\n';
+    }
+
+    inline Status CliSession::UnaliasCmd(const std::string& name)
+    {
+        if (Unalias(name))
+            return {};
+        out << "no alias " << name << '\n';
+        return {Status::failed, "no alias"};
+    }
+
+#endif
+
+    inline void CliSession::ShowHistory(const std::vector<std::string>& query) const
+    {
+        if (query.empty())
+        {
+            ShowHistory();
+            return;
+        }
+        const auto usage = [this]() { out << "usage: history [slowest [n] | failures | since <n>[s|m|h]]\n"; };
+        // e.g. "42" or "42m"
+        const auto number = [](const std::string& s, std::size_t& n, char& unit)
+        {
+            std::size_t digits = 0;
+            n = 0;
+            while (digits < s.size() && std::isdigit(static_cast<unsigned char>(s[digits])))
+                n = n * 10 + static_cast<std::size_t>(s[digits++] - '0');
+            unit = (digits + 1 == s.size()) ? s[digits] : '\0';
+            return digits > 0 && digits + 1 >= s.size();
+        };
+
+        std::vector<HistoryEntry> entries;
+        std::size_t n = 10;
+        char unit = '\0';
+        if (query[0] == "slowest" && query.size() <= 2)
+        {
+            if (query.size() == 2 && (!number(query[1], n, unit) || unit != '\0'))
+                return usage();
+            entries = log.Slowest(n);
+        }
+        else if (query[0] == "failures" && query.size() == 1)
+            entries = log.Failures();
+        else if (query[0] == "since" && query.size() == 2 && number(query[1], n, unit))
+        {
+            std::chrono::seconds d(n);
+            if (unit == 'm') d *= 60;
+            else if (unit == 'h') d *= 3600;
+            else if (unit != '\0' && unit != 's') return usage();
+            entries = log.Since(std::chrono::system_clock::now() - d);
+        }
+        else
+            return usage();
+
+        for (const auto& e: entries)
+        {
+            if (e.time.time_since_epoch().count() == 0)
+                out << std::left << std::setw(22) << "-";
+            else
+            {
+                const std::time_t t = std::chrono::system_clock::to_time_t(e.time);
+                std::tm tm{};
+#ifdef _WIN32
+                gmtime_s(&tm, &t);
+#else
+                gmtime_r(&t, &tm);
+#endif
+                out << std::put_time(&tm, "%Y-%m-%dT%H:%M:%SZ") << "  ";
+            }
+            out << std::right << std::setw(12) << detail::FormatDuration(e.duration)
+                << std::setw(10) << e.outputSize << "  " << std::left << std::setw(8)
+                << (e.success ? "ok" : "failed") << e.command << '\n' << std::right;
+        }
+    }
+
+    inline void CliSession::Current(Menu* menu)
+    {
+        current = menu;
+        state->MenuPath(current->Path());
+    }
+
+    inline std::vector<SessionInfo> Cli::Sessions() const
+    {
+        std::vector<std::shared_ptr<detail::SessionState>> states;
+        {
+            std::lock_guard<std::mutex> lock(sessionsMtx);
+            states.reserve(sessions.size());
+            for (const auto* s: sessions)
+                states.push_back(s->state);
+        }
+        std::vector<SessionInfo> result;
+        result.reserve(states.size());
+        for (const auto& s: states)
+            result.push_back(s->Info());
+        return result;
+    }
+
+    inline bool Cli::KillSession(std::size_t sessionId)
+    {
+        CliSession* session = nullptr;
+        std::shared_ptr<detail::SessionState> state;
+        {
+            std::lock_guard<std::mutex> lock(sessionsMtx);
+            auto i = std::find_if(sessions.begin(), sessions.end(), [sessionId](const CliSession* s){ return s->Id() == sessionId; });
+            if (i == sessions.end()) return false;
+            session = *i;
+            state = session->state;
+        }
+        // the task is dropped if the session closes in the meantime
+        return state->Run([session](){ session->Kill(); });
+    }
+
+    inline std::size_t Cli::Broadcast(const std::string& group, const std::string& text)
+    {
+        std::vector<std::pair<CliSession*, std::shared_ptr<detail::SessionState>>> members;
+        {
+            std::lock_guard<std::mutex> lock(sessionsMtx);
+            const std::vector<CliSession*>* list = &sessions;
+            if (!group.empty())
+            {
+                auto i = groups.find(group);
+                if (i == groups.end()) return 0;
+                list = &i->second;
+            }
+            members.reserve(list->size());
+            for (auto* s: *list)
+                members.emplace_back(s, s->state);
+        }
+        // each session writes on its stream in its own thread
+        // (the sessions closed in the meantime are skipped)
+        auto shared = std::make_shared<const std::string>(text);
+        std::size_t reached = 0;
+        for (const auto& m: members)
+        {
+            auto* s = m.first;
+            if (m.second->Run([s, shared](){ s->target.write(shared->data(), static_cast<std::streamsize>(shared->size())).flush(); }))
+                ++reached;
+        }
+        return reached;
+    }
+
+    inline void CliSession::ShowSessions() const
+    {
+        // e.g. "1:02:03"
+        const auto hms = [](std::chrono::seconds d)
+        {
+            const auto sec = d.count();
+            std::string s = std::to_string(sec / 3600) + ':';
+            s += (sec / 60 % 60 < 10 ? "0" : "") + std::to_string(sec / 60 % 60) + ':';
+            s += (sec % 60 < 10 ? "0" : "") + std::to_string(sec % 60);
+            return s;
+        };
+        const auto now = std::chrono::system_clock::now();
+        out << "  " << std::left << std::setw(6) << "id" << std::setw(22) << "peer" << std::setw(16) << "menu" << std::right
+            << std::setw(10) << "time" << std::setw(8) << "cmds" << std::setw(10) << "in" << std::setw(10) << "out"
+            << std::setw(10) << "pending" << std::setw(12) << "cpu" << '\n';
+        for (const auto& info: cli.Sessions())
+        {
+            const auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - info.start);
+            out << (info.id == id ? "* " : "  ") << std::left << std::setw(6) << info.id
+                << std::setw(22) << (info.peer.empty() ? "local" : info.peer) << std::setw(16) << info.menuPath << std::right
+                << std::setw(10) << hms(elapsed) << std::setw(8) << info.commands
+                << std::setw(10) << info.bytesIn << std::setw(10) << info.bytesOut << std::setw(10) << info.pendingOutput
+                << std::setw(12) << detail::FormatDuration(info.cpuTime) << '\n';
+        }
+    }
+
+    inline Status CliSession::KillSession(std::size_t sessionId)
+    {
+        if (cli.KillSession(sessionId))
+            return {};
+        out << "no session " << sessionId << "\n";
+        return {Status::failed, "no session"};
+    }
+
     inline void CliSession::Help() const
     {
         out << "Commands available:\n";
-        globalScopeMenu->MainHelp(out);
-        current -> MainHelp( out );
+        globalScopeMenu->MainHelp(out, roles);
+        current -> MainHelp( out, roles );
     }
 
     inline std::vector<std::string> CliSession::GetCompletions(std::string currentLine) const
     {
         // trim_left(currentLine);
         currentLine.erase(currentLine.begin(), std::find_if(currentLine.begin(), currentLine.end(), [](int ch) { return !std::isspace(ch); }));
-        auto v1 = globalScopeMenu->GetCompletions(currentLine);
-        auto v3 = current->GetCompletions(currentLine);
+        auto v1 = globalScopeMenu->GetCompletions(currentLine, roles);
+        auto v3 = current->GetCompletions(currentLine, roles);
         v1.insert(v1.end(), std::make_move_iterator(v3.begin()), std::make_move_iterator(v3.end()));
 
         // removes duplicates (std::unique requires a sorted container)
@@ -1000,36 +2953,49 @@ namespace cli
         return v1;
     }
 
+    inline std::shared_ptr<CompletionProvider> CliSession::GetCompletionProvider(std::string currentLine, std::string& head, std::string& params) const
+    {
+        currentLine = detail::TrimLeft(std::move(currentLine));
+        if (auto p = globalScopeMenu->GetCompletionProvider(currentLine, head, params, roles))
+            return p;
+        return current->GetCompletionProvider(currentLine, head, params, roles);
+    }
+
     // Menu implementation
 
 #ifdef CLI_DEPRECATED_API
     template < typename F, typename R >
     void Menu::Add( const std::string& name, const std::string& help, F& f,R (F::*)(std::ostream& out) const )
     {
+        index->Insert(name);
         cmds->push_back(std::make_shared<FuncCmd>(name, f, help));
     }
 
     template < typename F, typename R, typename A1 >
     void Menu::Add( const std::string& name, const std::string& help, F& f,R (F::*)(A1, std::ostream& out) const )
     {
+        index->Insert(name);
         cmds->push_back(std::make_shared<FuncCmd1<A1>>(name, f, help));
     }
 
     template < typename F, typename R, typename A1, typename A2 >
     void Menu::Add( const std::string& name, const std::string& help, F& f,R (F::*)(A1, A2, std::ostream& out) const )
     {
+        index->Insert(name);
         cmds->push_back(std::make_shared<FuncCmd2<A1, A2>>(name, f, help));
     }
 
     template < typename F, typename R, typename A1, typename A2, typename A3 >
     void Menu::Add( const std::string& name, const std::string& help, F& f,R (F::*)(A1, A2, A3, std::ostream& out) const )
     {
+        index->Insert(name);
         cmds->push_back(std::make_shared<FuncCmd3<A1, A2, A3>>(name, f, help));
     }
 
     template < typename F, typename R, typename A1, typename A2, typename A3, typename A4 >
     void Menu::Add( const std::string& name, const std::string& help, F& f,R (F::*)(A1, A2, A3, A4, std::ostream& out) const )
     {
+        index->Insert(name);
         cmds->push_back(std::make_shared<FuncCmd4<A1, A2, A3, A4>>(name, f, help));
     }
 #endif // CLI_DEPRECATED_API
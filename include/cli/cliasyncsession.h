@@ -48,6 +48,7 @@ public:
         CliSession(_cli, std::cout, 1),
         input(ios, ::dup( STDIN_FILENO))
     {
+        SetExecutor([ex = detail::asio::BoostExecutor(ios)](std::function<void()> task) mutable { ex.Post(std::move(task)); });
         Read();
     }
     ~CliAsyncSession()
@@ -68,7 +68,11 @@ public:
             if (in.eof())
                 Exit();
             else
+            {
                 Feed(line);
+                if (StopOnError() && !LastStatus().Ok())
+                    Exit();
+            }
         }
     }
 
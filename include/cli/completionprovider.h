@@ -0,0 +1,65 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_COMPLETIONPROVIDER_H_
+#define CLI_COMPLETIONPROVIDER_H_
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace cli
+{
+
+// Source of the completions for the parameters of a command
+// (see Command::SetCompletionProvider and CmdHandler::SetCompletionProvider).
+// The completions can be computed asynchronously: the interactive sessions
+// don't wait for them beyond their deadline (see CliSession::CompletionDeadline).
+class CompletionProvider
+{
+public:
+    // completions: candidates that replace the parameters typed by the user
+    // last: false for partial results, true for the final ones
+    using Callback = std::function<void(std::vector<std::string> completions, bool last)>;
+
+    virtual ~CompletionProvider() = default;
+
+    // Called when the user hits TAB after the command name.
+    // params is the text typed after the name (e.g. "10.0." for "ping 10.0.").
+    // The provider can invoke cb before returning or later, from any thread,
+    // one or more times (partial results), the last time with last=true.
+    // The session shows what it has received when the final results arrive or
+    // at the deadline: in the latter case, if nothing has been received yet,
+    // it uses the final results of the previous request.
+    virtual void Complete(const std::string& params, Callback cb) = 0;
+};
+
+} // namespace cli
+
+#endif // CLI_COMPLETIONPROVIDER_H_
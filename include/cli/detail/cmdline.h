@@ -0,0 +1,119 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_DETAIL_CMDLINE_H_
+#define CLI_DETAIL_CMDLINE_H_
+
+#include <cassert>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "commandmemory.h"
+#include "symboltable.h"
+
+namespace cli
+{
+namespace detail
+{
+
+// Non owning view of the tokens of a command line.
+// It lets the commands (and the submenus) pass the
+// rest of the line down without copying it.
+// Optionally, it carries also the symbol of each token
+// (see SymbolTable), to compare the command names as integers.
+class CmdLine
+{
+public:
+    using const_iterator = const Token*;
+
+    CmdLine(const_iterator _first, const_iterator _last, const SymbolId* _symbols = nullptr) :
+        first(_first), last(_last), symbols(_symbols)
+    {}
+
+    // any contiguous container of Token (std::vector, std::pmr::vector, ...)
+    template <typename C>
+    explicit CmdLine(const C& c) : first(c.data()), last(c.data() + c.size()), symbols(nullptr) {}
+
+    // the tokens and their symbols, in two contiguous containers of the same size
+    template <typename C, typename S>
+    CmdLine(const C& c, const S& s) : first(c.data()), last(c.data() + c.size()), symbols(s.data())
+    {
+        assert(c.size() == s.size());
+    }
+
+    const_iterator begin() const { return first; }
+    const_iterator end() const { return last; }
+    std::size_t size() const { return static_cast<std::size_t>(last - first); }
+    bool empty() const { return first == last; }
+
+    const Token& operator[](std::size_t i) const
+    {
+        assert(i < size());
+        return first[i];
+    }
+
+    bool HasSymbols() const { return symbols != nullptr; }
+
+    // the symbol of the i-th token (noSymbol if it's not a command name)
+    SymbolId SymbolAt(std::size_t i) const
+    {
+        assert(HasSymbols() && i < size());
+        return symbols[i];
+    }
+
+    // the command line without the first token
+    CmdLine Tail() const
+    {
+        assert(!empty());
+        return CmdLine(first + 1, last, symbols ? symbols + 1 : nullptr);
+    }
+
+    std::vector<std::string> ToVector() const { return std::vector<std::string>(first, last); }
+
+private:
+    const_iterator first;
+    const_iterator last;
+    const SymbolId* symbols;
+};
+
+// The tokens of a command line given as strings (e.g., to Command::Exec)
+// for a CmdLine: with std::pmr, a copy
+#ifdef CLI_HAS_PMR
+inline std::vector<Token> ToTokens(const std::vector<std::string>& strs)
+{
+    return std::vector<Token>(strs.begin(), strs.end());
+}
+#else
+inline const std::vector<std::string>& ToTokens(const std::vector<std::string>& strs) { return strs; }
+#endif
+
+} // namespace detail
+} // namespace cli
+
+#endif // CLI_DETAIL_CMDLINE_H_
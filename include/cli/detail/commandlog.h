@@ -0,0 +1,204 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_DETAIL_COMMANDLOG_H_
+#define CLI_DETAIL_COMMANDLOG_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <string>
+#include <vector>
+#include "../historyentry.h"
+
+namespace cli
+{
+namespace detail
+{
+
+// The last commands of a session with the result of their execution.
+// The results are kept in a compact record (16 bytes) next to the command,
+// and the entries added to the log are told apart from the ones loaded
+// from the history storage, so that only the former are stored again.
+class CommandLog
+{
+public:
+    explicit CommandLog(std::size_t size) : maxSize(size) {}
+
+    // entries[0] is the oldest one: replaces the content of the log
+    void Load(const std::vector<HistoryEntry>& entries)
+    {
+        commands.clear();
+        records.clear();
+        added = 0;
+        for (const auto& e: entries)
+            Push(e.command, ToRecord(e));
+    }
+
+    // Adds a command issued now, returning the id to complete it with the result
+    // (a command equal to the last one added replaces it, like in History)
+    std::size_t Add(const std::string& command, std::chrono::system_clock::time_point time)
+    {
+        Record r{};
+        r.time = std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+        if (added > 0 && !commands.empty() && commands.back() == command)
+            records.back() = r;
+        else
+        {
+            Push(command, r);
+            ++added;
+            ++last;
+        }
+        return last;
+    }
+
+    // Sets the result of the command with the given id, if it's still in the log
+    void Complete(std::size_t cmdId, std::chrono::microseconds duration, std::size_t outputSize, bool success)
+    {
+        const auto age = last - cmdId;
+        if (age >= added || age >= records.size()) return;
+        auto& r = records[records.size() - 1 - age];
+        r.duration = Saturate<std::uint32_t>(duration.count() < 0 ? 0 : duration.count());
+        r.output = Saturate<std::uint32_t>(outputSize, failedBit - 1) | (success ? 0u : std::uint32_t(failedBit));
+    }
+
+    std::size_t Size() const { return records.size(); }
+
+    // result[0] is the oldest entry
+    std::vector<HistoryEntry> Entries() const { return Range(0); }
+
+    // The entries added since the last Load (to be stored)
+    std::vector<HistoryEntry> NewEntries() const { return Range(records.size() - std::min(added, records.size())); }
+
+    // The n entries that took more time, the slowest first
+    std::vector<HistoryEntry> Slowest(std::size_t n) const
+    {
+        std::vector<std::size_t> positions(records.size());
+        for (std::size_t i = 0; i < positions.size(); ++i)
+            positions[i] = i;
+        n = std::min(n, positions.size());
+        std::partial_sort(positions.begin(), positions.begin() + static_cast<long>(n), positions.end(),
+            [this](std::size_t a, std::size_t b){ return records[a].duration > records[b].duration; });
+        std::vector<HistoryEntry> result;
+        for (std::size_t i = 0; i < n; ++i)
+            result.push_back(At(positions[i]));
+        return result;
+    }
+
+    // The entries of the commands not found or failed, the oldest first
+    std::vector<HistoryEntry> Failures() const
+    {
+        std::vector<HistoryEntry> result;
+        for (std::size_t i = 0; i < records.size(); ++i)
+            if (records[i].output & failedBit)
+                result.push_back(At(i));
+        return result;
+    }
+
+    // The entries of the commands issued from the given time, the oldest first
+    std::vector<HistoryEntry> Since(std::chrono::system_clock::time_point time) const
+    {
+        const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+        // the times are not decreasing, but for the entries without one (zero)
+        auto i = records.size();
+        while (i > 0 && records[i - 1].time >= ms)
+            --i;
+        return Range(i);
+    }
+
+private:
+    struct Record
+    {
+        std::int64_t time;     // ms since epoch (0 if unknown)
+        std::uint32_t duration; // us
+        std::uint32_t output;   // characters written, and failedBit
+    };
+    enum : std::uint32_t { failedBit = 0x80000000u };
+
+    template <typename T, typename U>
+    static T Saturate(U value, T max = std::numeric_limits<T>::max())
+    {
+        return static_cast<unsigned long long>(value) > max ? max : static_cast<T>(value);
+    }
+
+    static Record ToRecord(const HistoryEntry& e)
+    {
+        Record r;
+        r.time = std::chrono::duration_cast<std::chrono::milliseconds>(e.time.time_since_epoch()).count();
+        r.duration = Saturate<std::uint32_t>(e.duration.count() < 0 ? 0 : e.duration.count());
+        r.output = Saturate<std::uint32_t>(e.outputSize, failedBit - 1) | (e.success ? 0u : std::uint32_t(failedBit));
+        return r;
+    }
+
+    HistoryEntry At(std::size_t i) const
+    {
+        const auto& r = records[i];
+        HistoryEntry e;
+        e.command = commands[i];
+        e.time = std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::milliseconds(r.time)));
+        e.duration = std::chrono::microseconds(r.duration);
+        e.outputSize = r.output & ~failedBit;
+        e.success = (r.output & failedBit) == 0;
+        return e;
+    }
+
+    std::vector<HistoryEntry> Range(std::size_t from) const
+    {
+        std::vector<HistoryEntry> result;
+        result.reserve(records.size() - from);
+        for (auto i = from; i < records.size(); ++i)
+            result.push_back(At(i));
+        return result;
+    }
+
+    void Push(const std::string& command, const Record& r)
+    {
+        commands.push_back(command);
+        records.push_back(r);
+        if (records.size() > maxSize)
+        {
+            commands.pop_front();
+            records.pop_front();
+        }
+    }
+
+    const std::size_t maxSize;
+    std::deque<std::string> commands;
+    std::deque<Record> records;
+    std::size_t added = 0; // entries added since the last Load
+    std::size_t last = 0;  // id of the last entry added
+};
+
+} // namespace detail
+} // namespace cli
+
+#endif // CLI_DETAIL_COMMANDLOG_H_
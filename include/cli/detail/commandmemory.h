@@ -0,0 +1,171 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_DETAIL_COMMANDMEMORY_H_
+#define CLI_DETAIL_COMMANDMEMORY_H_
+
+// #define CLI_NO_PMR
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#if !defined(CLI_NO_PMR) && defined(__has_include)
+    #if __has_include(<memory_resource>) && \
+        ((defined(_MSVC_LANG) && _MSVC_LANG >= 201703L) || __cplusplus >= 201703L)
+        #define CLI_HAS_PMR
+    #endif
+#endif
+
+#ifdef CLI_HAS_PMR
+#include <memory_resource>
+#endif
+
+namespace cli
+{
+namespace detail
+{
+
+#ifdef CLI_HAS_PMR
+
+// A token of a command line: with std::pmr, the ones in a vector
+// made by CommandMemory::MakeTokens are allocated in the arena too
+// (a std::string longer than the small buffer would go to the heap)
+using Token = std::pmr::string;
+
+inline std::string AsString(const Token& s) { return std::string(s); }
+
+#else
+
+using Token = std::string;
+
+#endif
+
+// A token as a std::string (a copy only if it's not one)
+inline const std::string& AsString(const std::string& s) { return s; }
+
+// Memory used by a session for the lifetime of a single command line
+// (tokens, dispatch and completion temporaries).
+// When std::pmr is available it's a monotonic buffer that starts from
+// a block owned by the session and is reset after each command,
+// so that the work of a command is (mostly) a pointer bump and
+// doesn't touch the global heap.
+// Otherwise, it falls back to the standard allocator.
+class CommandMemory
+{
+public:
+    CommandMemory() = default;
+
+    // disable value semantics
+    CommandMemory(const CommandMemory&) = delete;
+    CommandMemory& operator = (const CommandMemory&) = delete;
+
+    // The memory is released when the outermost scope ends,
+    // so that a command executed from within another command
+    // doesn't invalidate the tokens of the latter.
+    // A nested scope (e.g., a line of a file or an iteration of a loop)
+    // allocates from its own arena, released when it ends: the memory
+    // doesn't grow with the commands executed by the outer one.
+    class Scope
+    {
+    public:
+        explicit Scope(CommandMemory& _memory) : memory(_memory)
+        {
+#ifdef CLI_HAS_PMR
+            if (memory.depth > 0)
+            {
+                outer = memory.current;
+                memory.current = &nested;
+            }
+#endif
+            ++memory.depth;
+        }
+        ~Scope()
+        {
+            if (--memory.depth == 0)
+                memory.Release();
+#ifdef CLI_HAS_PMR
+            else
+                memory.current = outer;
+#endif
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator = (const Scope&) = delete;
+    private:
+        CommandMemory& memory;
+#ifdef CLI_HAS_PMR
+        std::pmr::memory_resource* outer = nullptr;
+        std::pmr::monotonic_buffer_resource nested; // on the heap, when used
+#endif
+    };
+
+#ifdef CLI_HAS_PMR
+
+    template <typename T>
+    using Vector = std::pmr::vector<T>;
+
+    template <typename T>
+    Vector<T> MakeVector() { return Vector<T>(current); }
+
+    // the arena of the innermost scope
+    std::pmr::memory_resource* Resource() { return current; }
+
+    // give back all the memory allocated since the last release
+    void Release() { resource.release(); }
+
+private:
+    enum { initialSize = 4096 };
+    alignas(std::max_align_t) char initialBuffer[initialSize];
+    std::pmr::monotonic_buffer_resource resource{initialBuffer, initialSize};
+    std::pmr::memory_resource* current = &resource;
+
+#else
+
+    template <typename T>
+    using Vector = std::vector<T>;
+
+    template <typename T>
+    Vector<T> MakeVector() { return Vector<T>(); }
+
+    void Release() {}
+
+#endif
+
+public:
+    // the tokens of a command line
+    Vector<Token> MakeTokens() { return MakeVector<Token>(); }
+
+private:
+    std::size_t depth = 0;
+};
+
+} // namespace detail
+} // namespace cli
+
+#endif // CLI_DETAIL_COMMANDMEMORY_H_
@@ -0,0 +1,83 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_DETAIL_DEADLINE_H_
+#define CLI_DETAIL_DEADLINE_H_
+
+#include <chrono>
+#include <ostream>
+#include "sessionbuffer.h"
+
+namespace cli
+{
+namespace detail
+{
+
+// Applies a deadline to the output of the stream of a session during its lifetime
+class OutputDeadline
+{
+public:
+    OutputDeadline(std::ostream& _out, std::chrono::steady_clock::time_point deadline) :
+        out(_out),
+        buffer(*SessionBufferOf(_out)),
+        previous(buffer.Deadline())
+    {
+        buffer.Deadline(deadline);
+    }
+    ~OutputDeadline()
+    {
+        buffer.Deadline(previous);
+        // the writes after the deadline put the stream in a bad state
+        out.clear();
+    }
+
+    // disable value semantics
+    OutputDeadline(const OutputDeadline&) = delete;
+    OutputDeadline& operator = (const OutputDeadline&) = delete;
+
+    std::chrono::steady_clock::time_point Deadline() const { return buffer.Deadline(); }
+    bool Expired() { return buffer.Expired(); }
+
+private:
+    std::ostream& out;
+    SessionBuffer& buffer;
+    const std::chrono::steady_clock::time_point previous;
+};
+
+// Returns true if the output of out is past its deadline
+inline bool DeadlineExpired(std::ostream& out)
+{
+    auto* buffer = SessionBufferOf(out);
+    return buffer != nullptr && buffer->Expired();
+}
+
+} // namespace detail
+} // namespace cli
+
+#endif // CLI_DETAIL_DEADLINE_H_
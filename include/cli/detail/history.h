@@ -35,6 +35,7 @@
 #include <string>
 #include <algorithm>
 #include <cassert>
+#include <limits>
 
 namespace cli
 {
@@ -123,6 +124,16 @@ public:
             Insert(c);
     }
 
+    // Replaces the content of the history (as if just created) with cmds
+    void Reset(const std::vector<std::string>& cmds)
+    {
+        buffer.clear();
+        current = 0;
+        commands = 0;
+        mode = Mode::inserting;
+        LoadCommands(cmds);
+    }
+
     // result[0] is the oldest command, result[size-1] the newer
     std::vector<std::string> GetCommands() const
     {
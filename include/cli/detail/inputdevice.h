@@ -45,6 +45,7 @@ class InputDevice
 {
 public:
     using Handler = std::function< void( std::pair<KeyType,char> ) >;
+    using PasteHandler = std::function< void( const std::string& ) >;
 
     InputDevice(asio::BoostExecutor ex) : executor(ex) {}
     virtual ~InputDevice() = default;
@@ -52,6 +53,13 @@ public:
     template <typename H>
     void Register(H&& h) { handler = std::forward<H>(h); }
 
+    // the handler of the text pasted as a whole (bracketed paste)
+    template <typename H>
+    void RegisterPaste(H&& h) { pasteHandler = std::forward<H>(h); }
+
+    // the executor where the handler is invoked
+    asio::BoostExecutor& Executor() { return executor; }
+
 protected:
 
     void Notify(std::pair<KeyType,char> k)
@@ -59,10 +67,16 @@ protected:
         executor.Post([this,k](){ if (handler) handler(k); });
     }
 
+    void NotifyPaste(std::string text)
+    {
+        executor.Post([this,t=std::move(text)](){ if (pasteHandler) pasteHandler(t); });
+    }
+
 private:
 
     asio::BoostExecutor executor;
     Handler handler;
+    PasteHandler pasteHandler;
 };
 
 } // namespace detail
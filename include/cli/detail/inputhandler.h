@@ -30,8 +30,14 @@
 #ifndef CLI_DETAIL_INPUTHANDLER_H_
 #define CLI_DETAIL_INPUTHANDLER_H_
 
+#include <algorithm>
+#include <cctype>
 #include <functional>
+#include <iterator>
+#include <map>
+#include <memory>
 #include <string>
+#include <vector>
 #include "terminal.h"
 #include "inputdevice.h"
 #include "../cli.h" // CliSession
@@ -47,19 +53,133 @@ class InputHandler
 public:
     InputHandler(CliSession& _session, InputDevice& kb) :
         session(_session),
-        terminal(session.OutStream())
+        terminal(session.OutStream()),
+        executor(kb.Executor()),
+        cache(std::make_shared<Cache>())
     {
+        // the tasks of the other threads (e.g., Cli::KillSession) run with the input
+        session.SetExecutor([ex = executor](std::function<void()> task) mutable { ex.Post(std::move(task)); });
         kb.Register( [this](auto key){ this->Keypressed(key); } );
+        kb.RegisterPaste( [this](const std::string& text){ this->Pasted(text); } );
     }
 
 private:
 
+    // the completions of a CompletionProvider are cached per provider
+    // (the cache does not keep the providers alive, and forgets the ones destroyed)
+    using Cache = std::map<
+        std::weak_ptr<CompletionProvider>,
+        std::vector<std::string>,
+        std::owner_less<std::weak_ptr<CompletionProvider>>>;
+
+    // a TAB waiting for the completions of a CompletionProvider
+    struct PendingCompletion
+    {
+        std::string line;     // the line when TAB was pressed
+        std::string head;     // the part of the line before the parameters
+        std::string params;   // the parameters typed
+        std::vector<std::string> completions; // the synchronous ones (commands)
+        std::vector<std::string> received;    // received from the provider so far
+        std::shared_ptr<CompletionProvider> provider;
+    };
+
     void Keypressed(std::pair<KeyType, char> k)
     {
+        // the line is changing: the results of a pending completion would be stale
+        pending.reset();
+        UpdateLayout();
         const std::pair<Symbol,std::string> s = terminal.Keypressed(k);
         NewCommand(s);
     }
 
+    // A pasted text is not typed: it's inserted in the line without per-key
+    // echo and completion, and every complete line of it is executed.
+    // The prompt is shown once after the last command, and the last
+    // (incomplete) line of the text remains in the line being edited.
+    void Pasted(const std::string& text)
+    {
+        pending.reset();
+        UpdateLayout();
+        bool executed = false;
+        std::size_t begin = 0;
+        for (;;)
+        {
+            const auto eol = text.find_first_of("\r\n", begin);
+            if (eol == std::string::npos)
+                break;
+            terminal.Insert(Printable(text, begin, eol));
+            const auto s = terminal.Keypressed(std::make_pair(KeyType::ret, ' '));
+            session.Feed(s.second);
+            // e.g. "exit": the rest of the text is dropped
+            if (session.Exited())
+                return;
+            executed = true;
+            begin = eol + 1;
+            if (text[eol] == '\r' && begin < text.size() && text[begin] == '\n')
+                ++begin;
+        }
+        if (executed)
+        {
+            session.Prompt();
+            UpdateLayout();
+        }
+        terminal.Insert(Printable(text, begin, text.size()));
+    }
+
+    // the terminal of the session can change size, and the prompt with the menu
+    // (the cursor sequences are not used on a terminal declared dumb)
+    void UpdateLayout()
+    {
+        const std::string& type = session.TerminalType();
+        const bool dumb = type.size() == 4 && std::equal(type.begin(), type.end(), "dumb",
+            [](char a, char b){ return std::tolower(static_cast<unsigned char>(a)) == b; });
+        terminal.Layout(dumb ? 0 : session.TerminalWidth(), session.PromptSize());
+    }
+
+    // the chars of text in [begin, end) that can stay in the line
+    static std::string Printable(const std::string& text, std::size_t begin, std::size_t end)
+    {
+        std::string result;
+        result.reserve(end - begin);
+        for (auto i = begin; i < end; ++i)
+        {
+            const auto c = static_cast<unsigned char>(text[i]);
+            if (c == '\t')
+                result += ' ';
+            else if (c >= 0x20 && c != 0x7F)
+                result += text[i];
+        }
+        return result;
+    }
+
+    // Shows the items in columns (sorted top to bottom) that fit the width
+    void ShowColumns(const std::vector<std::string>& items, std::size_t width)
+    {
+        std::size_t itemWidth = 0;
+        for (const auto& i: items)
+            itemWidth = std::max(itemWidth, i.size());
+        itemWidth += 2; // separator
+        const std::size_t columns = std::max<std::size_t>(1, width / itemWidth);
+        const std::size_t rows = (items.size() + columns - 1) / columns;
+
+        std::string out;
+        for (std::size_t r = 0; r < rows; ++r)
+        {
+            for (std::size_t c = 0; c < columns; ++c)
+            {
+                const auto i = c * rows + r;
+                if (i >= items.size())
+                    break;
+                out += items[i];
+                // no padding at the end of the row
+                if (c + 1 < columns && i + rows < items.size())
+                    out.append(itemWidth - items[i].size(), ' ');
+            }
+            out += '\n';
+        }
+        session.OutStream() << out;
+    }
+
     void NewCommand(const std::pair< Symbol, std::string >& s)
     {
         switch (s.first)
@@ -76,7 +196,8 @@ private:
             case Symbol::command:
             {
                 session.Feed(s.second);
-                session.Prompt();
+                if (!session.Exited())
+                    session.Prompt();
                 break;
             }
             case Symbol::down:
@@ -95,35 +216,143 @@ private:
                 auto line = terminal.GetLine();
                 auto completions = session.GetCompletions(line);
 
-                if (completions.empty())
-                    break;
-                if (completions.size() == 1)
-                {
-                    terminal.SetLine(completions[0]+' ');
-                    break;
-                }
+                std::string head;
+                std::string params;
+                auto provider = session.GetCompletionProvider(line, head, params);
+                if (provider)
+                    RequestCompletions(provider, line, head, params, std::move(completions));
+                else
+                    ShowCompletions(line, completions);
+                break;
+            }
+        }
+
+    }
+
+    // Asks the completions to the provider, without waiting for them:
+    // they're shown when the final ones arrive or at the deadline
+    void RequestCompletions(
+        const std::shared_ptr<CompletionProvider>& provider,
+        const std::string& line, const std::string& head, const std::string& params,
+        std::vector<std::string> completions)
+    {
+        auto request = std::make_shared<PendingCompletion>();
+        request->line = line;
+        request->head = head;
+        request->params = params;
+        request->completions = std::move(completions);
+        request->provider = provider;
+        pending = request;
 
-                auto commonPrefix = CommonPrefix(completions);
-                if (commonPrefix.size() > line.size())
+        std::weak_ptr<PendingCompletion> weakRequest = request;
+        std::weak_ptr<Cache> weakCache = cache;
+        std::weak_ptr<CompletionProvider> weakProvider = provider;
+        auto ex = executor;
+        // the provider can invoke the callback from any thread:
+        // the results are processed in the thread of the session
+        provider->Complete(params,
+            [this, ex, weakRequest, weakCache, weakProvider](std::vector<std::string> results, bool last) mutable
+            {
+                ex.Post([this, weakRequest, weakCache, weakProvider, results = std::move(results), last]() mutable
                 {
-                    terminal.SetLine(commonPrefix);
-                    break;
+                    // the cache outlives the pending request
+                    if (last)
+                        if (auto c = weakCache.lock())
+                        {
+                            DropExpired(*c);
+                            (*c)[weakProvider] = results;
+                        }
+                    // this is still alive if the request is
+                    if (auto r = weakRequest.lock())
+                    {
+                        r->received.insert(r->received.end(), results.begin(), results.end());
+                        if (last)
+                            Complete(*r);
+                    }
+                });
+            }
+        );
+        executor.PostAfter(session.CompletionDeadline(), [this, weakRequest]()
+            {
+                if (auto r = weakRequest.lock())
+                {
+                    if (r->received.empty())
+                    {
+                        // nothing arrived yet: use the results of a previous request
+                        DropExpired(*cache);
+                        const auto i = cache->find(r->provider);
+                        if (i != cache->end())
+                            std::copy_if(i->second.begin(), i->second.end(), std::back_inserter(r->received),
+                                [&](const std::string& c){ return c.rfind(r->params, 0) == 0; });
+                    }
+                    Complete(*r);
                 }
-                session.OutStream() << '\n';
-                std::string items;
-                std::for_each( completions.begin(), completions.end(), [&items](auto& cmd){ items += '\t' + cmd; } );
-                session.OutStream() << items << '\n';
-                session.Prompt();
-                terminal.ResetCursor();
-                terminal.SetLine( line );
-                break;
             }
+        );
+    }
+
+    // Removes the completions of the providers destroyed
+    static void DropExpired(Cache& c)
+    {
+        for (auto i = c.begin(); i != c.end();)
+        {
+            if (i->first.expired())
+                i = c.erase(i);
+            else
+                ++i;
         }
+    }
 
+    // Shows the completions of the request and drops it
+    void Complete(PendingCompletion& r)
+    {
+        auto completions = std::move(r.completions);
+        for (const auto& c: r.received)
+            completions.push_back(r.head + c);
+        std::sort(completions.begin(), completions.end());
+        completions.erase(std::unique(completions.begin(), completions.end()), completions.end());
+        const auto line = std::move(r.line);
+        pending.reset();
+        ShowCompletions(line, completions);
+    }
+
+    void ShowCompletions(const std::string& line, const std::vector<std::string>& completions)
+    {
+        if (completions.empty())
+            return;
+        if (completions.size() == 1)
+        {
+            terminal.SetLine(completions[0]+' ');
+            return;
+        }
+
+        auto commonPrefix = CommonPrefix(completions);
+        if (commonPrefix.size() > line.size())
+        {
+            terminal.SetLine(commonPrefix);
+            return;
+        }
+        session.OutStream() << '\n';
+        const auto width = session.TerminalWidth();
+        if (width == 0)
+        {
+            std::string items;
+            std::for_each( completions.begin(), completions.end(), [&items](auto& cmd){ items += '\t' + cmd; } );
+            session.OutStream() << items << '\n';
+        }
+        else
+            ShowColumns(completions, width);
+        session.Prompt();
+        UpdateLayout();
+        terminal.ResetCursor();
+        terminal.SetLine( line );
     }
 
     CliSession& session;
     Terminal terminal;
+    asio::BoostExecutor executor;
+    std::shared_ptr<Cache> cache;
+    std::shared_ptr<PendingCompletion> pending;
 };
 
 } // namespace detail
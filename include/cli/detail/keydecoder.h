@@ -0,0 +1,356 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_DETAIL_KEYDECODER_H_
+#define CLI_DETAIL_KEYDECODER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "inputdevice.h" // KeyType
+
+namespace cli
+{
+namespace detail
+{
+
+// the sequences that turn the bracketed paste mode of the terminal on and off
+constexpr const char* bracketedPasteOn = "\x1B[?2004h";
+constexpr const char* bracketedPasteOff = "\x1B[?2004l";
+
+// Incremental decoder of the bytes coming from a terminal (local or remote)
+// into keys. The escape sequences of the xterm/VT key set are recognized
+// through a trie built once from a table, so a burst of input is decoded
+// in one pass, and a sequence can be split across bursts.
+// The sequences that the terminal does not use (e.g. function keys) are
+// decoded as a single KeyType::ignored, and so are the unknown CSI
+// sequences (consumed up to their final byte).
+// Enter can be either CR, LF, CR LF or CR NUL (telnet).
+// The text pasted in bracketed paste mode (between ESC [ 200 ~ and
+// ESC [ 201 ~) is not decoded: it is collected and passed to paste(text)
+// as a whole (in parts of maxPaste bytes, if it's longer),
+// or decoded as typed keys when no paste callback is given.
+class KeyDecoder
+{
+public:
+    using Key = std::pair<KeyType, char>;
+
+    // Decodes [data, data+size), calling emit(Key) for each key
+    template <typename F>
+    void Decode(const char* data, std::size_t size, F&& emit)
+    {
+        for (std::size_t i = 0; i < size; ++i)
+            Decode(data[i], emit);
+    }
+
+    // Decodes [data, data+size), calling emit(Key) for each key
+    // and paste(std::string) for each pasted text
+    template <typename F, typename P>
+    void Decode(const char* data, std::size_t size, F&& emit, P&& paste)
+    {
+        for (std::size_t i = 0; i < size; ++i)
+            Decode(data[i], emit, paste);
+    }
+
+    template <typename F>
+    void Decode(const std::string& data, F&& emit)
+    {
+        Decode(data.data(), data.size(), emit);
+    }
+
+    template <typename F, typename P>
+    void Decode(const std::string& data, F&& emit, P&& paste)
+    {
+        Decode(data.data(), data.size(), emit, paste);
+    }
+
+    // Decodes a single byte
+    template <typename F>
+    void Decode(char c, F&& emit)
+    {
+        Decode(c, emit, [this, &emit](const std::string& text)
+        {
+            for (char t: text)
+                Decode(t, emit);
+        });
+    }
+
+    template <typename F, typename P>
+    void Decode(char c, F&& emit, P&& paste)
+    {
+        if (pasting)
+        {
+            Pasted(c, paste);
+            return;
+        }
+
+        const auto& nodes = Trie();
+        const auto uc = static_cast<unsigned char>(c);
+
+        if (skipCsi)
+        {
+            if (IsFinal(uc))
+            {
+                skipCsi = false;
+                emit(Key(KeyType::ignored, ' '));
+            }
+            return;
+        }
+
+        if (node != root)
+        {
+            const auto next = Find(nodes, node, uc);
+            if (next != none)
+            {
+                if (nodes[next].children.empty())
+                {
+                    node = root;
+                    if (nodes[next].pasteBegin)
+                        pasting = true;
+                    else
+                        emit(Key(nodes[next].key, ' '));
+                }
+                else
+                    node = next;
+                return;
+            }
+            // c does not continue any known sequence
+            const auto& current = nodes[node];
+            node = root;
+            if (current.csi)
+            {
+                // unknown CSI: skip it up to its final byte
+                if (IsFinal(uc))
+                    emit(Key(KeyType::ignored, ' '));
+                else if (uc >= 0x20 && uc < 0x40)
+                    skipCsi = true;
+                else
+                {
+                    emit(Key(KeyType::ignored, ' '));
+                    Decode(c, emit, paste);
+                }
+                return;
+            }
+            emit(Key(KeyType::ignored, ' '));
+            // the control characters start something new
+            // (the others are the second byte of ESC + key)
+            if (uc < 0x20 || uc == 0x7F)
+                Decode(c, emit, paste);
+            return;
+        }
+
+        const bool previousCr = afterCr;
+        afterCr = false;
+        switch (uc)
+        {
+            case 27: // ESC
+                node = Find(nodes, root, uc);
+                break;
+            case 13: // CR
+                afterCr = true;
+                emit(Key(KeyType::ret, ' '));
+                break;
+            case 10: // LF
+                if (!previousCr) emit(Key(KeyType::ret, ' '));
+                break;
+            case 0:
+                if (!previousCr) emit(Key(KeyType::ignored, ' '));
+                break;
+            case 4: // EOT
+                emit(Key(KeyType::eof, ' '));
+                break;
+            case 8: // BS
+            case 127: // DEL
+                emit(Key(KeyType::backspace, ' '));
+                break;
+            default:
+                emit(Key(KeyType::ascii, c));
+        }
+    }
+
+    // true if the decoder is in the middle of a sequence
+    // (or of a pasted text)
+    bool Pending() const { return node != root || skipCsi || pasting; }
+
+private:
+
+    // a byte of a pasted text: the text ends with ESC [ 201 ~
+    template <typename P>
+    void Pasted(char c, P&& paste)
+    {
+        static const char end[] = "\x1B[201~";
+        static const std::size_t endSize = sizeof(end) - 1;
+        if (c == end[endMatched])
+        {
+            if (++endMatched == endSize)
+            {
+                pasting = false;
+                endMatched = 0;
+                std::string text;
+                text.swap(pastedText);
+                paste(std::move(text));
+            }
+            return;
+        }
+        // a partial match was text (ESC does not occur again in the marker)
+        pastedText.append(end, endMatched);
+        endMatched = 0;
+        if (c == end[0])
+            endMatched = 1;
+        else
+            pastedText += c;
+        // a long text is passed in parts, so that the memory is bounded
+        // (a CR stays with the next part, that can start with its LF)
+        if (pastedText.size() >= maxPaste)
+        {
+            std::string text;
+            text.swap(pastedText);
+            if (text.back() == '\r')
+            {
+                text.pop_back();
+                pastedText = "\r";
+            }
+            paste(std::move(text));
+        }
+    }
+
+    struct Node
+    {
+        std::vector<std::pair<unsigned char, std::uint16_t>> children;
+        KeyType key = KeyType::ignored;
+        bool csi = false; // inside a CSI (ESC [) sequence
+        bool pasteBegin = false; // ESC [ 200 ~
+    };
+    using Nodes = std::vector<Node>;
+
+    enum : std::uint16_t { root = 0, none = 0xFFFF };
+    enum : std::size_t { maxPaste = 64 * 1024 }; // see Pasted
+
+    static bool IsFinal(unsigned char c) { return c >= 0x40 && c <= 0x7E; }
+
+    static std::uint16_t Find(const Nodes& nodes, std::uint16_t n, unsigned char c)
+    {
+        for (const auto& child: nodes[n].children)
+            if (child.first == c) return child.second;
+        return none;
+    }
+
+    static std::uint16_t Add(Nodes& nodes, const std::string& seq, KeyType key)
+    {
+        std::uint16_t n = root;
+        for (std::size_t i = 0; i < seq.size(); ++i)
+        {
+            const auto c = static_cast<unsigned char>(seq[i]);
+            auto next = Find(nodes, n, c);
+            if (next == none)
+            {
+                nodes.emplace_back();
+                next = static_cast<std::uint16_t>(nodes.size() - 1);
+                nodes[n].children.emplace_back(c, next);
+            }
+            n = next;
+            if (i >= 1 && seq[0] == '\x1B' && seq[1] == '[')
+                nodes[n].csi = true;
+        }
+        nodes[n].key = key;
+        return n;
+    }
+
+    // the trie of the known sequences, shared by all the decoders
+    static const Nodes& Trie()
+    {
+        static const Nodes nodes = Build();
+        return nodes;
+    }
+
+    static Nodes Build()
+    {
+        Nodes nodes(1);
+        struct Entry { const char* seq; KeyType key; };
+        static const Entry table[] = {
+            // cursor keys, normal and application mode
+            {"\x1B[A", KeyType::up}, {"\x1B[B", KeyType::down},
+            {"\x1B[C", KeyType::right}, {"\x1B[D", KeyType::left},
+            {"\x1BOA", KeyType::up}, {"\x1BOB", KeyType::down},
+            {"\x1BOC", KeyType::right}, {"\x1BOD", KeyType::left},
+            // home and end (xterm, vt220, rxvt)
+            {"\x1B[H", KeyType::home}, {"\x1B[F", KeyType::end},
+            {"\x1BOH", KeyType::home}, {"\x1BOF", KeyType::end},
+            {"\x1B[1~", KeyType::home}, {"\x1B[4~", KeyType::end},
+            {"\x1B[7~", KeyType::home}, {"\x1B[8~", KeyType::end},
+            // editing keypad
+            {"\x1B[3~", KeyType::canc},
+            {"\x1B[2~", KeyType::ignored}, // insert
+            {"\x1B[5~", KeyType::ignored}, // page up
+            {"\x1B[6~", KeyType::ignored}, // page down
+            // function keys
+            {"\x1BOP", KeyType::ignored}, {"\x1BOQ", KeyType::ignored},
+            {"\x1BOR", KeyType::ignored}, {"\x1BOS", KeyType::ignored},
+            {"\x1B[11~", KeyType::ignored}, {"\x1B[12~", KeyType::ignored},
+            {"\x1B[13~", KeyType::ignored}, {"\x1B[14~", KeyType::ignored},
+            {"\x1B[15~", KeyType::ignored}, {"\x1B[17~", KeyType::ignored},
+            {"\x1B[18~", KeyType::ignored}, {"\x1B[19~", KeyType::ignored},
+            {"\x1B[20~", KeyType::ignored}, {"\x1B[21~", KeyType::ignored},
+            {"\x1B[23~", KeyType::ignored}, {"\x1B[24~", KeyType::ignored},
+        };
+        for (const auto& e: table)
+            Add(nodes, e.seq, e.key);
+
+        // the same keys with shift, alt and ctrl modifiers (e.g. ESC [ 1 ; 5 C)
+        static const Entry modified[] = {
+            {"A", KeyType::up}, {"B", KeyType::down}, {"C", KeyType::right},
+            {"D", KeyType::left}, {"H", KeyType::home}, {"F", KeyType::end},
+        };
+        for (char m = '2'; m <= '8'; ++m)
+        {
+            for (const auto& e: modified)
+                Add(nodes, std::string("\x1B[1;") + m + e.seq, e.key);
+            Add(nodes, std::string("\x1B[3;") + m + '~', KeyType::canc);
+        }
+
+        // bracketed paste (an end marker out of a paste is ignored)
+        nodes[Add(nodes, "\x1B[200~", KeyType::ignored)].pasteBegin = true;
+        Add(nodes, "\x1B[201~", KeyType::ignored);
+        return nodes;
+    }
+
+    std::uint16_t node = root;
+    bool skipCsi = false;
+    bool afterCr = false;
+    bool pasting = false;
+    std::size_t endMatched = 0; // bytes of the end marker matched
+    std::string pastedText;
+};
+
+} // namespace detail
+} // namespace cli
+
+#endif // CLI_DETAIL_KEYDECODER_H_
@@ -0,0 +1,153 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_DETAIL_LAGMONITOR_H_
+#define CLI_DETAIL_LAGMONITOR_H_
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include "boostasio.h"
+
+namespace cli
+{
+namespace detail
+{
+
+// Watchdog of an io context: at each interval it measures the lag of
+// the io context, i.e. how late a timer handler runs after its expiry.
+// A handler that blocks (e.g., a slow command) delays all the others
+// and shows up as lag.
+// The io context is overloaded from a sample over the threshold until
+// the lag stays under half the threshold for coolDown samples.
+// Lag, MaxLag and Overloaded can be called from any thread.
+class LagMonitor
+{
+public:
+    using Duration = std::chrono::steady_clock::duration;
+    using Handler = std::function<void(Duration lag)>;
+
+    explicit LagMonitor(asio::BoostExecutor::ContextType& ios) :
+        core(std::make_shared<Core>(ios))
+    {}
+
+    // disable value semantics
+    LagMonitor(const LagMonitor&) = delete;
+    LagMonitor& operator = (const LagMonitor&) = delete;
+
+    ~LagMonitor() { Stop(); }
+
+    void Start(Duration threshold, Duration interval = std::chrono::milliseconds(100))
+    {
+        core->threshold = threshold;
+        core->interval = interval;
+        if (!core->running)
+        {
+            core->running = true;
+            Arm(core);
+        }
+    }
+
+    void Stop()
+    {
+        core->running = false;
+        core->overloaded = false;
+        core->timer.cancel();
+    }
+
+    // Called in the thread of the io context for each sample over the threshold
+    void OnLag(Handler h) { core->handler = std::move(h); }
+
+    // The last sample
+    Duration Lag() const { return Duration(core->lag.load()); }
+    // The max sample since the start
+    Duration MaxLag() const { return Duration(core->maxLag.load()); }
+    bool Overloaded() const { return core->overloaded; }
+
+private:
+
+    enum : unsigned { coolDown = 10 };
+
+    struct Core
+    {
+        explicit Core(asio::BoostExecutor::ContextType& ios) : timer(ios) {}
+        boost::asio::steady_timer timer;
+        std::chrono::steady_clock::time_point due;
+        Duration threshold{};
+        Duration interval{};
+        Handler handler;
+        bool running = false;
+        unsigned goodSamples = 0;
+        std::atomic<Duration::rep> lag{0};
+        std::atomic<Duration::rep> maxLag{0};
+        std::atomic<bool> overloaded{false};
+    };
+
+    static void Arm(const std::shared_ptr<Core>& c)
+    {
+        c->due = std::chrono::steady_clock::now() + c->interval;
+        c->timer.expires_at(c->due);
+        std::weak_ptr<Core> weak = c;
+        c->timer.async_wait([weak](const boost::system::error_code& ec)
+        {
+            if (ec) return;
+            if (auto core = weak.lock())
+                if (core->running)
+                    Sample(core);
+        });
+    }
+
+    static void Sample(const std::shared_ptr<Core>& c)
+    {
+        const auto lag = std::chrono::steady_clock::now() - c->due;
+        c->lag = lag.count();
+        if (lag.count() > c->maxLag)
+            c->maxLag = lag.count();
+        if (lag > c->threshold)
+        {
+            c->overloaded = true;
+            c->goodSamples = 0;
+            if (c->handler)
+                c->handler(lag);
+        }
+        else if (lag >= c->threshold / 2)
+            c->goodSamples = 0;
+        else if (++c->goodSamples >= coolDown)
+            c->overloaded = false;
+        Arm(c);
+    }
+
+    std::shared_ptr<Core> core;
+};
+
+} // namespace detail
+} // namespace cli
+
+#endif // CLI_DETAIL_LAGMONITOR_H_
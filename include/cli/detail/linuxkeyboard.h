@@ -30,6 +30,7 @@
 #ifndef CLI_DETAIL_LINUXKEYBOARD_H_
 #define CLI_DETAIL_LINUXKEYBOARD_H_
 
+#include <iostream>
 #include <thread>
 #include <memory>
 #include <atomic>
@@ -42,6 +43,7 @@
 #include <sys/time.h>
 
 #include "inputdevice.h"
+#include "keydecoder.h"
 
 
 namespace cli
@@ -69,54 +71,21 @@ private:
 
     void Read()
     {
+        char buffer[256];
         while ( run )
         {
-            auto k = Get();
-            Notify(k);
-        }
-    }
-
-    std::pair<KeyType,char> Get()
-    {
-        while ( !KbHit() ) {}
-        int ch = getchar();
-        switch( ch )
-        {
-            case EOF:
-            case 4:  // EOT
-                return std::make_pair(KeyType::eof,' ');
-                break;
-            case 127: return std::make_pair(KeyType::backspace,' '); break;
-            case 10: return std::make_pair(KeyType::ret,' '); break;
-            case 27: // symbol
-                ch = getchar();
-                if ( ch == 91 ) // arrow keys
-                {
-                    ch = getchar();
-                    switch( ch )
-                    {
-                        case 51:
-                            ch = getchar();
-                            if ( ch == 126 ) return std::make_pair(KeyType::canc,' ');
-                            else return std::make_pair(KeyType::ignored,' ');
-                            break;
-                        case 65: return std::make_pair(KeyType::up,' ');
-                        case 66: return std::make_pair(KeyType::down,' ');
-                        case 68: return std::make_pair(KeyType::left,' ');
-                        case 67: return std::make_pair(KeyType::right,' ');
-                        case 70: return std::make_pair(KeyType::end,' ');
-                        case 72: return std::make_pair(KeyType::home,' ');
-                        default: return std::make_pair(KeyType::ignored,' ');
-                    }
-                }
-                break;
-            default: // ascii
+            if ( !KbHit() ) continue;
+            const auto n = read( STDIN_FILENO, buffer, sizeof(buffer) );
+            if ( n <= 0 )
             {
-                const char c = static_cast<char>(ch);
-                return std::make_pair(KeyType::ascii,c);
+                Notify(std::make_pair(KeyType::eof,' '));
+                continue;
             }
+            // a burst (e.g. an escape sequence or a paste) is decoded at once
+            decoder.Decode(buffer, static_cast<std::size_t>(n),
+                [this](const KeyDecoder::Key& k){ Notify(k); },
+                [this](std::string text){ NotifyPaste(std::move(text)); });
         }
-        return std::make_pair(KeyType::ignored,' ');
     }
 
     void ToManualMode()
@@ -125,9 +94,11 @@ private:
         newt = oldt;
         newt.c_lflag &= ~( (tcflag_t)ICANON | (tcflag_t)ECHO );
         tcsetattr( STDIN_FILENO, TCSANOW, &newt );
+        std::cout << bracketedPasteOn << std::flush;
     }
     void ToStandardMode()
     {
+        std::cout << bracketedPasteOff << std::flush;
         tcsetattr( STDIN_FILENO, TCSANOW, &oldt );
     }
 
@@ -146,6 +117,7 @@ private:
       return FD_ISSET(STDIN_FILENO, &rdfs);
     }
 
+    KeyDecoder decoder;
     termios oldt;
     termios newt;
     std::atomic<bool> run{ true };
@@ -0,0 +1,218 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_DETAIL_MACRO_H_
+#define CLI_DETAIL_MACRO_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "cmdline.h"
+
+namespace cli
+{
+namespace detail
+{
+
+// A sequence of commands defined once (e.g., by the command "alias"),
+// with positional parameters: "$1", "$2", ... (also inside a token, like "eth$1")
+// and "$*" (all the arguments, as separate tokens).
+// The commands are separated by the token ";".
+// The definition is tokenized and parsed when the macro is created, so that
+// its expansion only copies the tokens and the arguments (no split, no parsing).
+// A macro without parameters passes its arguments to its last command.
+class Macro
+{
+public:
+    template <typename Tokens>
+    explicit Macro(const Tokens& definition)
+    {
+        commands.emplace_back();
+        for (const auto& t: definition)
+        {
+            if (t == ";")
+            {
+                if (!commands.back().empty())
+                    commands.emplace_back();
+                continue;
+            }
+            commands.back().push_back(Parse(AsString(t)));
+        }
+        if (commands.back().empty())
+            commands.pop_back();
+        for (const auto& t: definition)
+            text += (text.empty() ? "" : " ") + (t == ";" ? AsString(t) : Quote(AsString(t)));
+    }
+
+    bool Empty() const { return commands.empty(); }
+
+    // number of commands of the macro
+    std::size_t Size() const { return commands.size(); }
+
+    // the highest parameter referenced (0 if none)
+    std::size_t Parameters() const { return parameters; }
+
+    // the definition, as it can be typed again
+    const std::string& Definition() const { return text; }
+
+    // Puts in tokens the i-th command, with the arguments in place of the parameters.
+    // Container can be any sequence of std::string.
+    template <typename Container>
+    void Expand(std::size_t i, const CmdLine& args, Container& tokens) const
+    {
+        tokens.clear();
+        for (const auto& token: commands[i])
+        {
+            if (token.size() == 1 && token[0].param == all)
+            {
+                tokens.insert(tokens.end(), args.begin(), args.end());
+                continue;
+            }
+            tokens.emplace_back();
+            auto& result = tokens.back();
+            for (const auto& piece: token)
+            {
+                result += piece.text;
+                if (piece.param != none && piece.param != all && piece.param <= args.size())
+                    result += args[piece.param - 1];
+            }
+        }
+        if (parameters == 0 && !variadic && i + 1 == commands.size())
+            tokens.insert(tokens.end(), args.begin(), args.end());
+    }
+
+private:
+    enum : std::size_t { none = 0, all = static_cast<std::size_t>(-1) };
+
+    // A part of a token: a literal text followed by a parameter (if param != none)
+    struct Piece
+    {
+        std::string text;
+        std::size_t param;
+    };
+    using Token = std::vector<Piece>;
+
+    Token Parse(const std::string& t)
+    {
+        Token token;
+        if (t == "$*")
+        {
+            variadic = true;
+            token.push_back({{}, all});
+            return token;
+        }
+        std::string literal;
+        for (std::size_t i = 0; i < t.size(); ++i)
+        {
+            std::size_t param = 0;
+            std::size_t j = i + 1;
+            for (; t[i] == '$' && j < t.size() && t[j] >= '0' && t[j] <= '9'; ++j)
+                param = param * 10 + static_cast<std::size_t>(t[j] - '0');
+            if (param == 0) // not a parameter
+            {
+                literal += t[i];
+                continue;
+            }
+            token.push_back({std::move(literal), param});
+            literal.clear();
+            if (param > parameters) parameters = param;
+            i = j - 1;
+        }
+        if (!literal.empty() || token.empty())
+            token.push_back({std::move(literal), none});
+        return token;
+    }
+
+    static std::string Quote(const std::string& t)
+    {
+        if (!t.empty() && t.find_first_of(" \t\"'") == std::string::npos)
+            return t;
+        std::string result = "\"";
+        for (char c: t)
+        {
+            if (c == '"' || c == '\\') result += '\\';
+            result += c;
+        }
+        return result + '"';
+    }
+
+    std::vector<std::vector<Token>> commands;
+    std::size_t parameters = 0;
+    bool variadic = false;
+    std::string text;
+};
+
+// The macros by name (e.g., the aliases of a session)
+class MacroTable
+{
+public:
+    // An empty definition removes the macro
+    template <typename Tokens>
+    void Define(const std::string& name, const Tokens& definition)
+    {
+        auto macro = std::make_shared<const Macro>(definition);
+        if (macro->Empty())
+            macros.erase(name);
+        else
+            macros[name] = std::move(macro);
+    }
+
+    bool Remove(const std::string& name) { return macros.erase(name) > 0; }
+
+    bool Empty() const { return macros.empty(); }
+
+    std::shared_ptr<const Macro> Find(const std::string& name) const
+    {
+        if (macros.empty()) return {};
+        auto i = macros.find(name);
+        return i == macros.end() ? nullptr : i->second;
+    }
+
+    // (name, definition) of the macros, sorted by name
+    std::vector<std::pair<std::string, std::string>> List() const
+    {
+        std::vector<std::pair<std::string, std::string>> result;
+        for (const auto& m: macros)
+            result.emplace_back(m.first, m.second->Definition());
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+private:
+    std::unordered_map<std::string, std::shared_ptr<const Macro>> macros;
+};
+
+} // namespace detail
+} // namespace cli
+
+#endif // CLI_DETAIL_MACRO_H_
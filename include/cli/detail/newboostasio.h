@@ -31,6 +31,8 @@
 #define CLI_DETAIL_NEWBOOSTASIO_H_
 
 #include <boost/asio.hpp>
+#include <chrono>
+#include <memory>
 
 namespace cli {
 namespace detail {
@@ -45,8 +47,20 @@ public:
     explicit BoostExecutor(boost::asio::ip::tcp::socket& socket) :
         executor(socket.get_executor()) {}
     template <typename T> void Post(T&& t) { boost::asio::post(executor, std::forward<T>(t)); }
+    // Executes t after the given time
+    template <typename T> void PostAfter(std::chrono::steady_clock::duration d, T&& t)
+    {
+#if BOOST_VERSION < 107000
+        auto timer = std::make_shared<boost::asio::steady_timer>(executor.context(), d);
+#else
+        auto timer = std::make_shared<boost::asio::steady_timer>(executor, d);
+#endif
+        timer->async_wait([timer, t](const boost::system::error_code&) mutable { t(); });
+    }
 private:
-    boost::asio::executor executor;
+    // the type of executor used by the sockets (and timers) of this boost version
+    using Executor = boost::asio::ip::tcp::socket::executor_type;
+    Executor executor;
 };
 
 inline boost::asio::ip::address IpAddressFromString(const std::string& address)
@@ -31,6 +31,8 @@
 #define CLI_DETAIL_OLDBOOSTASIO_H_
 
 #include <boost/asio.hpp>
+#include <chrono>
+#include <memory>
 
 namespace cli {
 namespace detail {
@@ -45,6 +47,12 @@ public:
     explicit BoostExecutor(boost::asio::ip::tcp::socket& socket) :
         ios(socket.get_io_service()) {}
     template <typename T> void Post(T&& t) { ios.post(std::forward<T>(t)); }
+    // Executes t after the given time
+    template <typename T> void PostAfter(std::chrono::steady_clock::duration d, T&& t)
+    {
+        auto timer = std::make_shared<boost::asio::steady_timer>(ios, d);
+        timer->async_wait([timer, t](const boost::system::error_code&) mutable { t(); });
+    }
 private:
     ContextType& ios;
 };
@@ -0,0 +1,250 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_DETAIL_PREFIXINDEX_H_
+#define CLI_DETAIL_PREFIXINDEX_H_
+
+#include <cctype>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cli
+{
+namespace detail
+{
+
+// Index of a set of names (with multiplicity) to find the one starting
+// with a prefix in time proportional to the prefix length.
+// Each name is associated to a (non owning) pointer to T.
+template <typename T>
+class PrefixIndex
+{
+public:
+
+    // The result of one or more Find
+    struct Match
+    {
+        bool exact = false;     // a name is equal to the prefix
+        std::size_t count = 0;  // number of names starting with the prefix
+        std::string name;       // the name found (if exact or count == 1)
+        T* value = nullptr;     // its value
+
+        // true if the prefix identifies a single name
+        bool Unique() const { return exact || count == 1; }
+
+        // Takes into account also the name given
+        void Add(const std::string& candidate, T* v, const std::string& prefix, bool ignoreCase)
+        {
+            if (exact || !StartsWith(candidate, prefix, ignoreCase)) return;
+            if (candidate.size() == prefix.size())
+            {
+                exact = true;
+                name = candidate;
+                value = v;
+            }
+            else
+                Found(candidate, v);
+        }
+
+    private:
+        friend class PrefixIndex;
+        void Found(const std::string& n, T* v)
+        {
+            // the same name can be in more indexes
+            if (count == 1 && name == n) return;
+            ++count;
+            name = n;
+            value = v;
+        }
+    };
+
+    PrefixIndex() : nodes(1) {}
+
+    void Insert(const std::string& name, T* value = nullptr)
+    {
+        std::size_t n = 0;
+        std::vector<std::size_t> path{n};
+        for (char c: name)
+        {
+            n = Child(n, c);
+            path.push_back(n);
+        }
+        if (nodes[n].refs++ == 0)
+            for (auto i: path)
+                ++nodes[i].names;
+        if (value) nodes[n].value = value;
+    }
+
+    void Remove(const std::string& name, const T* value = nullptr)
+    {
+        std::size_t n = 0;
+        std::vector<std::size_t> path{n};
+        for (char c: name)
+        {
+            n = FindChild(n, c);
+            if (n == none) return;
+            path.push_back(n);
+        }
+        if (nodes[n].refs == 0) return;
+        if (value && nodes[n].value == value) nodes[n].value = nullptr;
+        if (--nodes[n].refs == 0)
+            for (auto i: path)
+                --nodes[i].names;
+    }
+
+    // Looks for the names starting with prefix, and updates m accordingly
+    void Find(const std::string& prefix, bool ignoreCase, Match& m) const
+    {
+        if (m.exact) return;
+        // with ignoreCase the prefix can match more branches
+        std::vector<std::size_t> frontier{0};
+        std::vector<std::size_t> next;
+        for (char c: prefix)
+        {
+            next.clear();
+            for (auto n: frontier)
+            {
+                Follow(n, c, next);
+                if (ignoreCase)
+                {
+                    const char other = Other(c);
+                    if (other != c) Follow(n, other, next);
+                }
+            }
+            if (next.empty()) return;
+            frontier.swap(next);
+        }
+        for (auto n: frontier)
+        {
+            if (nodes[n].refs > 0)
+            {
+                m.exact = true;
+                m.name = NameOf(n);
+                m.value = nodes[n].value;
+                return;
+            }
+        }
+        for (auto n: frontier)
+        {
+            if (nodes[n].names == 1)
+            {
+                const auto leaf = Leaf(n);
+                m.Found(NameOf(leaf), nodes[leaf].value);
+            }
+            else
+                m.count += nodes[n].names;
+        }
+    }
+
+    static bool StartsWith(const std::string& name, const std::string& prefix, bool ignoreCase)
+    {
+        if (name.size() < prefix.size()) return false;
+        for (std::size_t i = 0; i < prefix.size(); ++i)
+            if (name[i] != prefix[i] && (!ignoreCase || Other(name[i]) != prefix[i]))
+                return false;
+        return true;
+    }
+
+private:
+
+    static constexpr std::size_t none = static_cast<std::size_t>(-1);
+
+    struct Node
+    {
+        std::size_t parent = none;
+        char c = 0;
+        std::vector<std::pair<char, std::size_t>> children;
+        std::size_t refs = 0;  // occurrences of the name ending here
+        std::size_t names = 0; // distinct names in the subtree
+        T* value = nullptr;
+    };
+
+    static char Other(char c)
+    {
+        const auto u = static_cast<unsigned char>(c);
+        if (std::islower(u)) return static_cast<char>(std::toupper(u));
+        return static_cast<char>(std::tolower(u));
+    }
+
+    std::size_t FindChild(std::size_t n, char c) const
+    {
+        for (const auto& child: nodes[n].children)
+            if (child.first == c) return child.second;
+        return none;
+    }
+
+    void Follow(std::size_t n, char c, std::vector<std::size_t>& result) const
+    {
+        const auto child = FindChild(n, c);
+        if (child != none && nodes[child].names > 0) result.push_back(child);
+    }
+
+    std::size_t Child(std::size_t n, char c)
+    {
+        const auto child = FindChild(n, c);
+        if (child != none) return child;
+        nodes.emplace_back();
+        nodes.back().parent = n;
+        nodes.back().c = c;
+        nodes[n].children.emplace_back(c, nodes.size()-1);
+        return nodes.size()-1;
+    }
+
+    // the node of the only name in the subtree of n
+    std::size_t Leaf(std::size_t n) const
+    {
+        while (nodes[n].refs == 0)
+            for (const auto& child: nodes[n].children)
+                if (nodes[child.second].names > 0)
+                {
+                    n = child.second;
+                    break;
+                }
+        return n;
+    }
+
+    std::string NameOf(std::size_t n) const
+    {
+        std::string name;
+        for (; n != 0; n = nodes[n].parent)
+            name.insert(name.begin(), nodes[n].c);
+        return name;
+    }
+
+    std::vector<Node> nodes;
+};
+
+template <typename T>
+constexpr std::size_t PrefixIndex<T>::none;
+
+} // namespace detail
+} // namespace cli
+
+#endif // CLI_DETAIL_PREFIXINDEX_H_
@@ -0,0 +1,444 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_DETAIL_SCRIPT_H_
+#define CLI_DETAIL_SCRIPT_H_
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "commandmemory.h"
+
+namespace cli
+{
+namespace detail
+{
+
+// A token of a script, with the references to the variables
+// ("$name" or "${name}") parsed once
+class ScriptToken
+{
+public:
+    using Variables = std::unordered_map<std::string, std::string>;
+
+    // An operator ("&&" or "||" not quoted, see split) and a quoted token
+    // are never expanded
+    explicit ScriptToken(const std::string& token, bool _op = false, bool quoted = false) : op(_op)
+    {
+        if (op || quoted)
+        {
+            pieces.push_back({token, {}});
+            return;
+        }
+        std::string literal;
+        for (std::size_t i = 0; i < token.size(); ++i)
+        {
+            std::size_t end = i;
+            const auto name = VariableAt(token, i, end);
+            if (name.empty())
+            {
+                literal += token[i];
+                continue;
+            }
+            pieces.push_back({std::move(literal), name});
+            literal.clear();
+            i = end - 1;
+        }
+        if (!literal.empty() || pieces.empty())
+            pieces.push_back({std::move(literal), {}});
+    }
+
+    bool HasVariables() const { return pieces.size() > 1 || !pieces[0].variable.empty(); }
+    bool Operator() const { return op; }
+
+    // the undefined variables are empty
+    std::string Eval(const Variables& vars) const
+    {
+        if (!HasVariables()) return pieces[0].text;
+        std::string result;
+        for (const auto& p: pieces)
+        {
+            result += p.text;
+            if (p.variable.empty()) continue;
+            auto v = vars.find(p.variable);
+            if (v != vars.end()) result += v->second;
+        }
+        return result;
+    }
+
+    static bool IsName(const std::string& s)
+    {
+        if (s.empty() || !(std::isalpha(static_cast<unsigned char>(s[0])) || s[0] == '_')) return false;
+        for (char c: s)
+            if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_') return false;
+        return true;
+    }
+
+    // Returns the name of the variable referenced at position i of token (if any),
+    // and in end the position after the reference
+    static std::string VariableAt(const std::string& token, std::size_t i, std::size_t& end)
+    {
+        if (token[i] != '$' || i + 1 == token.size()) return {};
+        if (token[i + 1] == '{')
+        {
+            end = token.find('}', i + 2);
+            if (end == std::string::npos) return {};
+            auto name = token.substr(i + 2, end - i - 2);
+            ++end;
+            return IsName(name) ? name : std::string();
+        }
+        end = i + 1;
+        while (end < token.size() && (std::isalnum(static_cast<unsigned char>(token[end])) || token[end] == '_'))
+            ++end;
+        auto name = token.substr(i + 1, end - i - 1);
+        return IsName(name) ? name : std::string();
+    }
+
+private:
+    // a literal text followed by a variable (if any)
+    struct Piece
+    {
+        std::string text;
+        std::string variable;
+    };
+    std::vector<Piece> pieces;
+    bool op = false;
+};
+
+// The script layer of a session: variables ("name=value", "$name"),
+// loops ("for <name> in <first>..<last>" or "for <name> in <items>", up to "end")
+// and conditions on the status of a command ("if [!] <command>", optionally "else", up to "end").
+// The lines are parsed once when they're added: the body of a loop
+// is executed at every iteration just replacing the variables in its tokens.
+class Script
+{
+public:
+    using Variables = ScriptToken::Variables;
+
+    // What the script layer does with a line
+    enum class Line
+    {
+        command,    // a plain command: the session executes it
+        incomplete, // a line of a block (executed when the block ends)
+        complete,   // a statement ready to Run
+        error       // a wrong line (see Error)
+    };
+
+    // operators are the positions of "&&" and "||" in tokens, and quoted the ones
+    // of the tokens written between quotes, whose "$name" are left as they are (see split)
+    template <typename Tokens>
+    Line Add(const Tokens& tokens, const std::vector<std::size_t>& operators = {}, const std::vector<std::size_t>& quoted = {})
+    {
+        const auto isQuoted = [&](std::size_t i){ return std::binary_search(quoted.begin(), quoted.end(), i); };
+        const auto token = [&](std::size_t i)
+        {
+            return ScriptToken(AsString(tokens[i]), std::binary_search(operators.begin(), operators.end(), i), isQuoted(i));
+        };
+        error.clear();
+        const std::string& first = AsString(tokens[0]);
+        if (first == "for")
+        {
+            if (tokens.size() < 4 || tokens[2] != "in" || !ScriptToken::IsName(AsString(tokens[1])))
+                return Fail("usage: for <name> in <first>..<last> | <items>");
+            Statement s(Kind::loop);
+            s.name = tokens[1];
+            for (std::size_t i = 3; i < tokens.size(); ++i)
+                s.tokens.emplace_back(AsString(tokens[i]), false, isQuoted(i));
+            return Open(std::move(s));
+        }
+        if (first == "if")
+        {
+            const bool negate = tokens.size() > 1 && tokens[1] == "!";
+            if (tokens.size() < (negate ? 3u : 2u))
+                return Fail("usage: if [!] <command>");
+            Statement s(Kind::branch);
+            s.negate = negate;
+            for (std::size_t i = negate ? 2 : 1; i < tokens.size(); ++i)
+                s.tokens.push_back(token(i));
+            return Open(std::move(s));
+        }
+        if (first == "else" && tokens.size() == 1)
+        {
+            if (blocks.empty() || blocks.back().kind != Kind::branch || blocks.back().inElse)
+                return Fail("else without if");
+            blocks.back().inElse = true;
+            return Line::incomplete;
+        }
+        if (first == "end" && tokens.size() == 1)
+        {
+            if (blocks.empty())
+                return Fail("end without for or if");
+            auto s = std::move(blocks.back());
+            blocks.pop_back();
+            return Append(std::move(s));
+        }
+
+        const auto eq = first.find('=');
+        if (eq != std::string::npos && ScriptToken::IsName(first.substr(0, eq)))
+        {
+            // the value is the rest of the line (see Run)
+            Statement s(Kind::assign);
+            s.name = first.substr(0, eq);
+            s.tokens.emplace_back(first.substr(eq + 1), false, isQuoted(0));
+            for (std::size_t i = 1; i < tokens.size(); ++i)
+                s.tokens.emplace_back(AsString(tokens[i]), false, isQuoted(i));
+            return Append(std::move(s));
+        }
+
+        Statement s(Kind::command);
+        bool variables = false;
+        for (std::size_t i = 0; i < tokens.size(); ++i)
+        {
+            s.tokens.push_back(token(i));
+            variables = variables || s.tokens.back().HasVariables();
+        }
+        if (blocks.empty() && !variables)
+            return Line::command;
+        return Append(std::move(s));
+    }
+
+    const std::string& Error() const { return error; }
+
+    // true while adding the lines of a block
+    bool Pending() const { return !blocks.empty(); }
+
+    // Discards the block being added
+    void Discard() { blocks.clear(); }
+
+    // Runs the complete statement, calling exec(tokens, operators) for each command
+    // (operators are the positions of "&&" and "||" in tokens):
+    // exec returns its status. Returns false if any command failed
+    // (but the conditions of "if"). With stopOnError, the execution
+    // ends at the first command that fails.
+    // A wrong statement (e.g. a range too long) fails, see Error.
+    template <typename Executor>
+    bool Run(Executor&& exec, bool stopOnError = false)
+    {
+        std::unique_ptr<Statement> s;
+        s.swap(ready);
+        error.clear();
+        stop = stopOnError;
+        Command cmd;
+        return s ? Run(*s, exec, cmd) : true;
+    }
+
+    Variables& Vars() { return vars; }
+    const Variables& Vars() const { return vars; }
+
+private:
+    enum class Kind { command, assign, loop, branch };
+
+    // a command with the variables replaced
+    struct Command
+    {
+        std::vector<Token> tokens;
+        std::vector<std::size_t> operators;
+    };
+
+    struct Statement
+    {
+        explicit Statement(Kind k) : kind(k) {}
+        Kind kind;
+        std::string name;                   // of the variable (assign, loop)
+        std::vector<ScriptToken> tokens;    // command, value (assign), items (loop), condition (branch)
+        bool negate = false;                // branch
+        bool inElse = false;                // branch, while parsing
+        std::vector<Statement> body;        // loop, branch
+        std::vector<Statement> alternative; // branch
+    };
+
+    Line Fail(const char* msg)
+    {
+        // a wrong line discards the block being added
+        error = msg;
+        blocks.clear();
+        return Line::error;
+    }
+
+    Line Open(Statement&& s)
+    {
+        blocks.push_back(std::move(s));
+        return Line::incomplete;
+    }
+
+    Line Append(Statement&& s)
+    {
+        if (blocks.empty())
+        {
+            ready = std::make_unique<Statement>(std::move(s));
+            return Line::complete;
+        }
+        auto& b = blocks.back();
+        (b.inElse ? b.alternative : b.body).push_back(std::move(s));
+        return Line::incomplete;
+    }
+
+    template <typename Executor>
+    bool Run(const Statement& s, Executor& exec, Command& cmd)
+    {
+        auto& tokens = cmd.tokens;
+        switch (s.kind)
+        {
+            case Kind::command:
+                Eval(s.tokens, cmd);
+                return tokens.empty() || exec(tokens, cmd.operators);
+            case Kind::assign:
+            {
+                // the tokens separated by a space
+                std::string value = s.tokens[0].Eval(vars);
+                for (std::size_t i = 1; i < s.tokens.size(); ++i)
+                {
+                    value += ' ';
+                    value += s.tokens[i].Eval(vars);
+                }
+                vars[s.name] = std::move(value);
+                return true;
+            }
+            case Kind::branch:
+            {
+                Eval(s.tokens, cmd);
+                const bool condition = !tokens.empty() && exec(tokens, cmd.operators);
+                return RunAll(condition != s.negate ? s.body : s.alternative, exec, cmd);
+            }
+            case Kind::loop:
+            {
+                Eval(s.tokens, cmd);
+                long long first = 0;
+                long long last = 0;
+                bool ok = true;
+                const auto range = tokens.size() == 1 ? Range(AsString(tokens[0]), first, last) : RangeKind::none;
+                if (range == RangeKind::invalid)
+                {
+                    error = "for: the range must have at most " + std::to_string(maxRange) + " numbers";
+                    return false;
+                }
+                if (range == RangeKind::valid)
+                {
+                    const long long step = first <= last ? 1 : -1;
+                    for (auto i = first; ; i += step)
+                    {
+                        vars[s.name] = std::to_string(i);
+                        ok = RunAll(s.body, exec, cmd) && ok;
+                        if (i == last || (stop && !ok)) break;
+                    }
+                    return ok;
+                }
+                const auto items = tokens;
+                for (const auto& item: items)
+                {
+                    vars[s.name] = item;
+                    ok = RunAll(s.body, exec, cmd) && ok;
+                    if (stop && !ok) break;
+                }
+                return ok;
+            }
+        }
+        return true;
+    }
+
+    template <typename Executor>
+    bool RunAll(const std::vector<Statement>& statements, Executor& exec, Command& cmd)
+    {
+        bool ok = true;
+        for (const auto& s: statements)
+        {
+            ok = Run(s, exec, cmd) && ok;
+            if (stop && !ok) break;
+        }
+        return ok;
+    }
+
+    void Eval(const std::vector<ScriptToken>& from, Command& cmd) const
+    {
+        auto& tokens = cmd.tokens;
+        tokens.clear();
+        cmd.operators.clear();
+        for (const auto& t: from)
+        {
+            if (t.Operator()) cmd.operators.push_back(tokens.size());
+            tokens.emplace_back(t.Eval(vars));
+            if (tokens.back().empty()) tokens.pop_back(); // e.g. an undefined variable
+        }
+    }
+
+    enum class RangeKind { none, valid, invalid };
+
+    // e.g. "1..4000" or "-5..5": invalid if a number overflows or
+    // the range has more than maxRange numbers
+    static RangeKind Range(const std::string& s, long long& first, long long& last)
+    {
+        const auto dots = s.find("..");
+        if (dots == std::string::npos) return RangeKind::none;
+        bool overflow = false;
+        if (!Number(s.substr(0, dots), first, overflow) || !Number(s.substr(dots + 2), last, overflow))
+            return overflow ? RangeKind::invalid : RangeKind::none;
+        // the distance, without overflows
+        const auto size = first <= last ?
+            static_cast<unsigned long long>(last) - static_cast<unsigned long long>(first) :
+            static_cast<unsigned long long>(first) - static_cast<unsigned long long>(last);
+        return size < maxRange ? RangeKind::valid : RangeKind::invalid;
+    }
+
+    static bool Number(const std::string& s, long long& n, bool& overflow)
+    {
+        std::size_t i = (!s.empty() && s[0] == '-') ? 1 : 0;
+        if (i == s.size()) return false;
+        n = 0;
+        for (; i < s.size(); ++i)
+        {
+            if (!std::isdigit(static_cast<unsigned char>(s[i]))) return false;
+            const int digit = s[i] - '0';
+            if (n > (std::numeric_limits<long long>::max() - digit) / 10)
+            {
+                overflow = true;
+                return false;
+            }
+            n = n * 10 + digit;
+        }
+        if (s[0] == '-') n = -n;
+        return true;
+    }
+
+    Variables vars;
+    std::vector<Statement> blocks;    // the blocks being added, the innermost last
+    std::unique_ptr<Statement> ready; // the statement to Run
+    std::string error;
+    bool stop = false;                // stop at the first failure (see Run)
+    enum : unsigned long long { maxRange = 10000000 }; // numbers of a range in a loop
+};
+
+} // namespace detail
+} // namespace cli
+
+#endif // CLI_DETAIL_SCRIPT_H_
@@ -30,15 +30,36 @@
 #ifndef CLI_DETAIL_SERVER_H_
 #define CLI_DETAIL_SERVER_H_
 
+#include <atomic>
+#include <chrono>
 #include <memory>
+#include <mutex>
 #include <queue>
+#include <string>
 #include "boostasio.h"
+#include "lagmonitor.h"
+#include "timerservice.h"
+#ifdef CLI_USE_IO_URING
+#include "uring.h"
+#endif
 
 namespace cli
 {
 namespace detail
 {
 
+// Socket options of the sessions accepted by a Server
+struct TcpOptions
+{
+    // TCP_NODELAY: the echo of the keys is not delayed by the Nagle algorithm
+    bool noDelay = true;
+    // the output of a command is buffered and sent in large writes
+    // when the command ends (like TCP_CORK, but portable)
+    bool batchOutput = true;
+    // size of the send buffer of the socket (SO_SNDBUF), 0 for the default
+    std::size_t sendBufferSize = 0;
+};
+
 class Session : public std::enable_shared_from_this<Session>, public std::streambuf
 {
 public:
@@ -49,18 +70,56 @@ public:
         Read();
     }
 
+    // Enables the buffering of the output between Cork and Uncork
+    void BatchOutput(bool enable) { batchOutput = enable; }
+
+    // Calls OnIdle when no data is received for the timeout
+    // (the checks are timers of the service given)
+    void WatchIdle(TimerService& service, std::chrono::steady_clock::duration timeout)
+    {
+        timers = &service;
+        idleTimeout = timeout;
+        lastInput = std::chrono::steady_clock::now().time_since_epoch().count();
+        CheckIdleAfter(timeout);
+    }
+
+#ifdef CLI_USE_IO_URING
+    // The I/O of the session is made through the ring given
+    // (it must be set before Start)
+    void UseRing(std::shared_ptr<UringService> r) { ring = std::move(r); }
+#endif
+
 protected:
 
     Session(boost::asio::ip::tcp::socket _socket) : socket(std::move(_socket)), outStream( this ) {}
 
     virtual void Disconnect()
     {
-        socket.shutdown( boost::asio::ip::tcp::socket::shutdown_both );
-        socket.close();
+        SendPending();
+#ifdef CLI_USE_IO_URING
+        if ( ring )
+        {
+            // the socket is closed when the output queued is sent
+            std::lock_guard<std::mutex> lock( sendMutex );
+            if ( !sending.empty() )
+            {
+                closing = true;
+                return;
+            }
+        }
+#endif
+        Close();
     }
 
     virtual void Read()
     {
+#ifdef CLI_USE_IO_URING
+        if ( ring )
+        {
+            ReadRing();
+            return;
+        }
+#endif
       auto self( shared_from_this() );
       socket.async_read_some( boost::asio::buffer( data, max_length ),
           [ this, self ]( boost::system::error_code ec, std::size_t length )
@@ -71,6 +130,8 @@ protected:
                   OnError();
               else
               {
+                  lastInput = std::chrono::steady_clock::now().time_since_epoch().count();
+                  bytesIn += length;
                   OnDataReceived( std::string( data, length ));
                   Read();
               }
@@ -79,6 +140,14 @@ protected:
 
     virtual void Send(const std::string& msg)
     {
+        bytesOut += msg.size();
+#ifdef CLI_USE_IO_URING
+        if ( ring )
+        {
+            SendRing( msg );
+            return;
+        }
+#endif
         boost::system::error_code ec;
         boost::asio::write(socket, boost::asio::buffer(msg), ec);
         if ((ec == boost::asio::error::eof) || (ec == boost::asio::error::connection_reset))
@@ -89,31 +158,216 @@ protected:
 
     virtual std::ostream& OutStream() { return outStream; }
 
+    // Until Uncork, the output is buffered (if batching is enabled):
+    // it's sent only when the buffer is full, even if flushed.
+    // The calls can be nested.
+    void Cork()
+    {
+        if (batchOutput)
+            ++corked;
+    }
+
+    // Sends the output buffered since the outermost Cork
+    void Uncork()
+    {
+        if (corked > 0 && --corked == 0)
+            SendPending();
+    }
+
+    // Data received and sent on the socket
+    std::size_t BytesIn() const { return bytesIn; }
+    std::size_t BytesOut() const { return bytesOut; }
+
+    // Output buffered (see Cork) or queued, not sent yet
+    std::size_t PendingOutput() const
+    {
+#ifdef CLI_USE_IO_URING
+        if ( ring )
+        {
+            std::lock_guard<std::mutex> lock( sendMutex );
+            return pending.size() + outgoing.size() + sending.size() - sent;
+        }
+#endif
+        return pending.size();
+    }
+
+    // "address:port" of the remote peer (empty if not available)
+    std::string RemoteAddress() const
+    {
+        boost::system::error_code ec;
+        const auto endpoint = socket.remote_endpoint(ec);
+        if (ec) return {};
+        return endpoint.address().to_string() + ':' + std::to_string(endpoint.port());
+    }
+
     virtual void OnConnect() = 0;
     virtual void OnDisconnect() = 0;
     virtual void OnError() = 0;
     virtual void OnDataReceived(const std::string& _data) = 0;
+    // no data received for the time given to WatchIdle
+    virtual void OnIdle() { Disconnect(); }
 
     virtual std::string Encode(const std::string& _data) const { return _data; }
 
 private:
 
+    void Close()
+    {
+        boost::system::error_code ec;
+        socket.shutdown( boost::asio::ip::tcp::socket::shutdown_both, ec );
+        socket.close( ec );
+    }
+
+#ifdef CLI_USE_IO_URING
+    // a single multishot request receives all the data of the session
+    void ReadRing()
+    {
+        auto self( shared_from_this() );
+        ring->Receive( socket.native_handle(), [ this, self ]( int res, const char* buffer, std::size_t length )
+        {
+            if ( res > 0 )
+            {
+                // the data received after Disconnect is dropped
+                if ( !socket.is_open() ) return;
+                lastInput = std::chrono::steady_clock::now().time_since_epoch().count();
+                bytesIn += length;
+                OnDataReceived( std::string( buffer, length ));
+            }
+            else if ( !socket.is_open() || res == 0 || res == -ECONNRESET )
+                OnDisconnect();
+            else
+                OnError();
+        });
+    }
+
+    // one send at a time: the output written in the meantime is queued
+    // and sent by the next one, so the order is kept
+    void SendRing( const std::string& msg )
+    {
+        std::lock_guard<std::mutex> lock( sendMutex );
+        // like a closed socket, a closing one drops the output
+        if ( !socket.is_open() || closing ) return;
+        outgoing += msg;
+        if ( sending.empty() )
+            SendNext();
+    }
+
+    // (with sendMutex locked)
+    void SendNext()
+    {
+        sending.swap( outgoing );
+        sent = 0;
+        SendRemaining();
+    }
+
+    // (with sendMutex locked)
+    void SendRemaining()
+    {
+        auto self( shared_from_this() );
+        ring->Send( socket.native_handle(), sending.data() + sent, sending.size() - sent, [ this, self ]( int res )
+        {
+            bool close = false;
+            {
+                std::lock_guard<std::mutex> lock( sendMutex );
+                if ( res > 0 && ( sent += static_cast<std::size_t>( res )) < sending.size() )
+                {
+                    SendRemaining();
+                    return;
+                }
+                sending.clear();
+                if ( res < 0 )
+                    outgoing.clear();
+                else if ( !outgoing.empty() )
+                    SendNext();
+                close = closing && sending.empty();
+            }
+            if ( res == -ECONNRESET )
+                OnDisconnect();
+            else if ( res < 0 )
+                OnError();
+            if ( close )
+                Close();
+        });
+    }
+#endif
+
+    // the timer is not moved at each input: when it fires,
+    // it's scheduled again for the rest of the timeout
+    void CheckIdleAfter(std::chrono::steady_clock::duration delay)
+    {
+        std::weak_ptr<Session> weak = shared_from_this();
+        timers->Add(delay, [weak]()
+        {
+            if (auto self = weak.lock())
+                self->CheckIdle();
+        });
+    }
+
+    void CheckIdle()
+    {
+        if (!socket.is_open()) return;
+        using clock = std::chrono::steady_clock;
+        const auto idle = clock::now() - clock::time_point(clock::duration(lastInput.load()));
+        if (idle >= idleTimeout)
+            OnIdle();
+        else
+            CheckIdleAfter(idleTimeout - idle);
+    }
+
+    void Write(const std::string& encoded)
+    {
+        if (encoded.empty()) return;
+        if (corked == 0)
+        {
+            Send(encoded);
+            return;
+        }
+        pending += encoded;
+        if (pending.size() >= max_pending)
+            SendPending();
+    }
+
+    void SendPending()
+    {
+        if (pending.empty()) return;
+        std::string msg;
+        msg.swap(pending);
+        Send(msg);
+    }
+
     // std::streambuf
     std::streamsize xsputn( const char* s, std::streamsize n ) override
     {
-        Send(Encode(std::string(s, s+n)));
+        Write(Encode(std::string(s, s+n)));
         return n;
     }
     int overflow( int c ) override
     {
-        Send(Encode(std::string(1, static_cast< char >(c))));
+        Write(Encode(std::string(1, static_cast< char >(c))));
         return c;
     }
 
     boost::asio::ip::tcp::socket socket;
     enum { max_length = 1024 };
     char data[ max_length ];
+    enum { max_pending = 16 * 1024 };
+    std::string pending; // the output buffered while corked
+    bool batchOutput = false;
+    unsigned corked = 0;
+    TimerService* timers = nullptr;
+    std::chrono::steady_clock::duration idleTimeout{};
+    std::atomic<std::chrono::steady_clock::rep> lastInput{0}; // time of the last data received
+    std::atomic<std::size_t> bytesIn{0};
+    std::atomic<std::size_t> bytesOut{0};
     std::ostream outStream;
+#ifdef CLI_USE_IO_URING
+    std::shared_ptr<UringService> ring;
+    mutable std::mutex sendMutex;
+    std::string sending; // the output of the send in progress
+    std::size_t sent = 0;
+    std::string outgoing; // the output queued during the send
+    bool closing = false;
+#endif
 };
 
 
@@ -125,31 +379,161 @@ public:
     Server& operator = ( const Server& ) = delete;
 
     Server(asio::BoostExecutor::ContextType& ios, unsigned short port) :
+        context( ios ),
         acceptor( ios, boost::asio::ip::tcp::endpoint( boost::asio::ip::tcp::v4(), port )),
-        socket( ios )
+        socket( ios ),
+        timers( ios ),
+        lagMonitor( ios )
     {
-        Accept();
+        Init();
     }
     Server(asio::BoostExecutor::ContextType& ios, std::string address, unsigned short port) :
+        context( ios ),
         acceptor( ios, boost::asio::ip::tcp::endpoint(asio::IpAddressFromString(address), port)),
-        socket( ios )
+        socket( ios ),
+        timers( ios ),
+        lagMonitor( ios )
     {
-        Accept();
+        Init();
+    }
+    virtual ~Server()
+    {
+#ifdef CLI_USE_IO_URING
+        if ( ring ) ring->Stop();
+#endif
     }
-    virtual ~Server() = default;
     // returns shared_ptr instead of unique_ptr because Session needs to use enable_shared_from_this
     virtual std::shared_ptr< Session > CreateSession( boost::asio::ip::tcp::socket socket ) = 0;
+
+    // The options of the sessions accepted from now on
+    void SetTcpOptions(const TcpOptions& o) { options = o; }
+    const TcpOptions& GetTcpOptions() const { return options; }
+
+    // The sessions that receive no data for the timeout are closed
+    // (a zero timeout, the default, disables the check)
+    void IdleTimeout(std::chrono::steady_clock::duration timeout) { idleTimeout = timeout; }
+
+    // The timers shared by the sessions of the server
+    TimerService& Timers() { return timers; }
+
+    // Refuses the new connections while the io context is overloaded,
+    // i.e. its lag is over the threshold (see LagMonitor): a new session
+    // would delay the others even more.
+    // A zero threshold (the default) disables the check.
+    void ShedLoad(std::chrono::steady_clock::duration threshold,
+                  std::chrono::steady_clock::duration interval = std::chrono::milliseconds(100))
+    {
+        if ( threshold.count() > 0 )
+            lagMonitor.Start( threshold, interval );
+        else
+            lagMonitor.Stop();
+    }
+    // The monitor of the lag of the io context (running after ShedLoad)
+    LagMonitor& Lag() { return lagMonitor; }
+    // Number of connections refused by ShedLoad
+    std::size_t RefusedSessions() const { return refused; }
+
+    // The sockets I/O is made through io_uring (CLI_USE_IO_URING is defined
+    // and io_uring is supported by the kernel) or through asio
+    bool UsesIoUring() const
+    {
+#ifdef CLI_USE_IO_URING
+        return ring != nullptr;
+#else
+        return false;
+#endif
+    }
 private:
+    void Init()
+    {
+#ifdef CLI_USE_IO_URING
+        ring = std::make_shared<UringService>( context );
+        if ( !ring->Start() )
+        {
+            // io_uring is not available: asio is used
+            ring->Stop();
+            ring.reset();
+        }
+#endif
+        Accept();
+    }
     void Accept()
     {
+#ifdef CLI_USE_IO_URING
+        if ( ring )
+        {
+            AcceptRing();
+            return;
+        }
+#endif
         acceptor.async_accept( socket, [this](boost::system::error_code ec)
             {
-                if ( !ec ) CreateSession( std::move( socket ) ) -> Start();
+                if ( !ec )
+                    Open( std::move( socket ) );
                 Accept();
             });
     }
+#ifdef CLI_USE_IO_URING
+    // a single multishot request accepts all the connections
+    void AcceptRing()
+    {
+        ring->Accept( acceptor.native_handle(), [this](int res)
+            {
+                if ( res < 0 )
+                {
+                    AcceptRing();
+                    return;
+                }
+                boost::system::error_code ec;
+                boost::asio::ip::tcp::socket s( context );
+                s.assign( acceptor.local_endpoint().protocol(), res, ec );
+                if ( ec )
+                    ::close( res );
+                else
+                    Open( std::move( s ));
+            });
+    }
+#endif
+    void Open( boost::asio::ip::tcp::socket s )
+    {
+        if ( lagMonitor.Overloaded() )
+        {
+            ++refused;
+            boost::system::error_code ec;
+            boost::asio::write( s, boost::asio::buffer( std::string( "server busy, try again later\r\n" )), ec );
+            s.shutdown( boost::asio::ip::tcp::socket::shutdown_both, ec );
+            s.close( ec );
+            return;
+        }
+        ApplyOptions( s );
+        auto session = CreateSession( std::move( s ) );
+#ifdef CLI_USE_IO_URING
+        session -> UseRing( ring );
+#endif
+        session -> BatchOutput( options.batchOutput );
+        if ( idleTimeout.count() > 0 )
+            session -> WatchIdle( timers, idleTimeout );
+        session -> Start();
+    }
+    void ApplyOptions( boost::asio::ip::tcp::socket& s )
+    {
+        // the options are a hint: the errors are ignored
+        boost::system::error_code ec;
+        s.set_option( boost::asio::ip::tcp::no_delay( options.noDelay ), ec );
+        if ( options.sendBufferSize > 0 )
+            s.set_option( boost::asio::socket_base::send_buffer_size( static_cast<int>( options.sendBufferSize ) ), ec );
+    }
+    asio::BoostExecutor::ContextType& context;
     boost::asio::ip::tcp::acceptor acceptor;
     boost::asio::ip::tcp::socket socket;
+    TcpOptions options;
+    TimerService timers;
+    std::chrono::steady_clock::duration idleTimeout{};
+    LagMonitor lagMonitor;
+    std::atomic<std::size_t> refused{0};
+#ifdef CLI_USE_IO_URING
+    std::shared_ptr<UringService> ring;
+#endif
 };
 
 } // namespace detail
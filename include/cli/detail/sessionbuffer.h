@@ -0,0 +1,123 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_DETAIL_SESSIONBUFFER_H_
+#define CLI_DETAIL_SESSIONBUFFER_H_
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <streambuf>
+
+namespace cli
+{
+namespace detail
+{
+
+// Stream buffer of the output of a session: it forwards everything to the
+// buffer of the stream of the session, counting the characters written
+// (see OutputCounter). After the deadline of the command in execution
+// (see OutputDeadline) the output is discarded and the writes fail,
+// so that the stream goes in a bad state.
+// Only the thread of the session writes here: the broadcasts
+// (Cli::Broadcast, run on the thread of the session, and Cli::cout)
+// go directly to the stream of the session.
+class SessionBuffer : public std::streambuf
+{
+public:
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    explicit SessionBuffer(std::streambuf* _target) : target(_target) {}
+
+    // the characters forwarded since the creation
+    std::size_t Count() const { return count; }
+
+    // TimePoint::max() when there's no deadline
+    TimePoint Deadline() const { return deadline; }
+    void Deadline(TimePoint _deadline)
+    {
+        deadline = _deadline;
+        expired = false;
+    }
+
+    bool Expired()
+    {
+        if (!expired && deadline != TimePoint::max() && std::chrono::steady_clock::now() >= deadline)
+            expired = true;
+        return expired;
+    }
+
+protected:
+    int_type overflow(int_type c) override
+    {
+        if (traits_type::eq_int_type(c, traits_type::eof()))
+            return traits_type::not_eof(c);
+        if (Expired())
+            return traits_type::eof();
+        const auto result = target->sputc(traits_type::to_char_type(c));
+        if (!traits_type::eq_int_type(result, traits_type::eof()))
+            ++count;
+        return result;
+    }
+
+    std::streamsize xsputn(const char_type* s, std::streamsize n) override
+    {
+        if (Expired())
+            return 0;
+        const auto written = target->sputn(s, n);
+        count += static_cast<std::size_t>(written);
+        return written;
+    }
+
+    int sync() override { return Expired() ? 0 : target->pubsync(); }
+
+private:
+    std::streambuf* target;
+    std::size_t count = 0;
+    TimePoint deadline = TimePoint::max();
+    bool expired = false;
+};
+
+// the slot of the streams of the sessions that points to their SessionBuffer
+inline int SessionBufferIndex()
+{
+    static const int index = std::ios_base::xalloc();
+    return index;
+}
+
+// Returns the SessionBuffer of a stream of a session, or nullptr for the other streams
+inline SessionBuffer* SessionBufferOf(std::ostream& out)
+{
+    return static_cast<SessionBuffer*>(out.pword(SessionBufferIndex()));
+}
+
+} // namespace detail
+} // namespace cli
+
+#endif // CLI_DETAIL_SESSIONBUFFER_H_
@@ -0,0 +1,154 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_DETAIL_SESSIONSTATE_H_
+#define CLI_DETAIL_SESSIONSTATE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "../sessioninfo.h"
+
+namespace cli
+{
+namespace detail
+{
+
+// The part of a session that the other threads can use (see Cli::Sessions,
+// Cli::KillSession and Cli::Broadcast): the state published by the session
+// while it changes, and the way to run a task on the thread of the session.
+// It lives until the last task posted to the session has run.
+class SessionState : public std::enable_shared_from_this<SessionState>
+{
+public:
+    // posts a task to the thread of the session
+    using Executor = std::function<void(std::function<void()>)>;
+
+    SessionState(std::size_t _id, std::chrono::system_clock::time_point _start) :
+        id(_id), start(_start)
+    {}
+
+    // written by the thread of the session only
+    std::atomic<std::size_t> commands{0};
+    std::atomic<std::size_t> bytesIn{0};
+    std::atomic<std::size_t> bytesOut{0};
+    std::atomic<std::size_t> pendingOutput{0};
+    std::atomic<std::chrono::microseconds::rep> cpuTime{0};
+
+    void Peer(std::string p)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        peer = std::move(p);
+    }
+
+    void MenuPath(std::string path)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        menuPath = std::move(path);
+    }
+
+    SessionInfo Info() const
+    {
+        SessionInfo info;
+        info.id = id;
+        info.start = start;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            info.peer = peer;
+            info.menuPath = menuPath;
+        }
+        info.commands = commands;
+        info.bytesIn = bytesIn;
+        info.bytesOut = bytesOut;
+        info.pendingOutput = pendingOutput;
+        info.cpuTime = std::chrono::microseconds(cpuTime);
+        return info;
+    }
+
+    void SetExecutor(Executor ex)
+    {
+        std::lock_guard<std::recursive_mutex> lock(runMtx);
+        executor = std::move(ex);
+    }
+
+    // Runs the task on the thread of the session, unless the session is closed
+    // (returns false in that case). A session without an executor runs
+    // the task at once, in the thread of the caller.
+    bool Run(std::function<void()> task)
+    {
+        std::lock_guard<std::recursive_mutex> lock(runMtx);
+        if (closed) return false;
+        if (!executor)
+        {
+            // the session can't close in the meantime
+            task();
+            return true;
+        }
+        auto self = shared_from_this();
+        executor([self, t = std::move(task)]()
+        {
+            // the session closes in its own thread: it's still alive
+            if (self->Open()) t();
+        });
+        return true;
+    }
+
+    // Called by the session when it's destroyed: the tasks not run yet are dropped
+    void Close()
+    {
+        std::lock_guard<std::recursive_mutex> lock(runMtx);
+        closed = true;
+        executor = nullptr;
+    }
+
+private:
+    bool Open() const
+    {
+        std::lock_guard<std::recursive_mutex> lock(runMtx);
+        return !closed;
+    }
+
+    const std::size_t id;
+    const std::chrono::system_clock::time_point start;
+    mutable std::mutex mtx; // of peer and menuPath
+    std::string peer;
+    std::string menuPath;
+    mutable std::recursive_mutex runMtx; // of executor and closed (a task can run another one)
+    Executor executor;
+    bool closed = false;
+};
+
+} // namespace detail
+} // namespace cli
+
+#endif // CLI_DETAIL_SESSIONSTATE_H_
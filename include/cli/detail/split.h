@@ -30,6 +30,8 @@
 #ifndef CLI_DETAIL_SPLIT_H_
 #define CLI_DETAIL_SPLIT_H_
 
+#include <cassert>
+#include <cstddef>
 #include <string>
 #include <vector>
 #include <algorithm>
@@ -39,27 +41,40 @@ namespace cli
 namespace detail
 {
 
+// Container can be any sequence of std::string or std::pmr::string
+// (e.g., std::vector<std::string> or the tokens allocated by the session,
+// see CommandMemory::MakeTokens): the tokens are built in place
+template <typename Container>
 class Text
 {
 public:
     explicit Text(const std::string& _input) : input(_input)
     {
     }
-    void SplitInto(std::vector<std::string>& strs)
+    // If operators is not null, it gets the positions in strs of the
+    // tokens "&&" and "||" written without quotes or escapes.
+    // If quotedTokens is not null, it gets the positions of the tokens
+    // written between quotes or double quotes
+    void SplitInto(Container& strs, std::vector<std::size_t>* operators = nullptr, std::vector<std::size_t>* quotedTokens = nullptr)
     {
-        Reset();
+        Reset(strs);
+        ops = operators;
+        if (ops) ops->clear();
+        quotes = quotedTokens;
+        if (quotes) quotes->clear();
         for (char c: input)
             Eval(c);
+        EndToken();
         RemoveEmptyEntries();
-        splitResult.swap(strs); // puts the result back in strs
     }
 private:
-    void Reset()
+    void Reset(Container& strs)
     {
         state = State::space;
         prev_state = State::space;
         sentence_type = SentenceType::double_quote;
-        splitResult.clear();
+        splitResult = &strs;
+        splitResult->clear();
     }
 
     void Eval(char c)
@@ -97,12 +112,13 @@ private:
             // Should come back into the word state after this.
             prev_state = State::word;
             state = State::escape;
-            splitResult.push_back("");
+            Push(false);
         }
         else
         {
             state = State::word;
-            splitResult.push_back(std::string(1, c));
+            Push(true);
+            splitResult->back() += c;
         }
     }
 
@@ -120,11 +136,12 @@ private:
         {
             prev_state = state;
             state = State::escape;
+            plain = false;
         }
         else
         {
-            assert(!splitResult.empty());
-            splitResult.back() += c;
+            assert(!splitResult->empty());
+            splitResult->back() += c;
         }
     }
 
@@ -137,8 +154,8 @@ private:
                 state = State::space;
             else
             {
-                assert(!splitResult.empty());
-                splitResult.back() += c;
+                assert(!splitResult->empty());
+                splitResult->back() += c;
             }
         }
         else if (c == '\\')
@@ -148,17 +165,17 @@ private:
         }
         else
         {
-            assert(!splitResult.empty());
-            splitResult.back() += c;
+            assert(!splitResult->empty());
+            splitResult->back() += c;
         }
     }
 
     void EvalEscape(char c)
     {
-        assert(!splitResult.empty());
+        assert(!splitResult->empty());
         if (c != '"' && c != '\'' && c != '\\')
-            splitResult.back() += "\\";
-        splitResult.back() += c;
+            splitResult->back() += "\\";
+        splitResult->back() += c;
         state = prev_state;
     }
 
@@ -166,19 +183,58 @@ private:
     {
         state = State::sentence;
         sentence_type = ( c == '"' ? SentenceType::double_quote : SentenceType::quote);
-        splitResult.push_back("");
+        Push(false);
+        if (quotes) quotes->push_back(splitResult->size() - 1);
+    }
+
+    // Starts a new token: plain if it has no quotes or escapes (until now)
+    void Push(bool isPlain)
+    {
+        EndToken();
+        splitResult->emplace_back();
+        plain = isPlain;
+    }
+
+    void EndToken()
+    {
+        if (ops && plain && !splitResult->empty())
+        {
+            const auto& t = splitResult->back();
+            if (t == "&&" || t == "||")
+                ops->push_back(splitResult->size() - 1);
+        }
+        plain = false;
     }
 
     void RemoveEmptyEntries()
     {
+        // the operators and the quoted tokens go back of the empty entries before them
+        // (the empty quoted ones are removed)
+        const auto shift = [this](std::vector<std::size_t>& positions)
+        {
+            for (auto& i: positions)
+                i -= static_cast<std::size_t>(std::count_if(
+                    splitResult->begin(),
+                    splitResult->begin() + static_cast<std::ptrdiff_t>(i),
+                    [](const auto& s){ return s.empty(); }
+                ));
+        };
+        if (quotes)
+            quotes->erase(
+                std::remove_if(quotes->begin(), quotes->end(), [this](std::size_t i){ return (*splitResult)[i].empty(); }),
+                quotes->end()
+            );
+        if (ops) shift(*ops);
+        if (quotes) shift(*quotes);
+
         // remove null entries from the vector:
-        splitResult.erase(
+        splitResult->erase(
             std::remove_if(
-                splitResult.begin(),
-                splitResult.end(),
-                [](const std::string& s){ return s.empty(); }
+                splitResult->begin(),
+                splitResult->end(),
+                [](const auto& s){ return s.empty(); }
             ),
-            splitResult.end()
+            splitResult->end()
         );
     }
 
@@ -187,8 +243,11 @@ private:
     State state = State::space;
     State prev_state = State::space;
     SentenceType sentence_type = SentenceType::double_quote;
-    const std::string input;
-    std::vector<std::string> splitResult;
+    const std::string& input;
+    Container* splitResult = nullptr;
+    std::vector<std::size_t>* ops = nullptr;
+    std::vector<std::size_t>* quotes = nullptr;
+    bool plain = false; // the last token has no quotes or escapes
 };
 
 // Split the string input into a vector of strings.
@@ -225,12 +284,33 @@ private:
 //          split(strs, R"("foo\bar")"); // "foo\bar" => <"foo\bar">
 //          split(strs, R"("foo\\"bar")"); // "foo\\"bar" => <"foo\"bar">
 
-inline void split(std::vector<std::string>& strs, const std::string& input)
+template <typename Container>
+inline void split(Container& strs, const std::string& input)
 {
-    Text sentence(input);
+    Text<Container> sentence(input);
     sentence.SplitInto(strs);
 }
 
+// Like split, and puts in operators the positions of the tokens
+// "&&" and "||" not quoted nor escaped, e.g.:
+//          split(strs, ops, R"(a && "&&" \|| b)"); => <"a","&&","&&","||","b">, ops <1>
+template <typename Container>
+inline void split(Container& strs, std::vector<std::size_t>& operators, const std::string& input)
+{
+    Text<Container> sentence(input);
+    sentence.SplitInto(strs, &operators);
+}
+
+// Like split with the operators, and puts in quoted the positions of the
+// tokens written between quotes (so that the script doesn't expand them), e.g.:
+//          split(strs, ops, quoted, R"(echo '$x' "" "$y" $z)"); => <"echo","$x","$y","$z">, quoted <1,2>
+template <typename Container>
+inline void split(Container& strs, std::vector<std::size_t>& operators, std::vector<std::size_t>& quoted, const std::string& input)
+{
+    Text<Container> sentence(input);
+    sentence.SplitInto(strs, &operators, &quoted);
+}
+
 } // namespace detail
 } // namespace cli
 
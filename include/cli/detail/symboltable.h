@@ -0,0 +1,217 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_DETAIL_SYMBOLTABLE_H_
+#define CLI_DETAIL_SYMBOLTABLE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "commandmemory.h"
+
+namespace cli
+{
+namespace detail
+{
+
+using SymbolId = std::uint32_t;
+constexpr SymbolId noSymbol = 0;
+
+// Interned command names: each distinct name is stored once and gets
+// an id, so that the dispatch can compare integers instead of strings.
+// The names are added when the commands are inserted in the menus,
+// under a mutex. Once frozen (when the setup is done, see Freeze), the
+// sessions look them up without locks in an immutable snapshot: a name
+// added later (e.g., by a command inserted at run time) publishes
+// a new snapshot (once for all the names added in a Batch), and the old
+// ones are deleted as soon as no lookup is in progress.
+class SymbolTable
+{
+public:
+    // The names added during its lifetime (e.g., the commands of a menu
+    // inserted at run time) are published at once, at its destruction
+    class Batch
+    {
+    public:
+        explicit Batch(SymbolTable& _table) : table(_table)
+        {
+            std::lock_guard<std::mutex> lock(table.mtx);
+            ++table.batches;
+        }
+        ~Batch()
+        {
+            std::lock_guard<std::mutex> lock(table.mtx);
+            if (--table.batches == 0 && table.pending)
+                table.Publish();
+        }
+        Batch(const Batch&) = delete;
+        Batch& operator = (const Batch&) = delete;
+    private:
+        SymbolTable& table;
+    };
+
+    // Returns the id of name, adding it if it's not there yet
+    SymbolId Intern(const std::string& name)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        const auto i = ids.emplace(Token(name), static_cast<SymbolId>(ids.size() + 1));
+        if (i.second && frozen)
+        {
+            if (batches > 0)
+                pending = true;
+            else
+                Publish();
+        }
+        else
+            Reclaim();
+        return i.first->second;
+    }
+
+    // From now on, the lookups don't take the mutex
+    void Freeze()
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (frozen) return;
+        frozen = true;
+        Publish();
+    }
+
+    // Returns the id of name (noSymbol if it's not there)
+    SymbolId Find(const std::string& name) const
+    {
+        Reader reader(*this);
+        if (const Ids* snapshot = reader.Snapshot())
+            return Lookup(*snapshot, name);
+        std::lock_guard<std::mutex> lock(mtx);
+        return Lookup(ids, name);
+    }
+
+    // Writes in out the ids of the strings in [first, last) that can be
+    // command names: the lookup stops at the first string that is not a name
+    // (the following ones are parameters), leaving out untouched
+    template <typename InputIt, typename OutputIt>
+    void Find(InputIt first, InputIt last, OutputIt out) const
+    {
+        const auto find = [&](const Ids& table)
+        {
+            for (; first != last; ++first, ++out)
+            {
+                const auto id = Lookup(table, *first);
+                if (id == noSymbol) return;
+                *out = id;
+            }
+        };
+        Reader reader(*this);
+        if (const Ids* snapshot = reader.Snapshot())
+            return find(*snapshot);
+        std::lock_guard<std::mutex> lock(mtx);
+        find(ids);
+    }
+
+    std::size_t Size() const
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return ids.size();
+    }
+
+    // Number of snapshots in memory: the published one and the old ones
+    // not deleted yet
+    std::size_t Snapshots() const
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return retired.size() + (current ? 1 : 0);
+    }
+
+private:
+    // (keyed by Token, so that the tokens of the sessions are looked up without copies)
+    using Ids = std::unordered_map<Token, SymbolId>;
+
+    static SymbolId Lookup(const Ids& table, const Token& name)
+    {
+        const auto i = table.find(name);
+        return i == table.end() ? noSymbol : i->second;
+    }
+#ifdef CLI_HAS_PMR
+    static SymbolId Lookup(const Ids& table, const std::string& name) { return Lookup(table, Token(name)); }
+#endif
+
+    // A lookup in the published snapshot: while any is in progress, the old
+    // snapshots are not deleted. The writer stores the new snapshot before
+    // reading the count, and the readers count themselves before loading
+    // the snapshot (all sequentially consistent): if the writer reads zero,
+    // the readers coming later can only load the new one.
+    class Reader
+    {
+    public:
+        explicit Reader(const SymbolTable& _table) : table(_table) { ++table.readers; }
+        ~Reader() { table.readers.fetch_sub(1, std::memory_order_release); }
+        Reader(const Reader&) = delete;
+        Reader& operator = (const Reader&) = delete;
+        const Ids* Snapshot() const { return table.published.load(); }
+    private:
+        const SymbolTable& table;
+    };
+
+    // (with the mutex locked)
+    void Publish()
+    {
+        pending = false;
+        if (current) retired.push_back(std::move(current));
+        current = std::make_unique<const Ids>(ids);
+        published.store(current.get());
+        Reclaim();
+    }
+
+    // Deletes the old snapshots, if no lookup can be using them
+    // (with the mutex locked)
+    void Reclaim()
+    {
+        if (!retired.empty() && readers.load() == 0)
+            retired.clear();
+    }
+
+    mutable std::mutex mtx;
+    Ids ids;
+    bool frozen = false;
+    unsigned batches = 0; // alive (see Batch)
+    bool pending = false; // names added during a batch, not published yet
+    std::unique_ptr<const Ids> current; // the snapshot published
+    std::vector<std::unique_ptr<const Ids>> retired; // the ones published before
+    std::atomic<const Ids*> published{nullptr};
+    mutable std::atomic<std::size_t> readers{0}; // lookups in progress (see Reader)
+};
+
+} // namespace detail
+} // namespace cli
+
+#endif // CLI_DETAIL_SYMBOLTABLE_H_
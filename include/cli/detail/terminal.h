@@ -56,27 +56,44 @@ class Terminal
 
     void ResetCursor() { position = 0; }
 
+    // The width of the terminal (0 when unknown) and the column where the
+    // line starts (i.e., the size of the prompt).
+    // When the width is known the cursor is moved with the shortest ANSI
+    // sequences, that work on wrapped lines too, otherwise with backspaces.
+    void Layout(std::size_t _width, std::size_t _origin)
+    {
+        width = _width;
+        origin = _origin;
+    }
+
     void SetLine(const std::string &newLine)
     {
-        out << beforeInput
-            << std::string(position, '\b') << newLine
-            << afterInput << std::flush;
+        MoveBack(position, 0);
 
         // if newLine is shorter then currentLine, we have
         // to clear the rest of the string
-        if (newLine.size() < currentLine.size())
-        {
-            out << std::string(currentLine.size() - newLine.size(), ' ');
-            // and go back
-            out << std::string(currentLine.size() - newLine.size(), '\b') << std::flush;
-        }
+        const std::size_t clear = newLine.size() < currentLine.size() ? currentLine.size() - newLine.size() : 0;
 
         currentLine = newLine;
         position = currentLine.size();
+        Redraw(0, clear);
     }
 
     std::string GetLine() const { return currentLine; }
 
+    // Inserts text at the cursor position with a single redraw
+    // (used for the pasted text, that is not typed char by char)
+    void Insert(const std::string& text)
+    {
+        if (text.empty())
+            return;
+
+        const auto from = position;
+        currentLine.insert(position, text);
+        position += text.size();
+        Redraw(from, 0);
+    }
+
     std::pair<Symbol, std::string> Keypressed(std::pair<KeyType, char> k)
     {
         switch (k.first)
@@ -95,13 +112,9 @@ class Terminal
                 // remove the char from buffer
                 currentLine.erase(currentLine.begin() + pos);
                 // go back to the previous char
-                out << '\b';
-                // output the rest of the line
-                out << std::string(currentLine.begin() + pos, currentLine.end());
-                // remove last char
-                out << ' ';
-                // go back to the original position
-                out << std::string(currentLine.size() - position + 1, '\b') << std::flush;
+                MoveBack(position + 1, position);
+                // output the rest of the line and remove the last char
+                Redraw(position, 1);
                 break;
             }
             case KeyType::up:
@@ -113,7 +126,8 @@ class Terminal
             case KeyType::left:
                 if (position > 0)
                 {
-                    out << '\b' << std::flush;
+                    MoveBack(position, position - 1);
+                    out << std::flush;
                     --position;
                 }
                 break;
@@ -122,12 +136,17 @@ class Terminal
                 {
                     out << beforeInput
                         << currentLine[position]
-                        << afterInput << std::flush;
+                        << afterInput;
                     ++position;
+                    Wrap(position);
+                    out << std::flush;
                 }
                 break;
             case KeyType::ret:
             {
+                // a wrapped line continues after the cursor
+                if (width > 0 && position < currentLine.size())
+                    out << beforeInput << currentLine.substr(position) << afterInput;
                 out << "\r\n";
                 auto cmd = currentLine;
                 currentLine.clear();
@@ -144,18 +163,12 @@ class Terminal
                 {
                     const auto pos = static_cast<std::string::difference_type>(position);
 
-                    // output the new char:
-                    out << beforeInput << c;
-                    // and the rest of the string:
-                    out << std::string(currentLine.begin() + pos, currentLine.end())
-                        << afterInput;
-
-                    // go back to the original position
-                    out << std::string(currentLine.size() - position, '\b') << std::flush;
-
                     // update the buffer and cursor position:
                     currentLine.insert(currentLine.begin() + pos, c);
                     ++position;
+
+                    // output the new char and the rest of the string
+                    Redraw(position - 1, 0);
                 }
 
                 break;
@@ -167,14 +180,10 @@ class Terminal
 
                 const auto pos = static_cast<std::string::difference_type>(position);
 
-                // output the rest of the line
-                out << std::string(currentLine.begin() + pos + 1, currentLine.end());
-                // remove last char
-                out << ' ';
-                // go back to the original position
-                out << std::string(currentLine.size() - position, '\b') << std::flush;
                 // remove the char from buffer
                 currentLine.erase(currentLine.begin() + pos);
+                // output the rest of the line and remove the last char
+                Redraw(position, 1);
                 break;
             }
             case KeyType::end:
@@ -183,13 +192,17 @@ class Terminal
 
                 out << beforeInput
                     << std::string(currentLine.begin() + pos, currentLine.end())
-                    << afterInput << std::flush;
+                    << afterInput;
+                if (position < currentLine.size())
+                    Wrap(currentLine.size());
+                out << std::flush;
                 position = currentLine.size();
                 break;
             }
             case KeyType::home:
             {
-                out << std::string(position, '\b') << std::flush;
+                MoveBack(position, 0);
+                out << std::flush;
                 position = 0;
                 break;
             }
@@ -202,8 +215,64 @@ class Terminal
     }
 
   private:
+
+    // Outputs the line from the index "from" (where the cursor is),
+    // clears "clear" chars after its end and goes back to position
+    void Redraw(std::size_t from, std::size_t clear)
+    {
+        out << beforeInput
+            << currentLine.substr(from)
+            << afterInput
+            << std::string(clear, ' ');
+        const auto end = currentLine.size() + clear;
+        if (end > from)
+            Wrap(end);
+        // go back to the original position
+        MoveBack(end, position);
+        out << std::flush;
+    }
+
+    // after a char written in the last column the cursor stays there:
+    // this moves it to the beginning of the next row
+    void Wrap(std::size_t index)
+    {
+        if (width > 0 && (origin + index) % width == 0)
+            out << " \b";
+    }
+
+    // moves the cursor from the index "from" to the index "to" of the line
+    void MoveBack(std::size_t from, std::size_t to)
+    {
+        if (from <= to)
+            return;
+        if (width == 0)
+        {
+            out << std::string(from - to, '\b');
+            return;
+        }
+        const auto fromRow = (origin + from) / width;
+        const auto fromCol = (origin + from) % width;
+        const auto toRow = (origin + to) / width;
+        const auto toCol = (origin + to) % width;
+        if (fromRow > toRow)
+            out << "\x1B[" << (fromRow - toRow) << 'A';
+        if (fromCol > toCol)
+        {
+            const auto n = fromCol - toCol;
+            // the backspaces are shorter for a few columns
+            if (n <= 3 + std::to_string(n).size())
+                out << std::string(n, '\b');
+            else
+                out << "\x1B[" << n << 'D';
+        }
+        else if (toCol > fromCol)
+            out << "\x1B[" << (toCol - fromCol) << 'C';
+    }
+
     std::string currentLine;
     std::size_t position = 0; // next writing position in currentLine
+    std::size_t width = 0; // of the terminal (0 if unknown)
+    std::size_t origin = 0; // column of the beginning of the line
     std::ostream &out;
 };
 
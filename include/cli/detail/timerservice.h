@@ -0,0 +1,166 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_DETAIL_TIMERSERVICE_H_
+#define CLI_DETAIL_TIMERSERVICE_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "boostasio.h"
+#include "timingwheel.h"
+
+namespace cli
+{
+namespace detail
+{
+
+// Timers shared by all the sessions of a server: they're kept in a
+// TimingWheel driven by a single asio timer, that ticks only while
+// there are timers scheduled. A timer fires in the thread running the
+// io context, not before its delay and at most a tick after it.
+// Add and Cancel can be called from any thread.
+class TimerService
+{
+public:
+    using Id = TimingWheel::Id;
+
+    explicit TimerService(asio::BoostExecutor::ContextType& ios, std::chrono::milliseconds tick = std::chrono::milliseconds(10)) :
+        core(std::make_shared<Core>(ios, tick))
+    {}
+
+    // disable value semantics
+    TimerService(const TimerService&) = delete;
+    TimerService& operator = (const TimerService&) = delete;
+
+    ~TimerService()
+    {
+        std::lock_guard<std::mutex> lock(core->mtx);
+        core->timer.cancel();
+    }
+
+    // Calls cb after the delay
+    template <typename F>
+    Id Add(std::chrono::steady_clock::duration delay, F&& cb)
+    {
+        std::lock_guard<std::mutex> lock(core->mtx);
+        const auto current = std::chrono::steady_clock::now();
+        // the empty wheel is not advanced by the timer: it's brought up to date here
+        if (core->wheel.Size() == 0)
+        {
+            const auto tick = core->TickOf(current);
+            if (tick > core->wheel.Now())
+                core->wheel.Advance(tick - core->wheel.Now());
+        }
+        // the ticks are counted from the creation of the service
+        // (rounding up, so that the timer does not fire before the delay)
+        const auto target = core->TickOf(current + delay + core->tick - std::chrono::nanoseconds(1));
+        const auto now = core->wheel.Now();
+        const auto id = core->wheel.Add(target > now ? target - now : 1, std::forward<F>(cb));
+        if (!core->armed)
+            Arm(core);
+        return id;
+    }
+
+    // Removes a timer that has not fired yet (returns false if it does not exist)
+    bool Cancel(Id id)
+    {
+        std::lock_guard<std::mutex> lock(core->mtx);
+        return core->wheel.Cancel(id);
+    }
+
+    std::size_t Size() const
+    {
+        std::lock_guard<std::mutex> lock(core->mtx);
+        return core->wheel.Size();
+    }
+
+private:
+
+    struct Core
+    {
+        Core(asio::BoostExecutor::ContextType& ios, std::chrono::milliseconds t) :
+            timer(ios), tick(t), start(std::chrono::steady_clock::now())
+        {}
+        std::uint64_t TickOf(std::chrono::steady_clock::time_point t) const
+        {
+            return static_cast<std::uint64_t>((t - start) / tick);
+        }
+        std::mutex mtx;
+        boost::asio::steady_timer timer;
+        TimingWheel wheel;
+        const std::chrono::steady_clock::duration tick;
+        const std::chrono::steady_clock::time_point start;
+        bool armed = false;
+    };
+
+    // waits for the next tick (with the mutex locked)
+    static void Arm(const std::shared_ptr<Core>& c)
+    {
+        c->armed = true;
+        c->timer.expires_at(c->start + c->tick * static_cast<std::int64_t>(c->wheel.Now() + 1));
+        std::weak_ptr<Core> weak = c;
+        c->timer.async_wait([weak](const boost::system::error_code& ec)
+        {
+            if (ec) return;
+            if (auto core = weak.lock())
+                Expired(core);
+        });
+    }
+
+    // advances the wheel to the current time, firing the expired timers
+    static void Expired(const std::shared_ptr<Core>& c)
+    {
+        std::vector<TimingWheel::Callback> expired;
+        {
+            std::lock_guard<std::mutex> lock(c->mtx);
+            const auto target = c->TickOf(std::chrono::steady_clock::now());
+            while (c->wheel.Now() < target && c->wheel.Size() > 0)
+                c->wheel.Tick(expired);
+            if (c->wheel.Size() == 0)
+                c->wheel.Advance(target - std::min(target, c->wheel.Now()));
+            c->armed = false;
+            if (c->wheel.Size() > 0)
+                Arm(c);
+        }
+        // the callbacks can add and cancel timers
+        for (auto& cb: expired)
+            cb();
+    }
+
+    std::shared_ptr<Core> core;
+};
+
+} // namespace detail
+} // namespace cli
+
+#endif // CLI_DETAIL_TIMERSERVICE_H_
@@ -0,0 +1,228 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_DETAIL_TIMINGWHEEL_H_
+#define CLI_DETAIL_TIMINGWHEEL_H_
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace cli
+{
+namespace detail
+{
+
+// Hierarchical timing wheel: the timers are kept in the slots of four
+// wheels of 256 slots each, where a slot of a wheel spans a whole turn
+// of the wheel below. Adding and cancelling a timer is O(1); the timers
+// of an upper wheel are moved down (cascade) when their slot is reached,
+// and fire from the lowest wheel at their exact tick.
+// The time is measured in ticks and advanced by the owner (see TimerService).
+// NB: the class is not thread safe.
+class TimingWheel
+{
+public:
+    using Callback = std::function<void()>;
+    // identifies a timer (index and generation of its node): 0 is never used
+    using Id = std::uint64_t;
+
+    TimingWheel() { heads.fill(none); }
+
+    // disable value semantics
+    TimingWheel(const TimingWheel&) = delete;
+    TimingWheel& operator = (const TimingWheel&) = delete;
+
+    // the current tick
+    std::uint64_t Now() const { return now; }
+
+    // number of timers scheduled
+    std::size_t Size() const { return size; }
+
+    // Schedules cb after the given number of ticks (at least one)
+    Id Add(std::uint64_t ticks, Callback cb)
+    {
+        const auto n = Allocate();
+        Node& node = nodes[n];
+        node.expiry = now + (ticks == 0 ? 1 : ticks);
+        node.callback = std::move(cb);
+        Place(n);
+        ++size;
+        return static_cast<Id>(node.generation) << 32 | n;
+    }
+
+    // Removes a timer that has not fired yet. Returns false if the timer
+    // does not exist anymore
+    bool Cancel(Id id)
+    {
+        const auto n = static_cast<std::uint32_t>(id);
+        if (n >= nodes.size() || nodes[n].generation != static_cast<std::uint32_t>(id >> 32) || nodes[n].slot == none)
+            return false;
+        Unlink(n);
+        Release(n);
+        --size;
+        return true;
+    }
+
+    // Advances the time by the given number of ticks, calling the
+    // callbacks of the timers that expire (a callback can add and cancel timers)
+    void Advance(std::uint64_t ticks)
+    {
+        std::vector<Callback> expired;
+        for (; ticks > 0; --ticks)
+        {
+            if (size == 0)
+            {
+                // nothing can fire (or cascade) until the end
+                now += ticks;
+                return;
+            }
+            Tick(expired);
+            for (auto& cb: expired)
+                cb();
+            expired.clear();
+        }
+    }
+
+    // Advances the time by one tick, appending the callbacks of the
+    // timers that expire to expired, without calling them
+    void Tick(std::vector<Callback>& expired)
+    {
+        ++now;
+        // the cascades go from the top, so that a timer can move down more wheels
+        for (unsigned level = levels - 1; level > 0; --level)
+        {
+            if ((now & ((std::uint64_t(1) << (bits * level)) - 1)) != 0)
+                continue;
+            const auto slot = level * slots + ((now >> (bits * level)) & (slots - 1));
+            auto n = heads[slot];
+            heads[slot] = none;
+            while (n != none)
+            {
+                const auto next = nodes[n].next;
+                Place(n);
+                n = next;
+            }
+        }
+
+        // the timers of the current slot of the lowest wheel expire now
+        const auto slot = static_cast<std::uint32_t>(now & (slots - 1));
+        auto n = heads[slot];
+        heads[slot] = none;
+        while (n != none)
+        {
+            const auto next = nodes[n].next;
+            expired.push_back(std::move(nodes[n].callback));
+            Release(n);
+            --size;
+            n = next;
+        }
+    }
+
+private:
+
+    enum : unsigned { bits = 8, slots = 1u << bits, levels = 4 };
+    enum : std::uint32_t { none = 0xFFFFFFFF };
+
+    struct Node
+    {
+        std::uint64_t expiry = 0;
+        Callback callback;
+        std::uint32_t prev = none;
+        std::uint32_t next = none;    // in the slot, or in the free list
+        std::uint32_t slot = none;    // none when the node is free
+        std::uint32_t generation = 1;
+    };
+
+    // puts the node in the slot of its expiry, in the lowest wheel that can hold it
+    void Place(std::uint32_t n)
+    {
+        Node& node = nodes[n];
+        const std::uint64_t maxDelay = (std::uint64_t(1) << (bits * levels)) - 1;
+        // the farther timers wait in the top wheel, and are placed again later
+        const auto expiry = node.expiry - now > maxDelay ? now + maxDelay : node.expiry;
+        const auto delay = expiry - now;
+        unsigned level = 0;
+        while (level + 1 < levels && delay >= (std::uint64_t(1) << (bits * (level + 1))))
+            ++level;
+        const auto slot = static_cast<std::uint32_t>(level * slots + ((expiry >> (bits * level)) & (slots - 1)));
+        node.slot = slot;
+        node.prev = none;
+        node.next = heads[slot];
+        if (node.next != none)
+            nodes[node.next].prev = n;
+        heads[slot] = n;
+    }
+
+    void Unlink(std::uint32_t n)
+    {
+        Node& node = nodes[n];
+        if (node.prev != none)
+            nodes[node.prev].next = node.next;
+        else
+            heads[node.slot] = node.next;
+        if (node.next != none)
+            nodes[node.next].prev = node.prev;
+    }
+
+    std::uint32_t Allocate()
+    {
+        if (freeList == none)
+        {
+            nodes.emplace_back();
+            return static_cast<std::uint32_t>(nodes.size() - 1);
+        }
+        const auto n = freeList;
+        freeList = nodes[n].next;
+        return n;
+    }
+
+    void Release(std::uint32_t n)
+    {
+        Node& node = nodes[n];
+        node.callback = nullptr;
+        node.slot = none;
+        ++node.generation; // the ids of the old timer are not valid anymore
+        node.next = freeList;
+        freeList = n;
+    }
+
+    std::uint64_t now = 0;
+    std::size_t size = 0;
+    std::vector<Node> nodes;
+    std::uint32_t freeList = none;
+    std::array<std::uint32_t, slots * levels> heads;
+};
+
+} // namespace detail
+} // namespace cli
+
+#endif // CLI_DETAIL_TIMINGWHEEL_H_
@@ -0,0 +1,523 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_DETAIL_URING_H_
+#define CLI_DETAIL_URING_H_
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "boostasio.h"
+
+namespace cli
+{
+namespace detail
+{
+
+// A submission and a completion queue of io_uring, used through the
+// system calls (liburing is not required). Not thread safe.
+class Uring
+{
+public:
+    explicit Uring(unsigned entries)
+    {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = entries * 8; // a multishot request posts many completions
+        fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0) return;
+
+        sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single)
+            sqSize = cqSize = std::max(sqSize, cqSize);
+        sqRing = Map(sqSize, IORING_OFF_SQ_RING);
+        cqRing = single ? sqRing : Map(cqSize, IORING_OFF_CQ_RING);
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(Map(sqesSize, IORING_OFF_SQES));
+        if (sqRing == nullptr || cqRing == nullptr || sqes == nullptr)
+        {
+            Close();
+            return;
+        }
+
+        sqHead = At<unsigned>(sqRing, params.sq_off.head);
+        sqTail = At<unsigned>(sqRing, params.sq_off.tail);
+        sqMask = *At<unsigned>(sqRing, params.sq_off.ring_mask);
+        sqEntries = params.sq_entries;
+        cqHead = At<unsigned>(cqRing, params.cq_off.head);
+        cqTail = At<unsigned>(cqRing, params.cq_off.tail);
+        cqMask = *At<unsigned>(cqRing, params.cq_off.ring_mask);
+        cqes = At<io_uring_cqe>(cqRing, params.cq_off.cqes);
+        // the sqes are used in order: the index array is the identity
+        unsigned* array = At<unsigned>(sqRing, params.sq_off.array);
+        for (unsigned i = 0; i < sqEntries; ++i)
+            array[i] = i;
+        local = *sqTail;
+    }
+
+    ~Uring() { Close(); }
+
+    // disable value semantics
+    Uring(const Uring&) = delete;
+    Uring& operator = (const Uring&) = delete;
+
+    bool Ok() const { return fd >= 0; }
+    int Fd() const { return fd; }
+
+    void Close()
+    {
+        if (sqes != nullptr) munmap(sqes, sqesSize);
+        if (cqRing != nullptr && cqRing != sqRing) munmap(cqRing, cqSize);
+        if (sqRing != nullptr) munmap(sqRing, sqSize);
+        if (fd >= 0) close(fd);
+        sqes = nullptr;
+        sqRing = cqRing = nullptr;
+        fd = -1;
+    }
+
+    // A cleared sqe, or nullptr if the queue is full (until Submit)
+    io_uring_sqe* Sqe()
+    {
+        if (local - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqEntries)
+            return nullptr;
+        io_uring_sqe* sqe = &sqes[local & sqMask];
+        std::memset(sqe, 0, sizeof(*sqe));
+        ++local;
+        return sqe;
+    }
+
+    // Passes the sqes to the kernel (returns the number submitted or -errno)
+    int Submit()
+    {
+        __atomic_store_n(sqTail, local, __ATOMIC_RELEASE);
+        const unsigned count = local - submitted;
+        if (count == 0) return 0;
+        const int res = static_cast<int>(syscall(__NR_io_uring_enter, fd, count, 0, 0, nullptr, 0));
+        if (res < 0) return -errno;
+        submitted += static_cast<unsigned>(res);
+        return res;
+    }
+
+    // Calls f for each completion available
+    template <typename F>
+    void Completions(F&& f)
+    {
+        unsigned head = *cqHead;
+        const unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head)
+            f(cqes[head & cqMask]);
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+    }
+
+    int Register(unsigned opcode, void* arg, unsigned args)
+    {
+        const auto res = syscall(__NR_io_uring_register, fd, opcode, arg, args);
+        return res < 0 ? -errno : static_cast<int>(res);
+    }
+
+private:
+    void* Map(std::size_t size, off_t offset)
+    {
+        void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+        return p == MAP_FAILED ? nullptr : p;
+    }
+    template <typename T>
+    static T* At(void* base, std::uint32_t offset)
+    {
+        return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+    }
+
+    int fd = -1;
+    void* sqRing = nullptr;
+    void* cqRing = nullptr;
+    io_uring_sqe* sqes = nullptr;
+    std::size_t sqSize = 0;
+    std::size_t cqSize = 0;
+    std::size_t sqesSize = 0;
+    unsigned* sqHead = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned sqMask = 0;
+    unsigned sqEntries = 0;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned cqMask = 0;
+    io_uring_cqe* cqes = nullptr;
+    unsigned local = 0; // tail of the sqes prepared
+    unsigned submitted = 0; // tail of the sqes passed to the kernel
+};
+
+// The sockets I/O of a server through io_uring: accept and receive are
+// multishot requests (one request for all the connections, one for all
+// the data of a connection), the data is received in buffers registered
+// with the kernel and the requests prepared while handling the
+// completions are submitted together (when the submission queue is
+// full, the requests wait in a backlog until the next completion).
+// The completions are signaled on an eventfd read by the io context,
+// so the handlers run in the thread of the io context like the asio ones.
+// The requests can be made from any thread.
+class UringService : public std::enable_shared_from_this<UringService>
+{
+public:
+    // res is the result of the request (-errno on failure)
+    using Handler = std::function<void(int res)>;
+    using DataHandler = std::function<void(int res, const char* data, std::size_t size)>;
+
+    explicit UringService(asio::BoostExecutor::ContextType& ios, unsigned entries = 256) :
+        ring(entries), executor(ios), eventFd(ios)
+    {}
+
+    // disable value semantics
+    UringService(const UringService&) = delete;
+    UringService& operator = (const UringService&) = delete;
+
+    ~UringService()
+    {
+        if (buffers != nullptr) munmap(buffers, buffersSize);
+    }
+
+    // Registers the buffers and starts waiting for the completions
+    // (returns false if io_uring or one of its features is not available)
+    bool Start()
+    {
+        if (!ring.Ok()) return false;
+        buffersSize = bufferCount * sizeof(io_uring_buf);
+        void* p = mmap(nullptr, buffersSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) return false;
+        buffers = static_cast<io_uring_buf*>(p);
+        io_uring_buf_reg reg;
+        std::memset(&reg, 0, sizeof(reg));
+        reg.ring_addr = reinterpret_cast<std::uint64_t>(buffers);
+        reg.ring_entries = bufferCount;
+        reg.bgid = bufferGroup;
+        if (ring.Register(IORING_REGISTER_PBUF_RING, &reg, 1) < 0) return false;
+        storage.resize(bufferCount * bufferSize);
+        for (unsigned i = 0; i < bufferCount; ++i)
+            Recycle(static_cast<std::uint16_t>(i));
+
+        int efd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (efd < 0) return false;
+        eventFd.assign(efd);
+        if (ring.Register(IORING_REGISTER_EVENTFD, &efd, 1) < 0) return false;
+        Wait();
+        return true;
+    }
+
+    // Drops the requests (their handlers are not called) and closes the ring
+    void Stop()
+    {
+        std::unordered_map<std::uint64_t, std::shared_ptr<Request>> dropped;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            boost::system::error_code ec;
+            eventFd.close(ec);
+            ring.Close();
+            dropped.swap(requests);
+            backlog.clear();
+        }
+    }
+
+    // Calls h with each connection accepted on the listening socket fd
+    // (the descriptor of the new socket) until an error
+    void Accept(int fd, Handler h)
+    {
+        Request r;
+        r.type = Type::accept;
+        r.fd = fd;
+        r.handler = std::move(h);
+        Queue(std::move(r));
+    }
+
+    // Calls h with the data received on the socket fd until the end of
+    // the stream (res == 0) or an error (res < 0)
+    void Receive(int fd, DataHandler h)
+    {
+        Request r;
+        r.type = Type::receive;
+        r.fd = fd;
+        r.dataHandler = std::move(h);
+        Queue(std::move(r));
+    }
+
+    // Sends the data on the socket fd (data must be valid until h is
+    // called with the number of bytes sent)
+    void Send(int fd, const char* data, std::size_t size, Handler h)
+    {
+        Request r;
+        r.type = Type::send;
+        r.fd = fd;
+        r.data = data;
+        r.size = size;
+        r.handler = std::move(h);
+        Queue(std::move(r));
+    }
+
+private:
+    enum class Type { accept, receive, send };
+    struct Request
+    {
+        Type type;
+        int fd;
+        const char* data = nullptr;
+        std::size_t size = 0;
+        Handler handler;
+        DataHandler dataHandler;
+    };
+    enum : unsigned { bufferCount = 256, bufferSize = 4096 };
+    enum : std::uint16_t { bufferGroup = 0 };
+
+    void Queue(Request r)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!ring.Ok()) return;
+        const auto id = ++lastId;
+        Prepare(id, r);
+        requests.emplace(id, std::make_shared<Request>(std::move(r)));
+    }
+
+    // (with the mutex locked)
+    void Prepare(std::uint64_t id, const Request& r)
+    {
+        // when the queue is full, the request waits in the backlog
+        // (after the ones already there, to keep the order of the sends)
+        io_uring_sqe* sqe = backlog.empty() ? NextSqe() : nullptr;
+        if (sqe == nullptr)
+        {
+            backlog.push_back(id);
+            return;
+        }
+        Fill(sqe, id, r);
+    }
+
+    // Prepares the requests of the backlog, while the queue has room
+    // (with the mutex locked)
+    void Retry()
+    {
+        while (!backlog.empty())
+        {
+            auto i = requests.find(backlog.front());
+            if (i != requests.end())
+            {
+                io_uring_sqe* sqe = NextSqe();
+                if (sqe == nullptr) return; // at the next completion
+                Fill(sqe, i->first, *i->second);
+            }
+            backlog.pop_front();
+        }
+    }
+
+    // A free sqe, submitting the ones prepared if the queue is full
+    // (nullptr if the kernel did not take any)
+    io_uring_sqe* NextSqe()
+    {
+        io_uring_sqe* sqe = ring.Sqe();
+        if (sqe == nullptr)
+        {
+            ring.Submit();
+            sqe = ring.Sqe();
+        }
+        return sqe;
+    }
+
+    void Fill(io_uring_sqe* sqe, std::uint64_t id, const Request& r)
+    {
+        sqe->fd = r.fd;
+        sqe->user_data = id;
+        switch (r.type)
+        {
+            case Type::accept:
+                sqe->opcode = IORING_OP_ACCEPT;
+                sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+                sqe->accept_flags = SOCK_CLOEXEC;
+                break;
+            case Type::receive:
+                sqe->opcode = IORING_OP_RECV;
+                sqe->ioprio = IORING_RECV_MULTISHOT;
+                sqe->flags = IOSQE_BUFFER_SELECT;
+                sqe->buf_group = bufferGroup;
+                break;
+            case Type::send:
+                sqe->opcode = IORING_OP_SEND;
+                sqe->addr = reinterpret_cast<std::uint64_t>(r.data);
+                sqe->len = static_cast<std::uint32_t>(r.size);
+                sqe->msg_flags = MSG_NOSIGNAL;
+                break;
+        }
+        // the requests prepared by the current handler are submitted together
+        if (!flushing)
+        {
+            flushing = true;
+            std::weak_ptr<UringService> weak = shared_from_this();
+            executor.Post([weak]()
+            {
+                if (auto self = weak.lock())
+                {
+                    std::lock_guard<std::mutex> lock(self->mtx);
+                    if (self->ring.Ok())
+                    {
+                        self->Retry();
+                        self->ring.Submit();
+                    }
+                    self->flushing = false;
+                }
+            });
+        }
+    }
+
+    // gives the buffer back to the kernel (with the mutex locked)
+    void Recycle(std::uint16_t bid)
+    {
+        io_uring_buf& b = buffers[bufferTail & (bufferCount - 1)];
+        b.addr = reinterpret_cast<std::uint64_t>(storage.data() + bid * bufferSize);
+        b.len = bufferSize;
+        b.bid = bid;
+        ++bufferTail;
+        // the tail of the ring overlaps the reserved field of the first buffer
+        auto tail = reinterpret_cast<std::uint16_t*>(reinterpret_cast<char*>(buffers) + offsetof(io_uring_buf, resv));
+        __atomic_store_n(tail, bufferTail, __ATOMIC_RELEASE);
+    }
+
+    void Wait()
+    {
+        std::weak_ptr<UringService> weak = shared_from_this();
+        eventFd.async_read_some(boost::asio::buffer(&eventCount, sizeof(eventCount)),
+            [weak](const boost::system::error_code& ec, std::size_t)
+            {
+                if (ec) return;
+                if (auto self = weak.lock())
+                {
+                    self->Completed();
+                    self->Wait();
+                }
+            });
+    }
+
+    struct Completion
+    {
+        std::uint64_t id;
+        int res;
+        std::uint32_t flags;
+    };
+
+    // calls the handlers of the completions available
+    void Completed()
+    {
+        std::vector<Completion> completions;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (!ring.Ok()) return;
+            ring.Completions([&completions](const io_uring_cqe& cqe)
+            {
+                completions.push_back({cqe.user_data, cqe.res, cqe.flags});
+            });
+            // the kernel has room again
+            Retry();
+        }
+        for (const auto& c: completions)
+            Dispatch(c);
+    }
+
+    void Dispatch(const Completion& c)
+    {
+        std::shared_ptr<Request> r; // kept while the handler runs
+        bool last = (c.flags & IORING_CQE_F_MORE) == 0;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            auto i = requests.find(c.id);
+            if (i == requests.end()) return;
+            // a multishot request can end without an error:
+            // then it's made again
+            const bool rearm = last && (
+                (i->second->type == Type::accept && c.res >= 0) ||
+                (i->second->type == Type::receive && (c.res > 0 || c.res == -ENOBUFS)));
+            if (rearm)
+            {
+                Prepare(c.id, *i->second);
+                last = false;
+            }
+            r = i->second;
+            if (last)
+                requests.erase(i);
+        }
+        if (r->type == Type::receive)
+        {
+            if (c.res == -ENOBUFS) return; // waits for the buffers in use
+            const char* data = nullptr;
+            const std::size_t size = c.res > 0 ? static_cast<std::size_t>(c.res) : 0;
+            const bool buffer = (c.flags & IORING_CQE_F_BUFFER) != 0;
+            const auto bid = static_cast<std::uint16_t>(c.flags >> IORING_CQE_BUFFER_SHIFT);
+            if (buffer)
+                data = storage.data() + bid * bufferSize;
+            r->dataHandler(c.res, data, size);
+            if (buffer)
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                if (ring.Ok())
+                    Recycle(bid);
+            }
+        }
+        else
+            r->handler(c.res);
+    }
+
+    Uring ring;
+    asio::BoostExecutor executor;
+    boost::asio::posix::stream_descriptor eventFd;
+    std::uint64_t eventCount = 0;
+    std::mutex mtx;
+    std::unordered_map<std::uint64_t, std::shared_ptr<Request>> requests;
+    std::deque<std::uint64_t> backlog; // the requests not prepared yet, because the queue was full
+    std::uint64_t lastId = 0;
+    bool flushing = false;
+    io_uring_buf* buffers = nullptr; // the ring of the buffers provided to the kernel
+    std::size_t buffersSize = 0;
+    std::uint16_t bufferTail = 0;
+    std::vector<char> storage; // the memory of the buffers
+};
+
+} // namespace detail
+} // namespace cli
+
+#endif // CLI_DETAIL_URING_H_
@@ -0,0 +1,203 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_FILEAUDITSINK_H_
+#define CLI_FILEAUDITSINK_H_
+
+#include "auditsink.h"
+#include <condition_variable>
+#include <ctime>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace cli
+{
+
+// Audit sink that appends the records to a file.
+// The file is written by a dedicated thread, in batches:
+// Store only moves the record in a bounded queue, so the
+// session thread never waits for the disk.
+// When the queue is full the records are dropped (and counted): the
+// number of dropped records is written in the file with the next batch.
+// Each line contains, separated by tabs:
+// UTC time, session id, peer, menu path, result, duration (us), command,
+// where the result is "ok", "not_found" or "failed_<status code>"
+class FileAuditSink : public AuditSink
+{
+public:
+    FileAuditSink(
+        const std::string& fileName,
+        std::size_t _maxQueueSize = 10000,
+        std::chrono::milliseconds _flushInterval = std::chrono::milliseconds(500)
+    ) :
+        file(fileName, std::ios_base::out | std::ios_base::app),
+        maxQueueSize(_maxQueueSize),
+        flushInterval(_flushInterval),
+        writer([this](){ Run(); })
+    {
+    }
+
+    ~FileAuditSink() override
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stop = true;
+        }
+        cv.notify_one();
+        writer.join();
+    }
+
+    // disable value semantics
+    FileAuditSink(const FileAuditSink&) = delete;
+    FileAuditSink& operator = (const FileAuditSink&) = delete;
+
+    void Store(AuditRecord record) override
+    {
+        bool wake = false;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (queue.size() >= maxQueueSize)
+            {
+                ++dropped;
+                ++totalDropped;
+                return;
+            }
+            queue.push_back(std::move(record));
+            // wake up the writer when half the queue is used,
+            // otherwise it will wake up at the next flush interval
+            wake = (queue.size() == maxQueueSize / 2 + 1);
+        }
+        if (wake) cv.notify_one();
+    }
+
+    // Waits until all the records stored so far are written on the file
+    void Flush()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        const auto target = enqueued + queue.size();
+        flushRequested = true;
+        cv.notify_one();
+        cv.wait(lock, [&](){ return written >= target; });
+    }
+
+    // Number of records dropped because the queue was full
+    std::size_t Dropped() const
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return totalDropped;
+    }
+
+private:
+
+    void Run()
+    {
+        std::vector<AuditRecord> batch;
+        std::string buffer;
+        std::unique_lock<std::mutex> lock(mtx);
+        while (true)
+        {
+            cv.wait_for(lock, flushInterval, [this](){ return stop || flushRequested || queue.size() > maxQueueSize / 2; });
+            const bool last = stop;
+            flushRequested = false;
+
+            batch.assign(std::make_move_iterator(queue.begin()), std::make_move_iterator(queue.end()));
+            queue.clear();
+            enqueued += batch.size();
+            const std::size_t lost = dropped;
+            dropped = 0;
+
+            lock.unlock();
+            buffer.clear();
+            if (lost > 0)
+                buffer += "# " + std::to_string(lost) + " records dropped\n";
+            for (const auto& r: batch)
+                Format(r, buffer);
+            if (!buffer.empty())
+                file.write(buffer.data(), static_cast<std::streamsize>(buffer.size())).flush();
+            lock.lock();
+
+            written += batch.size();
+            cv.notify_all(); // for Flush()
+            if (last) break;
+        }
+    }
+
+    static std::string Result(const AuditRecord& r)
+    {
+        if (!r.executed) return "not_found";
+        if (r.status == 0) return "ok";
+        return "failed_" + std::to_string(r.status);
+    }
+
+    static void Format(const AuditRecord& r, std::string& out)
+    {
+        std::ostringstream line;
+        const std::time_t t = std::chrono::system_clock::to_time_t(r.time);
+        std::tm tm{};
+#ifdef _WIN32
+        gmtime_s(&tm, &t);
+#else
+        gmtime_r(&t, &tm);
+#endif
+        line << std::put_time(&tm, "%Y-%m-%dT%H:%M:%SZ") << '\t'
+             << r.sessionId << '\t'
+             << (r.peer.empty() ? "-" : r.peer) << '\t'
+             << r.menuPath << '\t'
+             << Result(r) << '\t'
+             << r.duration.count() << '\t';
+        out += line.str();
+        for (char c: r.command)
+            out += (c == '\n' || c == '\r' || c == '\t') ? ' ' : c;
+        out += '\n';
+    }
+
+    std::ofstream file;
+    const std::size_t maxQueueSize;
+    const std::chrono::milliseconds flushInterval;
+    mutable std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<AuditRecord> queue;
+    std::size_t dropped = 0;
+    std::size_t totalDropped = 0;
+    std::size_t enqueued = 0; // records taken by the writer
+    std::size_t written = 0;  // records written on the file
+    bool flushRequested = false;
+    bool stop = false;
+    std::thread writer; // last member: the thread starts when everything else is ready
+};
+
+} // namespace cli
+
+#endif // CLI_FILEAUDITSINK_H_
@@ -46,33 +46,42 @@ public:
     }
     void Store(const std::vector<std::string>& cmds) override
     {
-        using dt = std::vector<std::string>::difference_type;
-        auto commands = Commands();
-        commands.insert(commands.end(), cmds.begin(), cmds.end());
-        if (commands.size() > maxSize)
-            commands.erase(
-                commands.begin(), 
-                commands.begin() + static_cast<dt>(commands.size() - maxSize)
+        StoreEntries({}, detail::EntriesOf(cmds));
+    }
+    std::vector<std::string> Commands() const override
+    {
+        return detail::CommandsOf(EntriesFor({}));
+    }
+    void Clear() override
+    {
+        std::ofstream f(fileName, std::ios_base::out | std::ios_base::trunc);
+    }
+    // all the keys share the same history
+    void StoreEntries(const std::string&, const std::vector<HistoryEntry>& es) override
+    {
+        using dt = std::vector<HistoryEntry>::difference_type;
+        auto entries = EntriesFor({});
+        entries.insert(entries.end(), es.begin(), es.end());
+        if (entries.size() > maxSize)
+            entries.erase(
+                entries.begin(), 
+                entries.begin() + static_cast<dt>(entries.size() - maxSize)
             );
         std::ofstream f(fileName, std::ios_base::out);
-            for (const auto& line: commands)
-                f << line << '\n';
+            for (const auto& e: entries)
+                f << detail::ToLine(e) << '\n';
     }
-    std::vector<std::string> Commands() const override
+    std::vector<HistoryEntry> EntriesFor(const std::string&) const override
     {
-        std::vector<std::string> commands;
+        std::vector<HistoryEntry> entries;
         std::ifstream in(fileName);
         if (in)
         {
             std::string line;
             while (std::getline(in, line))
-                commands.push_back(line);
+                entries.push_back(detail::FromLine(line));
         }
-        return commands;
-    }
-    void Clear() override
-    {
-        std::ofstream f(fileName, std::ios_base::out | std::ios_base::trunc);
+        return entries;
     }
 
 private:
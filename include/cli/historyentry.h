@@ -0,0 +1,109 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_HISTORYENTRY_H_
+#define CLI_HISTORYENTRY_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace cli
+{
+
+// A command of the history, with the result of its execution
+// (the commands stored without it have a zero time)
+struct HistoryEntry
+{
+    std::string command;
+    std::chrono::system_clock::time_point time; // when the command was issued
+    std::chrono::microseconds duration{0};      // time spent to execute the command
+    std::size_t outputSize = 0;                 // characters written by the command
+    bool success = true;                        // false if not found or failed
+};
+
+namespace detail
+{
+
+// The history storages write an entry per line: the command followed,
+// if the entry has a time, by the separator '\x1F' and
+// "<time in ms> <duration in us> <output size> <success>"
+inline std::string ToLine(const HistoryEntry& e)
+{
+    if (e.time.time_since_epoch().count() == 0)
+        return e.command;
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(e.time.time_since_epoch()).count();
+    return e.command + '\x1F' + std::to_string(ms) + ' ' + std::to_string(e.duration.count()) + ' ' +
+           std::to_string(e.outputSize) + ' ' + (e.success ? '1' : '0');
+}
+
+inline HistoryEntry FromLine(const std::string& line)
+{
+    HistoryEntry e;
+    const auto sep = line.find('\x1F');
+    e.command = line.substr(0, sep);
+    if (sep == std::string::npos) return e;
+    long long ms = 0;
+    long long us = 0;
+    unsigned long long output = 0;
+    int success = 1;
+    if (std::sscanf(line.c_str() + sep + 1, "%lld %lld %llu %d", &ms, &us, &output, &success) != 4)
+        return e;
+    e.time = std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::milliseconds(ms)));
+    e.duration = std::chrono::microseconds(us);
+    e.outputSize = static_cast<std::size_t>(output);
+    e.success = success != 0;
+    return e;
+}
+
+inline std::vector<std::string> CommandsOf(const std::vector<HistoryEntry>& entries)
+{
+    std::vector<std::string> commands;
+    commands.reserve(entries.size());
+    for (const auto& e: entries)
+        commands.push_back(e.command);
+    return commands;
+}
+
+inline std::vector<HistoryEntry> EntriesOf(const std::vector<std::string>& commands)
+{
+    std::vector<HistoryEntry> entries(commands.size());
+    for (std::size_t i = 0; i < commands.size(); ++i)
+        entries[i].command = commands[i];
+    return entries;
+}
+
+} // namespace detail
+
+} // namespace cli
+
+#endif // CLI_HISTORYENTRY_H_
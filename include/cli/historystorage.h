@@ -32,6 +32,7 @@
 
 #include <vector>
 #include <string>
+#include "historyentry.h"
 
 namespace cli
 {
@@ -47,6 +48,29 @@ public:
     // Clear the whole content of the storage
     // After calling this method, Commands() returns the empty vector
     virtual void Clear() = 0;
+    // The history of a key (e.g., a user or a peer: see CliSession::HistoryKey).
+    // By default, all the keys share the same history
+    // (see KeyedHistoryStorage for separate histories)
+    virtual void StoreFor(const std::string& key, const std::vector<std::string>& commands)
+    {
+        (void)key;
+        Store(commands);
+    }
+    virtual std::vector<std::string> CommandsFor(const std::string& key) const
+    {
+        (void)key;
+        return Commands();
+    }
+    // The history of a key with the results of the commands.
+    // By default, only the commands are stored
+    virtual void StoreEntries(const std::string& key, const std::vector<HistoryEntry>& entries)
+    {
+        StoreFor(key, detail::CommandsOf(entries));
+    }
+    virtual std::vector<HistoryEntry> EntriesFor(const std::string& key) const
+    {
+        return detail::EntriesOf(CommandsFor(key));
+    }
 };
 
 } // namespace cli
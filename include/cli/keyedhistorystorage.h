@@ -0,0 +1,353 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_KEYEDHISTORYSTORAGE_H_
+#define CLI_KEYEDHISTORYSTORAGE_H_
+
+#include "historystorage.h"
+#include <cstdio>
+#include <fstream>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+    #if !defined(NOMINMAX)
+        #define NOMINMAX 1
+    #endif // !defined(NOMINMAX)
+    #include <windows.h>
+#endif
+
+namespace cli
+{
+
+// History storage with a separate history for each key (e.g., the user
+// or the address of the peer: see CliSession::HistoryKey) of at most
+// size commands. Store and Commands use the empty key.
+// The histories are kept in a single file and loaded on demand: only
+// the maxKeys histories used most recently stay in memory.
+// The file is a sequence of records "<key size> <commands size>\n<key><commands>"
+// (one command per line, with the result of its execution: see HistoryEntry), indexed when the storage is created.
+// The commands stored for a key are appended to the file in a record
+// "<key size> <commands size> +\n<key><commands>" following the previous
+// ones, until they take more space than the last full history of the key,
+// that is then written again. The file is compacted (written to a new file,
+// that replaces it) when the old records take more space than the current ones.
+// The methods can be called from any thread.
+class KeyedHistoryStorage : public HistoryStorage
+{
+public:
+    explicit KeyedHistoryStorage(const std::string& _fileName, std::size_t size = 1000, std::size_t _maxKeys = 100) :
+        fileName(_fileName),
+        maxSize(size),
+        maxKeys(_maxKeys > 0 ? _maxKeys : 1)
+    {
+        if (!Scan())
+            Compact(); // drops an incomplete record at the end
+    }
+
+    void Store(const std::vector<std::string>& cmds) override { StoreFor({}, cmds); }
+    std::vector<std::string> Commands() const override { return CommandsFor({}); }
+
+    void Clear() override
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        lru.clear();
+        cache.clear();
+        index.clear();
+        fileSize = liveSize = 0;
+        std::ofstream f(fileName, std::ios_base::out | std::ios_base::trunc);
+    }
+
+    void StoreFor(const std::string& key, const std::vector<std::string>& cmds) override
+    {
+        StoreEntries(key, detail::EntriesOf(cmds));
+    }
+
+    std::vector<std::string> CommandsFor(const std::string& key) const override
+    {
+        return detail::CommandsOf(EntriesFor(key));
+    }
+
+    void StoreEntries(const std::string& key, const std::vector<HistoryEntry>& es) override
+    {
+        using dt = std::vector<HistoryEntry>::difference_type;
+        std::lock_guard<std::mutex> lock(mtx);
+        auto& entries = Load(key);
+        entries.insert(entries.end(), es.begin(), es.end());
+        if (entries.size() > maxSize)
+            entries.erase(
+                entries.begin(),
+                entries.begin() + static_cast<dt>(entries.size() - maxSize)
+            );
+        // just the new commands, unless the ones appended would be more than the full history
+        const auto i = index.find(key);
+        std::size_t headerSize = 0;
+        const auto added = Serialize(key, es, headerSize, true);
+        if (i != index.end() && es.size() < maxSize &&
+            i->second.size - i->second.fullSize + added.size() <= i->second.fullSize)
+            Append(key, added, headerSize, false);
+        else
+        {
+            const auto full = Serialize(key, entries, headerSize, false);
+            Append(key, full, headerSize, true);
+        }
+        if (fileSize > compactionSize && fileSize > 2 * liveSize)
+            Compact();
+    }
+
+    std::vector<HistoryEntry> EntriesFor(const std::string& key) const override
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return Load(key);
+    }
+
+    // Number of keys stored
+    std::size_t Keys() const
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return index.size();
+    }
+
+    // Number of histories in memory
+    std::size_t CachedKeys() const
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return cache.size();
+    }
+
+private:
+
+    // position of a record in the file
+    struct Record
+    {
+        std::streamoff commands; // offset of the commands
+        std::size_t commandsSize;
+        std::size_t size; // of the whole record
+    };
+
+    // the records of a key: its full history and the commands appended
+    struct Records
+    {
+        std::vector<Record> parts;
+        std::size_t fullSize = 0; // of the first part
+        std::size_t size = 0; // of all the parts
+    };
+
+    using Entry = std::pair<std::string, std::vector<HistoryEntry>>;
+
+    enum : std::size_t { compactionSize = 64 * 1024 };
+
+    // builds the index of the file (returns false if the file is corrupted)
+    bool Scan()
+    {
+        std::ifstream in(fileName, std::ios_base::binary);
+        if (!in) return true;
+        in.seekg(0, std::ios_base::end);
+        const auto length = static_cast<std::size_t>(in.tellg());
+        in.seekg(0);
+        std::string header;
+        while (std::getline(in, header))
+        {
+            std::size_t keySize = 0;
+            std::size_t commandsSize = 0;
+            char appended = 0;
+            const auto fields = std::sscanf(header.c_str(), "%zu %zu %c", &keySize, &commandsSize, &appended);
+            if (fields < 2 || (fields == 3 && appended != '+'))
+                return false;
+            std::string key(keySize, '\0');
+            if (!in.read(&key[0], static_cast<std::streamsize>(keySize)))
+                return false;
+            Record r;
+            r.commands = in.tellg();
+            r.commandsSize = commandsSize;
+            r.size = header.size() + 1 + keySize + commandsSize;
+            if (fileSize + r.size > length || !in.seekg(static_cast<std::streamoff>(commandsSize), std::ios_base::cur))
+                return false;
+            Index(key, r, fields == 2);
+            fileSize += r.size;
+        }
+        return fileSize == length;
+    }
+
+    // a full record replaces the ones of the key
+    void Index(const std::string& key, const Record& r, bool full)
+    {
+        auto& records = index[key];
+        if (full)
+        {
+            liveSize -= records.size;
+            records.parts.clear();
+            records.fullSize = records.size = 0;
+        }
+        if (records.parts.empty())
+            records.fullSize = r.size;
+        records.parts.push_back(r);
+        records.size += r.size;
+        liveSize += r.size;
+    }
+
+    // the history of the key, from the cache or from the file
+    // (with the mutex locked)
+    std::vector<HistoryEntry>& Load(const std::string& key) const
+    {
+        auto c = cache.find(key);
+        if (c != cache.end())
+        {
+            lru.splice(lru.begin(), lru, c->second); // most recently used
+            return c->second->second;
+        }
+        std::vector<HistoryEntry> entries;
+        auto i = index.find(key);
+        if (i != index.end())
+            entries = Read(i->second);
+        lru.emplace_front(key, std::move(entries));
+        cache.emplace(key, lru.begin());
+        if (cache.size() > maxKeys)
+        {
+            // the histories are already in the file
+            cache.erase(lru.back().first);
+            lru.pop_back();
+        }
+        return lru.front().second;
+    }
+
+    // the last maxSize commands of the records of a key
+    std::vector<HistoryEntry> Read(const Records& records) const
+    {
+        using dt = std::vector<HistoryEntry>::difference_type;
+        std::vector<HistoryEntry> entries;
+        std::ifstream in(fileName, std::ios_base::binary);
+        for (const auto& r: records.parts)
+        {
+            std::string data(r.commandsSize, '\0');
+            if (!in.seekg(r.commands) || !in.read(&data[0], static_cast<std::streamsize>(data.size())))
+                break;
+            std::size_t begin = 0;
+            for (auto end = data.find('\n'); end != std::string::npos; begin = end + 1, end = data.find('\n', begin))
+                entries.push_back(detail::FromLine(data.substr(begin, end - begin)));
+        }
+        if (entries.size() > maxSize)
+            entries.erase(entries.begin(), entries.begin() + static_cast<dt>(entries.size() - maxSize));
+        return entries;
+    }
+
+    static std::string Serialize(const std::string& key, const std::vector<HistoryEntry>& entries, std::size_t& headerSize, bool appended)
+    {
+        std::string data;
+        for (const auto& e: entries)
+            data += detail::ToLine(e) + '\n';
+        const std::string header = std::to_string(key.size()) + ' ' + std::to_string(data.size()) + (appended ? " +\n" : "\n");
+        headerSize = header.size() + key.size();
+        return header + key + data;
+    }
+
+    // appends a record of the key (see Serialize) to the file
+    void Append(const std::string& key, const std::string& record, std::size_t headerSize, bool full)
+    {
+        std::ofstream f(fileName, std::ios_base::out | std::ios_base::app | std::ios_base::binary);
+        if (!f.write(record.data(), static_cast<std::streamsize>(record.size())))
+            return;
+        Record r;
+        r.commands = static_cast<std::streamoff>(fileSize + headerSize);
+        r.commandsSize = record.size() - headerSize;
+        r.size = record.size();
+        Index(key, r, full);
+        fileSize += r.size;
+    }
+
+    // rewrites the file with the current histories only: a new file
+    // replaces the old one at once, so that a crash leaves one of them
+    void Compact()
+    {
+        const std::string tmpName = fileName + ".tmp";
+        std::unordered_map<std::string, Records> compacted;
+        std::size_t size = 0;
+        {
+            std::ofstream f(tmpName, std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+            if (!f) return;
+            for (const auto& i: index)
+            {
+                std::size_t headerSize = 0;
+                const auto record = Serialize(i.first, Read(i.second), headerSize, false);
+                if (!f.write(record.data(), static_cast<std::streamsize>(record.size())))
+                {
+                    f.close();
+                    std::remove(tmpName.c_str());
+                    return;
+                }
+                auto& records = compacted[i.first];
+                records.parts.push_back(Record{static_cast<std::streamoff>(size + headerSize), record.size() - headerSize, record.size()});
+                records.fullSize = records.size = record.size();
+                size += record.size();
+            }
+            if (!f.flush())
+            {
+                f.close();
+                std::remove(tmpName.c_str());
+                return;
+            }
+        }
+        if (!Replace(tmpName, fileName))
+        {
+            std::remove(tmpName.c_str());
+            return;
+        }
+        index.swap(compacted);
+        fileSize = liveSize = size;
+    }
+
+    // replaces the file to with the file from, in a single step
+    static bool Replace(const std::string& from, const std::string& to)
+    {
+#ifdef _WIN32
+        return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+        return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+    }
+
+    const std::string fileName;
+    const std::size_t maxSize;
+    const std::size_t maxKeys;
+    mutable std::mutex mtx;
+    std::unordered_map<std::string, Records> index; // the records in the file
+    std::size_t fileSize = 0;
+    std::size_t liveSize = 0; // size of the records in the index
+    // the histories in memory, from the most recently used
+    mutable std::list<Entry> lru;
+    mutable std::unordered_map<std::string, std::list<Entry>::iterator> cache;
+};
+
+} // namespace cli
+
+#endif // CLI_KEYEDHISTORYSTORAGE_H_
@@ -35,6 +35,7 @@
 #include "cli.h"
 #include "detail/server.h"
 #include "detail/inputdevice.h"
+#include "detail/keydecoder.h"
 #include "detail/boostasio.h"
 
 namespace cli
@@ -83,6 +84,13 @@ protected:
 
         std::string iacWillEcho{ "\x0FF\x0FB\x001", 3 };
         this -> OutStream() << iacWillEcho << std::flush;
+
+        // window size (RFC 1073) and terminal type (RFC 1091)
+        std::string iacDoNaws{ "\x0FF\x0FD\x01F", 3 };
+        this -> OutStream() << iacDoNaws << std::flush;
+
+        std::string iacDoTtype{ "\x0FF\x0FD\x018", 3 };
+        this -> OutStream() << iacDoTtype << std::flush;
 /*
         constexpr char IAC = '\x0FF'; // 255
         constexpr char DO = '\x0FD'; // 253
@@ -94,6 +102,11 @@ protected:
     }
     virtual void OnDisconnect() override {}
     virtual void OnError() override {}
+
+    // the client told the size of its window (0 if unknown)
+    virtual void OnWindowSize(unsigned short width, unsigned short height) { (void)width; (void)height; }
+    // the client told its terminal type
+    virtual void OnTerminalType(const std::string& type) { (void)type; }
 #if 0
     virtual void OnDataReceived(const std::string& data) override
     {
@@ -201,6 +214,13 @@ protected:
         IAC = '\x0FF'                  // Data Byte 255.
     };
 
+    enum
+    {
+        TTYPE = '\x018',                // Terminal type (RFC 1091).
+        NAWS = '\x01F'                  // Negotiate about window size (RFC 1073).
+    };
+    enum { IS = 0, SEND = 1 };           // TTYPE subnegotiation commands.
+
 
     virtual void OnDataReceived(const std::string& _data) override
     {
@@ -291,7 +311,10 @@ private:
         {
             case SE:
                 if (state == State::sub)
+                {
                     state = State::data;
+                    Subnegotiation();
+                }
                 else
                     std::cout << "ERROR: received SE when not in sub state" << std::endl;
                 break;
@@ -308,7 +331,10 @@ private:
                 break;
             case SB:
                 if (state != State::sub)
+                {
                     state = State::sub;
+                    subData.clear();
+                }
                 else
                     std::cout << "ERROR: received SB when already in sub state" << std::endl;
                 break;
@@ -335,9 +361,13 @@ private:
     { 
         #ifdef CLI_TELNET_TRACE
         std::cout << "will " << static_cast<int>(c) << std::endl;
-        #else
-        (void)c;
         #endif
+        if (c == TTYPE)
+        {
+            // the terminal type comes in a subnegotiation
+            std::string iacSbTtypeSendIacSe{ "\x0FF\x0FA\x018\x001\x0FF\x0F0", 6 };
+            this -> OutStream() << iacSbTtypeSendIacSe << std::flush;
+        }
     }
     void Wont(char c)
     { 
@@ -367,9 +397,34 @@ private:
     { 
         #ifdef CLI_TELNET_TRACE
         std::cout << "sub: " << static_cast<int>(c) << std::endl;
-        #else
-        (void)c;
         #endif
+        // the options handled have short parameters
+        if (subData.size() < maxSubData)
+            subData += c;
+    }
+    // a complete subnegotiation (option and parameters) has been received
+    void Subnegotiation()
+    {
+        if (subData.empty())
+            return;
+        const auto byte = [this](std::size_t i){ return static_cast<unsigned char>(subData[i]); };
+        switch (subData[0])
+        {
+            case NAWS:
+                if (subData.size() == 5)
+                    OnWindowSize(
+                        static_cast<unsigned short>(byte(1) << 8 | byte(2)),
+                        static_cast<unsigned short>(byte(3) << 8 | byte(4))
+                    );
+                break;
+            case TTYPE:
+                if (subData.size() > 1 && byte(1) == IS)
+                    OnTerminalType(subData.substr(2));
+                break;
+            default:
+                break;
+        }
+        subData.clear();
     }
 protected:
     virtual void Output(char c)
@@ -384,6 +439,8 @@ private:
     enum class State { data, sub, wait_will, wait_wont, wait_do, wait_dont };
     State state = State::data;
     bool escape = false;
+    static constexpr std::size_t maxSubData = 64;
+    std::string subData; // option and parameters of the current subnegotiation
 
 #endif
 
@@ -446,97 +503,95 @@ public:
         InputDevice(detail::asio::BoostExecutor(_socket)),
         TelnetSession(std::move(_socket)),
         CliSession(_cli, TelnetSession::OutStream(), historySize),
+        peer(RemoteAddress()),
         poll(*this, *this)
     {
-        ExitAction([this, _exitAction](std::ostream& _out){ _exitAction(_out), Disconnect(); } );
+        PublishPeer(peer);
+        ExitAction([this, _exitAction](std::ostream& _out)
+        {
+            if (_exitAction) _exitAction(_out);
+            _out << detail::bracketedPasteOff << std::flush;
+            Disconnect();
+        });
     }
-protected:
 
-    virtual void OnConnect() override
-    {
-        TelnetSession::OnConnect();
-        Prompt();
-    }
+    std::string Peer() const override { return peer; }
 
-    void Output(char c) override
+    // the session is closed in its io context, where its output is written
+    void Kill() override
     {
-        using detail::KeyType;
-        switch(step)
+        std::weak_ptr<detail::Session> weak = shared_from_this();
+        Executor().Post([this, weak]()
         {
-            case Step::_1:
-                switch( c )
-                {
-                    case EOF:
-                    case 4:  // EOT
-                        Notify(std::make_pair(KeyType::eof,' ')); break;
-                    case 8: // Backspace
-                    case 127:  // Backspace or Delete
-                        Notify(std::make_pair(KeyType::backspace, ' ')); break;
-                    //case 10: Notify(std::make_pair(KeyType::ret,' ')); break;
-                    case 27: step = Step::_2; break;  // symbol
-                    case 13: step = Step::wait_0; break;  // wait for 0 (ENTER key)
-                    default: // ascii
-                    {
-                        const char ch = static_cast<char>(c);
-                        Notify(std::make_pair(KeyType::ascii,ch));
-                    }
-                }
-                break;
-
-            case Step::_2: // got 27 last time
-                if ( c == 91 )
-                {
-                    step = Step::_3;
-                    break;  // arrow keys
-                }
-                else
-                {
-                    step = Step::_1;
-                    Notify(std::make_pair(KeyType::ignored,' '));
-                    break; // unknown
-                }
-                break;
+            if (!weak.lock()) return;
+            TelnetSession::OutStream() << "\nsession closed by another session\n";
+            Exit();
+        });
+    }
+protected:
 
-            case Step::_3: // got 27 and 91
-                switch( c )
-                {
-                    case 65: step = Step::_1; Notify(std::make_pair(KeyType::up,' ')); break;
-                    case 66: step = Step::_1; Notify(std::make_pair(KeyType::down,' ')); break;
-                    case 68: step = Step::_1; Notify(std::make_pair(KeyType::left,' ')); break;
-                    case 67: step = Step::_1; Notify(std::make_pair(KeyType::right,' ')); break;
-                    case 70: step = Step::_1; Notify(std::make_pair(KeyType::end,' ')); break;
-                    case 72: step = Step::_1; Notify(std::make_pair(KeyType::home,' ')); break;
-                    default: step = Step::_4; break;  // not arrow keys
-                }
-                break;
+    void OnWindowSize(unsigned short width, unsigned short height) override
+    {
+        TerminalSize(width, height);
+    }
 
-            case Step::_4:
-                if ( c == 126 ) Notify(std::make_pair(KeyType::canc,' '));
-                else Notify(std::make_pair(KeyType::ignored,' '));
+    void OnTerminalType(const std::string& type) override
+    {
+        TerminalType(type);
+    }
 
-                step = Step::_1;
+    // the session is closed as with the command exit
+    void OnIdle() override
+    {
+        TelnetSession::OutStream() << "\nsession closed for inactivity\n";
+        Exit();
+    }
 
-                break;
+    // the output of a command (and the prompt) is sent at once when it ends
+    void OnOutputBegin() override { Cork(); }
+    void OnOutputEnd() override { Uncork(); }
 
-            case Step::wait_0:
-                if ( c == 0 /* linux */ || c == 10 /* win */ ) Notify(std::make_pair(KeyType::ret,' '));
-                else Notify(std::make_pair(KeyType::ignored,' '));
+    virtual void OnConnect() override
+    {
+        TelnetSession::OnConnect();
+        // the pasted text is then received as a whole
+        TelnetSession::OutStream() << detail::bracketedPasteOn << std::flush;
+        Prompt();
+    }
 
-                step = Step::_1;
+    void Send(const std::string& msg) override
+    {
+        detail::TraceSpan span(*this, TraceStage::send);
+        TelnetSession::Send(msg);
+        PublishTraffic(BytesIn(), BytesOut(), PendingOutput());
+    }
 
-                break;
+    void OnDataReceived(const std::string& data) override
+    {
+        TelnetSession::OnDataReceived(data);
+        PublishTraffic(BytesIn(), BytesOut(), PendingOutput());
+    }
 
-        }
+    void Output(char c) override
+    {
+        decoder.Decode(c,
+            [this](const detail::KeyDecoder::Key& k){ Notify(k); },
+            [this](std::string text){ NotifyPaste(std::move(text)); });
     }
 
 private:
 
-    enum class Step { _1, _2, _3, _4, wait_0 };
-    Step step = Step::_1;
+    detail::KeyDecoder decoder;
+    const std::string peer; // computed at connection time, when the socket is still open
     detail::InputHandler poll;
 };
 
 
+// The options of the sockets (see CliTelnetServer::SetTcpOptions)
+using TcpOptions = detail::TcpOptions;
+// The watchdog of the io context (see CliTelnetServer::ShedLoad)
+using LagMonitor = detail::LagMonitor;
+
 class CliTelnetServer : public detail::Server
 {
 public:
@@ -554,14 +609,25 @@ public:
     {
         exitAction = action;
     }
+    // Each address of the peers has its own history (see CliSession::HistoryKey
+    // and KeyedHistoryStorage)
+    void HistoryByPeer(bool enable) { historyByPeer = enable; }
     virtual std::shared_ptr<detail::Session> CreateSession(boost::asio::ip::tcp::socket _socket) override
     {
-        return std::make_shared<CliTelnetSession>(std::move(_socket), cli, exitAction, historySize);
+        auto session = std::make_shared<CliTelnetSession>(std::move(_socket), cli, exitAction, historySize);
+        if (historyByPeer)
+        {
+            // the address without the port
+            const auto peer = session->Peer();
+            session->HistoryKey(peer.substr(0, peer.rfind(':')));
+        }
+        return session;
     }
 private:
     Cli& cli;
     std::function< void(std::ostream&)> exitAction;
     std::size_t historySize;
+    bool historyByPeer = false;
 };
 
 
@@ -0,0 +1,56 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_SESSIONINFO_H_
+#define CLI_SESSIONINFO_H_
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+namespace cli
+{
+
+// The state of a session (see Cli::Sessions)
+struct SessionInfo
+{
+    std::size_t id = 0;                          // see CliSession::Id()
+    std::string peer;                            // remote address (empty for local sessions)
+    std::chrono::system_clock::time_point start; // when the session was created
+    std::string menuPath;                        // path of the current menu (e.g. "/sub/subsub")
+    std::size_t commands = 0;                    // number of commands executed
+    std::size_t bytesIn = 0;                     // data received (the command lines for the local sessions)
+    std::size_t bytesOut = 0;                    // data sent (0 when not known)
+    std::size_t pendingOutput = 0;               // output buffered and not sent yet
+    std::chrono::microseconds cpuTime{0};        // CPU time spent by the commands
+};
+
+} // namespace cli
+
+#endif // CLI_SESSIONINFO_H_
@@ -0,0 +1,78 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_STATUS_H_
+#define CLI_STATUS_H_
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace cli
+{
+
+// The result of a command (see CliSession::LastStatus).
+// A handler reports a failure returning a Status (instead of void) or throwing
+// CommandError, so that the scripts, the audit and the clients don't have to
+// parse its output, e.g.:
+//     [](std::ostream& out, int vlan) -> cli::Status
+//     {
+//         if (!Exists(vlan)) return {cli::Status::failed, "no such vlan"};
+//         ...
+//         return {};
+//     }
+struct Status
+{
+    enum : int { ok = 0, failed = 1, notFound = 127 };
+
+    Status() = default;
+    Status(int _code, std::string _message = {}) : code(_code), message(std::move(_message)) {}
+
+    bool Ok() const { return code == ok; }
+
+    int code = ok;
+    std::string message; // the description of the failure (optional)
+};
+
+// Thrown by a handler, fails the command with a status:
+// the session writes the message on its output
+class CommandError : public std::runtime_error
+{
+public:
+    explicit CommandError(const std::string& message, int _code = Status::failed) :
+        std::runtime_error(message), code(_code)
+    {}
+    int Code() const { return code; }
+private:
+    int code;
+};
+
+} // namespace cli
+
+#endif // CLI_STATUS_H_
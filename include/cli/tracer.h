@@ -0,0 +1,83 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_TRACER_H_
+#define CLI_TRACER_H_
+
+// #define CLI_NO_TRACING
+
+#include <cstddef>
+#include <string>
+
+namespace cli
+{
+
+// The stages of the lifecycle of a command
+enum class TraceStage
+{
+    tokenize,   // split of the command line in tokens
+    dispatch,   // search of the command among menus and overloads
+    conversion, // conversion of the parameters from string
+    handler,    // execution of the user handler
+    send        // write of the output to the remote peer
+};
+
+inline const char* ToString(TraceStage stage)
+{
+    switch (stage)
+    {
+        case TraceStage::tokenize: return "tokenize";
+        case TraceStage::dispatch: return "dispatch";
+        case TraceStage::conversion: return "conversion";
+        case TraceStage::handler: return "handler";
+        case TraceStage::send: return "send";
+    }
+    return "";
+}
+
+// Interface to receive the begin and the end of each stage of the commands.
+// An instance can be installed in the Cli with Cli::SetTracer.
+// When no tracer is installed, each stage costs a pointer check.
+// When the macro CLI_NO_TRACING is defined, the tracing code is compiled out.
+// NB: the methods are called from the threads running the sessions,
+// so the implementation must be thread safe if the sessions run on more threads.
+class Tracer
+{
+public:
+    virtual ~Tracer() = default;
+    // sessionId identifies the session (see CliSession::Id()).
+    // command is the name of the command the stage belongs to
+    // (it can be empty, e.g. when sending the prompt)
+    virtual void Begin(TraceStage stage, std::size_t sessionId, const std::string& command) = 0;
+    virtual void End(TraceStage stage, std::size_t sessionId, const std::string& command) = 0;
+};
+
+} // namespace cli
+
+#endif // CLI_TRACER_H_
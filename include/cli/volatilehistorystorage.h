@@ -42,25 +42,38 @@ class VolatileHistoryStorage : public HistoryStorage
         explicit VolatileHistoryStorage(std::size_t size = 1000) : maxSize(size) {}
         void Store(const std::vector<std::string>& cmds) override
         {
-            using dt = std::deque<std::string>::difference_type;
-            commands.insert(commands.end(), cmds.begin(), cmds.end());
-            if (commands.size() > maxSize)
-                commands.erase(
-                    commands.begin(),
-                    commands.begin()+static_cast<dt>(commands.size()-maxSize)
-                );
+            StoreEntries({}, detail::EntriesOf(cmds));
         }
         std::vector<std::string> Commands() const override
         {
-            return std::vector<std::string>(commands.begin(), commands.end());
+            std::vector<std::string> result;
+            result.reserve(entries.size());
+            for (const auto& e: entries)
+                result.push_back(e.command);
+            return result;
         }
         void Clear() override
         {
-            commands.clear();
+            entries.clear();
+        }
+        // all the keys share the same history
+        void StoreEntries(const std::string&, const std::vector<HistoryEntry>& es) override
+        {
+            using dt = std::deque<HistoryEntry>::difference_type;
+            entries.insert(entries.end(), es.begin(), es.end());
+            if (entries.size() > maxSize)
+                entries.erase(
+                    entries.begin(),
+                    entries.begin()+static_cast<dt>(entries.size()-maxSize)
+                );
+        }
+        std::vector<HistoryEntry> EntriesFor(const std::string&) const override
+        {
+            return std::vector<HistoryEntry>(entries.begin(), entries.end());
         }
     private:
         const std::size_t maxSize;
-        std::deque<std::string> commands;
+        std::deque<HistoryEntry> entries;
 };
 
 } // namespace cli
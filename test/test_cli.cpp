@@ -30,6 +30,11 @@
 #include <boost/test/unit_test.hpp>
 #include "cli/cli.h"
 #include "cli/clifilesession.h"
+#include "cli/keyedhistorystorage.h"
+#include <cstdio>
+#include <fstream>
+#include <regex>
+#include <thread>
 
 using namespace std;
 using namespace cli;
@@ -386,4 +391,1053 @@ BOOST_AUTO_TEST_CASE(ExitActions)
     BOOST_CHECK(exitActionDone);
 }
 
+BOOST_AUTO_TEST_CASE(Tracing)
+{
+    struct RecordingTracer : Tracer
+    {
+        void Begin(TraceStage stage, size_t, const string& cmd) override { events.push_back(string("B ") + ToString(stage) + ' ' + cmd); }
+        void End(TraceStage stage, size_t, const string& cmd) override { events.push_back(string("E ") + ToString(stage) + ' ' + cmd); }
+        vector<string> events;
+    };
+
+    auto rootMenu = make_unique<Menu>("cli");
+    rootMenu->Insert("int_cmd", [](ostream& out, int par){ out << par << "\n"; }, "int_cmd help", {"int_par"} );
+    auto subMenu = make_unique<Menu>("sub");
+    subMenu->Insert("freeform", [](ostream&, const vector<string>&){} );
+    rootMenu->Insert(move(subMenu));
+
+    Cli cli(move(rootMenu));
+    auto tracer = make_shared<RecordingTracer>();
+    cli.SetTracer(tracer);
+
+    stringstream oss;
+
+    UserInput(cli, oss, "int_cmd 42");
+    vector<string> expected = {
+        "B tokenize int_cmd 42", "E tokenize int_cmd 42",
+        "B dispatch int_cmd",
+        "B conversion int_cmd", "E conversion int_cmd",
+        "B handler int_cmd", "E handler int_cmd",
+        "E dispatch int_cmd"
+    };
+    BOOST_CHECK_EQUAL_COLLECTIONS(tracer->events.begin(), tracer->events.end(), expected.begin(), expected.end());
+
+    tracer->events.clear();
+    UserInput(cli, oss, "sub freeform a b");
+    expected = {
+        "B tokenize sub freeform a b", "E tokenize sub freeform a b",
+        "B dispatch sub",
+        "B handler freeform", "E handler freeform",
+        "E dispatch sub"
+    };
+    BOOST_CHECK_EQUAL_COLLECTIONS(tracer->events.begin(), tracer->events.end(), expected.begin(), expected.end());
+
+    // a failed conversion doesn't run the handler
+    tracer->events.clear();
+    UserInput(cli, oss, "int_cmd foo");
+    BOOST_CHECK(find(tracer->events.begin(), tracer->events.end(), "E conversion int_cmd") != tracer->events.end());
+    BOOST_CHECK(find(tracer->events.begin(), tracer->events.end(), "B handler int_cmd") == tracer->events.end());
+}
+
+BOOST_AUTO_TEST_CASE(Audit)
+{
+    struct RecordingSink : AuditSink
+    {
+        void Store(AuditRecord r) override { records.push_back(move(r)); }
+        vector<AuditRecord> records;
+    };
+
+    auto rootMenu = make_unique<Menu>("cli");
+    rootMenu->Insert("int_cmd", [](ostream& out, int par){ out << par << "\n"; }, "int_cmd help", {"int_par"} );
+    auto subMenu = make_unique<Menu>("sub");
+    subMenu->Insert("foo", [](ostream&){} );
+    rootMenu->Insert(move(subMenu));
+
+    Cli cli(move(rootMenu));
+    auto sink = make_shared<RecordingSink>();
+    cli.SetAuditSink(sink);
+
+    stringstream oss;
+
+    UserInput(cli, oss, "int_cmd 42\n\nwrong\nsub\nfoo\n  cli   sub foo");
+    BOOST_REQUIRE_EQUAL(sink->records.size(), 5);
+    BOOST_CHECK_EQUAL(sink->records[0].command, "int_cmd 42");
+    BOOST_CHECK_EQUAL(sink->records[0].menuPath, "/");
+    BOOST_CHECK(sink->records[0].executed);
+    BOOST_CHECK(sink->records[0].peer.empty());
+    BOOST_CHECK_EQUAL(sink->records[1].command, "wrong");
+    BOOST_CHECK(!sink->records[1].executed);
+    BOOST_CHECK_EQUAL(sink->records[2].menuPath, "/");
+    BOOST_CHECK_EQUAL(sink->records[3].command, "foo");
+    BOOST_CHECK_EQUAL(sink->records[3].menuPath, "/sub");
+    BOOST_CHECK(sink->records[3].executed);
+    BOOST_CHECK_EQUAL(sink->records[4].command, "  cli   sub foo");
+    BOOST_CHECK_EQUAL(sink->records[4].menuPath, "/sub");
+    BOOST_CHECK(sink->records[4].executed);
+    for (const auto& r: sink->records)
+        BOOST_CHECK_EQUAL(r.sessionId, sink->records[0].sessionId);
+}
+
+BOOST_AUTO_TEST_CASE(Roles)
+{
+    enum : cli::Roles { admin = 1, bot = 2 };
+
+    auto rootMenu = make_unique<Menu>("cli");
+    rootMenu->Insert("show", [](std::ostream& out){ out << "show\n"; }, "show help");
+    auto reset = rootMenu->Insert("reset", [](std::ostream& out){ out << "reset\n"; }, "reset help");
+    reset.SetRoles(admin);
+    auto subMenu = make_unique<Menu>("sub");
+    subMenu->Insert("foo", [](std::ostream& out){ out << "foo\n"; });
+    subMenu->SetRoles(admin);
+    rootMenu->Insert(move(subMenu));
+    Cli cli(move(rootMenu));
+
+    auto session = [&](cli::Roles roles, const string& input, stringstream& oss)
+    {
+        oss.str("");
+        oss.clear();
+        stringstream iss(input + '\n');
+        CliFileSession s(cli, iss, oss);
+        s.SetRoles(roles);
+        s.Start();
+        return s.GetCompletions("");
+    };
+
+    stringstream oss;
+
+    // admins see everything
+    auto completions = session(admin, "reset", oss);
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "reset");
+    BOOST_CHECK(find(completions.begin(), completions.end(), "reset") != completions.end());
+    BOOST_CHECK(find(completions.begin(), completions.end(), "sub") != completions.end());
+    session(admin, "sub foo", oss);
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "foo");
+
+    // bots can't execute, see in the help or complete the admin commands
+    completions = session(bot, "reset", oss);
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "wrong command: reset");
+    BOOST_CHECK(find(completions.begin(), completions.end(), "show") != completions.end());
+    BOOST_CHECK(find(completions.begin(), completions.end(), "reset") == completions.end());
+    BOOST_CHECK(find(completions.begin(), completions.end(), "sub") == completions.end());
+    session(bot, "sub foo", oss);
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "wrong command: sub foo");
+    session(bot, "help", oss);
+    BOOST_CHECK(oss.str().find("show help") != string::npos);
+    BOOST_CHECK(oss.str().find("reset help") == string::npos);
+    BOOST_CHECK(oss.str().find(" - sub") == string::npos);
+    BOOST_CHECK(oss.str().find(" - help") != string::npos);
+
+    // the commands without roles are visible to everybody
+    session(bot, "show", oss);
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "show");
+}
+
+BOOST_AUTO_TEST_CASE(Abbreviations)
+{
+    enum : cli::Roles { admin = 1, bot = 2 };
+
+    auto rootMenu = make_unique<Menu>("cli");
+    auto showMenu = make_unique<Menu>("show");
+    auto interfacesMenu = make_unique<Menu>("interfaces");
+    interfacesMenu->Insert("brief", [](std::ostream& out){ out << "brief\n"; });
+    interfacesMenu->Insert("detail", [](std::ostream& out, const string& arg){ out << "detail " << arg << "\n"; });
+    showMenu->Insert(move(interfacesMenu));
+    showMenu->Insert("version", [](std::ostream& out){ out << "version\n"; });
+    rootMenu->Insert(move(showMenu));
+    auto shutdown = rootMenu->Insert("shutdown", [](std::ostream& out){ out << "shutdown\n"; });
+    auto removed = rootMenu->Insert("reset", [](std::ostream& out){ out << "reset\n"; });
+    Cli cli(move(rootMenu));
+
+    stringstream oss;
+
+    // disabled by default
+    UserInput(cli, oss, "show interfaces brief");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "brief");
+    UserInput(cli, oss, "sho int br");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "wrong command: sho int br");
+
+    cli.AbbreviatedCommands(true);
+    UserInput(cli, oss, "sho int br");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "brief");
+    UserInput(cli, oss, "show i d foo");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "detail foo");
+    // the parameters are not expanded
+    UserInput(cli, oss, "sho i d b");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "detail b");
+    UserInput(cli, oss, "shu");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "shutdown");
+    // ambiguous
+    UserInput(cli, oss, "sh v");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "wrong command: sh v");
+    UserInput(cli, oss, "he");
+    BOOST_CHECK(oss.str().find("Commands available:") != string::npos);
+    UserInput(cli, oss, "SHO INT BR");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "wrong command: SHO INT BR");
+    UserInput(cli, oss, "res");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "reset");
+
+    // removed commands are not in the index anymore
+    removed.Remove();
+    UserInput(cli, oss, "res");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "wrong command: res");
+
+    cli.AbbreviatedCommands(true, true);
+    UserInput(cli, oss, "SHO INT BR");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "brief");
+
+    // the commands disabled or hidden to the session are not considered
+    cli.AbbreviatedCommands(true);
+    shutdown.Disable();
+    UserInput(cli, oss, "sh v");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "version");
+    UserInput(cli, oss, "shu");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "wrong command: shu");
+    shutdown.Enable();
+    shutdown.SetRoles(admin);
+    auto session = [&](cli::Roles roles, const string& input)
+    {
+        oss.str("");
+        stringstream iss(input + '\n');
+        CliFileSession s(cli, iss, oss);
+        s.SetRoles(roles);
+        s.Start();
+    };
+    session(bot, "sh v");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "version");
+    session(bot, "shu");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "wrong command: shu");
+    session(admin, "sh v");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "wrong command: sh v");
+    session(admin, "shu");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "shutdown");
+}
+
+BOOST_AUTO_TEST_CASE(AbsolutePaths)
+{
+    auto rootMenu = make_unique<Menu>("cli");
+    auto netMenu = make_unique<Menu>("net");
+    auto ifMenu = make_unique<Menu>("if");
+    ifMenu->Insert("show", [](std::ostream& out, const string& arg){ out << "show " << arg << "\n"; });
+    netMenu->Insert(move(ifMenu));
+    netMenu->Insert("routes", [](std::ostream& out){ out << "routes\n"; });
+    auto netMenuPtr = netMenu.get();
+    rootMenu->Insert(move(netMenu));
+    rootMenu->Insert("top", [](std::ostream& out){ out << "top\n"; });
+    Cli cli(move(rootMenu));
+
+    stringstream oss;
+
+    UserInput(cli, oss, "/net/if/show eth0");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "show eth0");
+    UserInput(cli, oss, "/net/routes");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "routes");
+    UserInput(cli, oss, "/top");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "top");
+    UserInput(cli, oss, "/net/if/show");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "wrong command: /net/if/show");
+    UserInput(cli, oss, "/net/foo/show eth0");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "wrong command: /net/foo/show eth0");
+    UserInput(cli, oss, "/net/routes/show eth0");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "wrong command: /net/routes/show eth0");
+
+    // the current menu does not change...
+    stringstream iss("net\n/net/if/show eth1\n/top\n");
+    CliFileSession session(cli, iss, oss);
+    oss.str("");
+    session.Start();
+    BOOST_CHECK(oss.str().find("show eth1") != string::npos);
+    BOOST_CHECK(oss.str().find("top") != string::npos);
+    BOOST_CHECK_EQUAL(ExtractLastPrompt(oss), "net");
+
+    // ...unless the path is a menu
+    stringstream iss2("/net/if\n");
+    CliFileSession session2(cli, iss2, oss);
+    oss.str("");
+    session2.Start();
+    BOOST_CHECK_EQUAL(oss.str(), "cli> if> ");
+    stringstream iss3("net\n/\n");
+    CliFileSession session3(cli, iss3, oss);
+    oss.str("");
+    session3.Start();
+    BOOST_CHECK_EQUAL(oss.str(), "cli> net> cli> ");
+
+    // with the abbreviations
+    cli.AbbreviatedCommands(true);
+    UserInput(cli, oss, "/n/i/s eth0");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "show eth0");
+
+    // with the roles
+    netMenuPtr->SetRoles(1);
+    stringstream iss4("/net/if/show eth0\n");
+    CliFileSession session4(cli, iss4, oss);
+    session4.SetRoles(2);
+    oss.str("");
+    session4.Start();
+    BOOST_CHECK(oss.str().find("wrong command: /net/if/show eth0") != string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(Benchmark)
+{
+    auto rootMenu = make_unique<Menu>("cli");
+    int calls = 0;
+    rootMenu->Insert("hello", [&calls](std::ostream& out){ ++calls; out << "hello\n"; });
+    rootMenu->Insert("add", [](std::ostream& out, int a, int b){ out << a+b << "\n"; });
+    auto subMenu = make_unique<Menu>("sub");
+    subMenu->Insert("foo", [&calls](std::ostream&){ ++calls; });
+    rootMenu->Insert(move(subMenu));
+    Cli cli(move(rootMenu));
+
+    stringstream oss;
+
+    UserInput(cli, oss, "time hello");
+    BOOST_CHECK_EQUAL(calls, 1);
+    const regex timeOutput(R"(hello\nreal \d+\.\d{3}ms, cpu \d+\.\d{3}ms, output 6 bytes)");
+    BOOST_CHECK(regex_match(ExtractContent(oss), timeOutput));
+
+    UserInput(cli, oss, "time add 1 2");
+    BOOST_CHECK(ExtractContent(oss).find("3\nreal ") == 0);
+    BOOST_CHECK(ExtractContent(oss).find("output 2 bytes") != string::npos);
+
+    UserInput(cli, oss, "time /sub/foo");
+    BOOST_CHECK_EQUAL(calls, 2);
+    BOOST_CHECK(ExtractContent(oss).find("output 0 bytes") != string::npos);
+
+    UserInput(cli, oss, "time foo");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "wrong command: foo");
+
+    UserInput(cli, oss, "time");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "usage: time <command>");
+
+    calls = 0;
+    UserInput(cli, oss, "repeat 5 hello");
+    BOOST_CHECK_EQUAL(calls, 5);
+    const regex repeatOutput(R"((hello\n){5}5 runs: min \d+\.\d{3}ms, median \d+\.\d{3}ms, max \d+\.\d{3}ms, mean \d+\.\d{3}ms)");
+    BOOST_CHECK(regex_match(ExtractContent(oss), repeatOutput));
+
+    UserInput(cli, oss, "repeat 3 sub foo");
+    BOOST_CHECK_EQUAL(calls, 8);
+
+    // the commands can be nested
+    UserInput(cli, oss, "time repeat 2 hello");
+    BOOST_CHECK_EQUAL(calls, 10);
+    BOOST_CHECK(ExtractContent(oss).find("hello\nhello\n2 runs: ") == 0);
+
+    UserInput(cli, oss, "repeat 3 foo");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "wrong command: foo");
+    UserInput(cli, oss, "repeat x hello");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "usage: repeat <n> <command>");
+    UserInput(cli, oss, "repeat 0 hello");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "usage: repeat <n> <command>");
+    UserInput(cli, oss, "repeat 100000000000000 hello");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "usage: repeat <n> <command>");
+    BOOST_CHECK_EQUAL(calls, 10);
+
+    // the aliases run as on the command line
+    cli.Alias("hi", "hello");
+    UserInput(cli, oss, "repeat 2 hi");
+    BOOST_CHECK_EQUAL(calls, 12);
+    BOOST_CHECK(ExtractContent(oss).find("hello\nhello\n2 runs: ") == 0);
+    UserInput(cli, oss, "time hi");
+    BOOST_CHECK_EQUAL(calls, 13);
+    BOOST_CHECK(ExtractContent(oss).find("hello\nreal ") == 0);
+}
+
+BOOST_AUTO_TEST_CASE(Deadlines)
+{
+    auto rootMenu = make_unique<Menu>("cli");
+    // writes until it's cancelled
+    int lines = 0;
+    auto slow = rootMenu->Insert("slow", [&lines](std::ostream& out)
+    {
+        out << "start\n";
+        while (!Cancelled(out))
+        {
+            this_thread::sleep_for(chrono::milliseconds(1));
+            ++lines;
+        }
+        out << "discarded\n";
+        BOOST_CHECK(!out);
+    });
+    slow.SetDeadline(chrono::milliseconds(20));
+    rootMenu->Insert("sleep", [](std::ostream& out, int ms)
+    {
+        this_thread::sleep_for(chrono::milliseconds(ms));
+        out << "awake\n";
+    });
+    rootMenu->Insert("fast", [](std::ostream& out){ out << "fast\n"; BOOST_CHECK(!Cancelled(out)); });
+    Cli cli(move(rootMenu));
+
+    stringstream oss;
+
+    // the deadline of the command
+    UserInput(cli, oss, "slow");
+    BOOST_CHECK(lines > 0);
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "start\ncommand timed out after 20.000ms");
+    BOOST_CHECK_EQUAL(cli.TimedOutCommands(), 1u);
+
+    // no deadline for the others
+    UserInput(cli, oss, "sleep 30");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "awake");
+    BOOST_CHECK_EQUAL(cli.TimedOutCommands(), 1u);
+
+    // the deadline of the session
+    oss.str("");
+    stringstream iss("sleep 30\nfast\n");
+    CliFileSession session(cli, iss, oss);
+    session.CommandDeadline(chrono::milliseconds(10));
+    session.Start();
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "command timed out after 10.000ms\ncli> fast");
+    BOOST_CHECK_EQUAL(cli.TimedOutCommands(), 2u);
+
+    // repeat stops at the deadline
+    oss.str("");
+    stringstream repeatInput("repeat 10000 sleep 1\n");
+    CliFileSession repeating(cli, repeatInput, oss);
+    repeating.CommandDeadline(chrono::milliseconds(20));
+    const auto start = chrono::steady_clock::now();
+    repeating.Start();
+    BOOST_CHECK(chrono::steady_clock::now() - start < chrono::seconds(5));
+    BOOST_CHECK(ExtractContent(oss).find("command timed out after 20.000ms") != string::npos);
+    BOOST_CHECK_EQUAL(cli.TimedOutCommands(), 3u);
+}
+
+BOOST_AUTO_TEST_CASE(Sessions)
+{
+    auto rootMenu = make_unique<Menu>("cli");
+    rootMenu->Insert("hello", [](std::ostream& out){ out << "world\n"; });
+    rootMenu->Insert(make_unique<Menu>("sub"));
+    Cli cli(move(rootMenu));
+    cli.SessionCommands();
+
+    // a session left open in the submenu
+    stringstream input("hello\nsub\n");
+    stringstream output;
+    struct KilledSession : CliFileSession
+    {
+        using CliFileSession::CliFileSession;
+        void Kill() override { killed = true; }
+        bool killed = false;
+    } session(cli, input, output);
+    session.Start();
+
+    auto sessions = cli.Sessions();
+    BOOST_REQUIRE_EQUAL(sessions.size(), 1u);
+    BOOST_CHECK_EQUAL(sessions[0].id, session.Id());
+    BOOST_CHECK_EQUAL(sessions[0].menuPath, "/sub");
+    BOOST_CHECK_EQUAL(sessions[0].commands, 2u);
+    BOOST_CHECK_EQUAL(sessions[0].bytesIn, 10u);
+    BOOST_CHECK(sessions[0].peer.empty());
+
+    // the table, with the session running the command marked
+    stringstream oss;
+    UserInput(cli, oss, "sessions");
+    const auto table = ExtractContent(oss);
+    BOOST_CHECK_EQUAL(count(table.begin(), table.end(), '\n'), 2);
+    BOOST_CHECK(table.find("\n  " + to_string(session.Id()) + " ") != string::npos);
+    BOOST_CHECK(table.find("\n* ") != string::npos);
+    BOOST_CHECK(table.find("/sub") != string::npos);
+
+    UserInput(cli, oss, "kill-session " + to_string(session.Id()));
+    BOOST_CHECK(session.killed);
+    UserInput(cli, oss, "kill-session 100000");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "no session 100000");
+    BOOST_CHECK_EQUAL(cli.Sessions().size(), 1u);
+
+    // the commands can be reserved to some roles
+    cli.SessionCommands(2);
+    stringstream iss("sessions\n");
+    oss.str("");
+    CliFileSession user(cli, iss, oss);
+    user.SetRoles(1);
+    user.Start();
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "wrong command: sessions");
+}
+
+BOOST_AUTO_TEST_CASE(KillSessionExecutor)
+{
+    Cli cli(make_unique<Menu>("cli"));
+    struct KilledSession : CliSession
+    {
+        using CliSession::CliSession;
+        void Kill() override { ++kills; }
+        int kills = 0;
+    };
+    stringstream oss;
+    auto session = make_unique<KilledSession>(cli, oss);
+    const auto sessionId = session->Id();
+    vector<function<void()>> tasks;
+    session->SetExecutor([&tasks](function<void()> task){ tasks.push_back(move(task)); });
+
+    // the kill runs on the thread of the session
+    BOOST_CHECK(cli.KillSession(sessionId));
+    BOOST_CHECK_EQUAL(session->kills, 0);
+    BOOST_REQUIRE_EQUAL(tasks.size(), 1u);
+    tasks[0]();
+    BOOST_CHECK_EQUAL(session->kills, 1);
+
+    // and it's dropped if the session is destroyed before
+    BOOST_CHECK(cli.KillSession(sessionId));
+    session.reset();
+    BOOST_REQUIRE_EQUAL(tasks.size(), 2u);
+    tasks[1]();
+    BOOST_CHECK(!cli.KillSession(sessionId));
+}
+
+BOOST_AUTO_TEST_CASE(Broadcast)
+{
+    Cli cli(make_unique<Menu>("cli"));
+    Cli other(make_unique<Menu>("other"));
+    stringstream in1, in2, in3, in4;
+    stringstream out1, out2, out3, out4;
+    CliFileSession operators(cli, in1, out1);
+    CliFileSession bot(cli, in2, out2);
+    CliFileSession admin(cli, in3, out3);
+    CliFileSession stranger(other, in4, out4);
+    operators.Join("alarms");
+    admin.Join("alarms");
+    admin.Join("audit");
+    admin.Join("alarms"); // once
+    stranger.Join("alarms");
+
+    BOOST_CHECK_EQUAL(cli.Broadcast("alarms", "fire\n"), 2u);
+    BOOST_CHECK_EQUAL(cli.Broadcast("nobody", "lost\n"), 0u);
+    BOOST_CHECK_EQUAL(cli.Broadcast("", "hello\n"), 3u); // all the sessions of the cli
+    {
+        auto channel = cli.Channel("audit");
+        channel << "login " << 42 << std::endl;
+        channel << "logout";
+    }
+    BOOST_CHECK_EQUAL(out1.str(), "fire\nhello\n");
+    BOOST_CHECK_EQUAL(out2.str(), "hello\n");
+    BOOST_CHECK_EQUAL(out3.str(), "fire\nhello\nlogin 42\nlogout");
+    BOOST_CHECK_EQUAL(out4.str(), "");
+
+    BOOST_CHECK(admin.Groups() == (vector<string>{"alarms", "audit"}));
+    admin.Leave("alarms");
+    BOOST_CHECK(admin.Groups() == vector<string>{"audit"});
+    BOOST_CHECK_EQUAL(cli.Broadcast("alarms", "flood\n"), 1u);
+
+    // the sessions destroyed leave their groups
+    {
+        stringstream in, out;
+        CliFileSession temporary(cli, in, out);
+        temporary.Join("alarms");
+        BOOST_CHECK_EQUAL(cli.Broadcast("alarms", "x"), 2u);
+    }
+    BOOST_CHECK_EQUAL(cli.Broadcast("alarms", "y"), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(BroadcastExecutor)
+{
+    Cli cli(make_unique<Menu>("cli"));
+    stringstream out1, out2;
+    CliSession posted(cli, out1);
+    auto closed = make_unique<CliSession>(cli, out2);
+    vector<function<void()>> tasks;
+    posted.SetExecutor([&tasks](function<void()> task){ tasks.push_back(move(task)); });
+    closed->SetExecutor([&tasks](function<void()> task){ tasks.push_back(move(task)); });
+    out1.str("");
+    out2.str("");
+
+    // the text is written by the sessions when they run the tasks
+    BOOST_CHECK_EQUAL(cli.Broadcast("", "hello\n"), 2u);
+    cli.Channel("") << "world" << std::endl;
+    BOOST_REQUIRE_EQUAL(tasks.size(), 4u);
+    BOOST_CHECK_EQUAL(out1.str(), "");
+    closed.reset();
+    for (auto& t: tasks)
+        t();
+    BOOST_CHECK_EQUAL(out1.str(), "hello\nworld\n");
+    BOOST_CHECK_EQUAL(cli.Broadcast("", "again\n"), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(BroadcastDuringCommands)
+{
+    auto rootMenu = make_unique<Menu>("cli");
+    Cli* broadcaster = nullptr;
+    auto late = rootMenu->Insert("late", [&broadcaster](std::ostream& out)
+    {
+        while (!Cancelled(out))
+            this_thread::sleep_for(chrono::milliseconds(1));
+        broadcaster->Broadcast("", "news\n");
+        out << "discarded\n";
+    });
+    late.SetDeadline(chrono::milliseconds(10));
+    rootMenu->Insert("notify", [&broadcaster](std::ostream& out)
+    {
+        out << "sent\n";
+        broadcaster->Broadcast("", "news\n");
+    });
+    Cli cli(move(rootMenu));
+    broadcaster = &cli;
+
+    stringstream oss;
+
+    // the deadline of a command doesn't discard the broadcasts
+    UserInput(cli, oss, "late");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "news\ncommand timed out after 10.000ms");
+
+    // and they're not counted in the output of the command
+    UserInput(cli, oss, "time notify");
+    const auto content = ExtractContent(oss);
+    BOOST_CHECK(content.find("sent\nnews\n") == 0);
+    BOOST_CHECK(content.find("output 5 bytes") != string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(HistoryKeys)
+{
+    auto rootMenu = make_unique<Menu>("cli");
+    rootMenu->Insert("hello", [](std::ostream& out){ out << "world\n"; });
+    auto storage = make_unique<KeyedHistoryStorage>("cli_test_keyed_history");
+    storage->Clear(); // in case the test runs multiple times
+    Cli cli(move(rootMenu), move(storage));
+
+    stringstream oss;
+    {
+        CliSession session(cli, oss, 10);
+        session.HistoryKey("alice");
+        session.Feed("hello");
+        session.Feed("help");
+        session.Exit();
+    }
+    UserInput(cli, oss, "hello"); // with the empty key
+    BOOST_CHECK(cli.GetCommands("alice") == (vector<string>{"hello", "help"}));
+    BOOST_CHECK(cli.GetCommands() == vector<string>{"hello"});
+
+    // the history of the key is loaded
+    CliSession session(cli, oss, 10);
+    BOOST_CHECK_EQUAL(session.PreviousCmd(""), "hello");
+    session.NextCmd();
+    session.HistoryKey("alice");
+    BOOST_CHECK_EQUAL(session.HistoryKey(), "alice");
+    BOOST_CHECK_EQUAL(session.PreviousCmd(""), "help");
+    BOOST_CHECK_EQUAL(session.PreviousCmd("help"), "hello");
+    cli.StoreCommands("alice", {});
+}
+
+BOOST_AUTO_TEST_CASE(HistoryQueries)
+{
+    auto rootMenu = make_unique<Menu>("cli");
+    rootMenu->Insert("sleep", [](std::ostream& out, int ms)
+    {
+        this_thread::sleep_for(chrono::milliseconds(ms));
+        out << "awake\n";
+    });
+    rootMenu->Insert("fail", [](std::ostream&){ throw std::runtime_error("failed"); });
+    Cli cli(move(rootMenu));
+
+    stringstream oss;
+    CliSession session(cli, oss, 10);
+    session.Feed("sleep 30");
+    session.Feed("sleep 1");
+    session.Feed("nothere");
+    BOOST_CHECK_THROW(session.Feed("fail"), std::runtime_error);
+
+    const auto entries = session.HistoryEntries();
+    BOOST_REQUIRE_EQUAL(entries.size(), 4u);
+    BOOST_CHECK(entries[0].duration >= chrono::milliseconds(30));
+    BOOST_CHECK_EQUAL(entries[0].outputSize, 6u); // "awake\n"
+    BOOST_CHECK(entries[0].success);
+    BOOST_CHECK(!entries[2].success);
+    BOOST_CHECK(!entries[3].success);
+
+    oss.str({});
+    session.ShowHistory({"slowest", "1"});
+    auto lines = oss.str();
+    BOOST_CHECK(lines.find("sleep 30") != string::npos);
+    BOOST_CHECK(lines.find("sleep 1\n") == string::npos);
+    BOOST_CHECK_EQUAL(count(lines.begin(), lines.end(), '\n'), 1);
+
+    oss.str({});
+    session.ShowHistory({"failures"});
+    lines = oss.str();
+    BOOST_CHECK(lines.find("failed  nothere") != string::npos);
+    BOOST_CHECK(lines.find("failed  fail") != string::npos);
+    BOOST_CHECK(lines.find("sleep") == string::npos);
+
+    oss.str({});
+    session.ShowHistory({"since", "1h"});
+    lines = oss.str();
+    BOOST_CHECK_EQUAL(count(lines.begin(), lines.end(), '\n'), 4);
+
+    oss.str({});
+    session.ShowHistory({"since", "1x"});
+    BOOST_CHECK(oss.str().find("usage") == 0);
+
+    // the results go to the history storage
+    session.Exit();
+    const auto stored = cli.GetEntries({});
+    BOOST_REQUIRE_EQUAL(stored.size(), 4u);
+    BOOST_CHECK(stored[0].duration == entries[0].duration);
+    BOOST_CHECK(!stored[2].success);
+}
+
+BOOST_AUTO_TEST_CASE(Aliases)
+{
+    auto rootMenu = make_unique<Menu>("cli");
+    rootMenu->Insert("echo", [](std::ostream& out, const vector<string>& args)
+    {
+        for (const auto& a: args) out << a << ';';
+        out << '\n';
+    });
+    auto subMenu = make_unique<Menu>("sub");
+    subMenu->Insert("hello", [](std::ostream& out){ out << "hello from sub\n"; });
+    rootMenu->Insert(move(subMenu));
+    Cli cli(move(rootMenu));
+    cli.Alias("hi", "echo hi");
+
+    stringstream oss;
+    CliSession session(cli, oss, 10);
+    auto run = [&](const string& cmd)
+    {
+        oss.str({});
+        session.Feed(cmd);
+        return oss.str();
+    };
+
+    // the arguments go to the last command
+    BOOST_CHECK_EQUAL(run("hi there"), "hi;there;\n");
+
+    // multi-command macro with parameters, defined by the session
+    run("alias greet echo $2 \"$1 and $2\" ; sub ; hello");
+    BOOST_CHECK_EQUAL(run("greet a b"), "b;a and b;\nhello from sub\n");
+    run("/");
+    BOOST_CHECK_EQUAL(run("greet a"), "greet: 2 arguments expected\n");
+    BOOST_CHECK_EQUAL(run("alias greet"), "greet = echo $2 \"$1 and $2\" ; sub ; hello\n");
+
+    // the aliases of the session hide the ones of the cli (and the commands)
+    session.Alias("hi", "echo session");
+    session.Alias("echo", "echo [ $* ]");
+    BOOST_CHECK_EQUAL(run("hi"), "session;\n");
+    BOOST_CHECK_EQUAL(run("echo x"), "[;x;];\n");
+    BOOST_CHECK_EQUAL(run("alias"), "echo = echo [ $* ]\ngreet = echo $2 \"$1 and $2\" ; sub ; hello\nhi = echo session\n");
+    run("unalias hi");
+    BOOST_CHECK_EQUAL(run("hi"), "hi;\n");
+    BOOST_CHECK_EQUAL(run("unalias hi"), "no alias hi\n");
+    run("unalias echo");
+
+    // stops at the first command not found
+    run("alias broken echo 1 ; nothere ; echo 2");
+    BOOST_CHECK_EQUAL(run("broken"), "1;\nwrong command: nothere (in broken)\n");
+    BOOST_CHECK(!session.HistoryEntries().back().success);
+
+    cli.Alias("hi", "");
+    BOOST_CHECK(cli.Aliases().empty());
+    BOOST_CHECK_EQUAL(run("hi"), "wrong command: hi\n");
+}
+
+BOOST_AUTO_TEST_CASE(Scripts)
+{
+    auto rootMenu = make_unique<Menu>("cli");
+    vector<int> vlans;
+    rootMenu->Insert("vlan", [&](std::ostream&, int id){ vlans.push_back(id); });
+    rootMenu->Insert("check", [](std::ostream& out, int id){ out << "checked " << id << '\n'; });
+    rootMenu->Insert("end", [](std::ostream& out){ out << "end command\n"; });
+    Cli cli(move(rootMenu));
+
+    // without Scripting, the keywords are plain commands
+    stringstream oss;
+    UserInput(cli, oss, "end");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "end command");
+
+    cli.Scripting(true);
+    stringstream iss("first=10\nfor i in $first..4009\nvlan $i\nend\nif vlan 1\ncheck 1\nelse\ncheck 0\nend\nif nothere\ncheck 2\nend\nexit\n");
+    oss.str({});
+    CliFileSession session(cli, iss, oss);
+    session.Start();
+    BOOST_REQUIRE_EQUAL(vlans.size(), 4001u);
+    BOOST_CHECK_EQUAL(vlans.front(), 10);
+    BOOST_CHECK_EQUAL(vlans.back(), 1);
+    BOOST_CHECK(oss.str().find("checked 1\n") != string::npos);
+    BOOST_CHECK(oss.str().find("checked 0\n") == string::npos);
+    BOOST_CHECK(oss.str().find("wrong command: nothere\n") != string::npos);
+    BOOST_CHECK(oss.str().find("checked 2\n") == string::npos);
+    BOOST_CHECK_EQUAL(session.Variable("first"), "10");
+    BOOST_CHECK_EQUAL(session.Variable("i"), "4009");
+
+    // the errors
+    CliSession s(cli, oss, 10);
+    oss.str({});
+    s.Feed("else");
+    BOOST_CHECK_EQUAL(oss.str(), "else without if\n");
+    s.Variable("x", "42");
+    oss.str({});
+    s.Feed("check $x");
+    BOOST_CHECK_EQUAL(oss.str(), "checked 42\n");
+
+    // the commands of a block go in the log and in the audit, the block with its first line
+    struct RecordingSink : AuditSink
+    {
+        void Store(AuditRecord r) override { records.push_back(move(r)); }
+        vector<AuditRecord> records;
+    };
+    auto sink = make_shared<RecordingSink>();
+    cli.SetAuditSink(sink);
+    s.Feed("for i in 1..2");
+    s.Feed("check $i");
+    s.Feed("end");
+    const auto entries = s.HistoryEntries();
+    BOOST_REQUIRE(entries.size() >= 3u);
+    // in the order they started
+    BOOST_CHECK_EQUAL(entries[entries.size() - 3].command, "for i in 1..2");
+    BOOST_CHECK_EQUAL(entries[entries.size() - 2].command, "check 1");
+    BOOST_CHECK_EQUAL(entries[entries.size() - 1].command, "check 2");
+    BOOST_REQUIRE_EQUAL(sink->records.size(), 3u);
+    BOOST_CHECK_EQUAL(sink->records[0].command, "check 1");
+    BOOST_CHECK_EQUAL(sink->records[1].command, "check 2");
+    BOOST_CHECK_EQUAL(sink->records[2].command, "for i in 1..2");
+    cli.SetAuditSink(nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(Source)
+{
+    auto rootMenu = make_unique<Menu>("cli");
+    size_t count = 0;
+    rootMenu->Insert("inc", [&](std::ostream&){ ++count; });
+    CliSession* current = nullptr;
+    rootMenu->Insert("stop", [&](std::ostream&){ current->CancelSource(); });
+    auto subMenu = make_unique<Menu>("sub");
+    subMenu->Insert("hello", [](std::ostream& out){ out << "hello from sub\n"; });
+    rootMenu->Insert(move(subMenu));
+    Cli cli(move(rootMenu));
+    cli.SourceCommand();
+    cli.Scripting(true);
+
+    const string fileName = "cli_test_source";
+    {
+        ofstream f(fileName, ios_base::binary);
+        f << "# a comment\r\n";
+        for (int i = 0; i < 10000; ++i)
+            f << "inc\r\n";
+        f << "\nfor i in 1..5\ninc\nend\nsub\nhello"; // no end of line
+    }
+
+    stringstream oss;
+    CliSession session(cli, oss, 10);
+    current = &session;
+    vector<SourceProgress> reports;
+    session.ReportSourceProgress(chrono::milliseconds(0), [&](const SourceProgress& p){ reports.push_back(p); });
+    session.Feed("source " + fileName);
+    BOOST_CHECK_EQUAL(count, 10005u);
+    BOOST_CHECK_EQUAL(oss.str(), "hello from sub\n");
+    // the session stays in the menu of the file
+    oss.str({});
+    session.Feed("hello");
+    BOOST_CHECK_EQUAL(oss.str(), "hello from sub\n");
+    session.Feed("/");
+    // one report per line terminated (with a zero interval), plus the final one
+    BOOST_REQUIRE_EQUAL(reports.size(), 10007u);
+    BOOST_CHECK(reports.back().done);
+    BOOST_CHECK_EQUAL(reports.back().lines, 10007u);
+    BOOST_CHECK_EQUAL(reports.back().bytes, reports.back().size);
+    // just "source" goes in the history
+    BOOST_CHECK_EQUAL(session.HistoryEntries().size(), 3u);
+    BOOST_CHECK_EQUAL(session.HistoryEntries()[0].command, "source " + fileName);
+
+    // canceled
+    {
+        ofstream f(fileName);
+        f << "inc\nstop\ninc\n";
+    }
+    count = 0;
+    BOOST_CHECK(!session.Source(fileName));
+    BOOST_CHECK_EQUAL(count, 1u);
+    BOOST_CHECK(session.Source(fileName + "_missing") == false);
+
+    // a block not closed
+    {
+        ofstream f(fileName);
+        f << "for i in 1..5\ninc\n";
+    }
+    oss.str({});
+    count = 0;
+    session.ReportSourceProgress(chrono::milliseconds(1000));
+    BOOST_CHECK(session.Source(fileName));
+    BOOST_CHECK_EQUAL(count, 0u);
+    BOOST_CHECK_EQUAL(oss.str(), "source " + fileName + ": missing end\n");
+    oss.str({});
+    session.Feed("inc");
+    BOOST_CHECK_EQUAL(count, 1u);
+
+    // the commands not found are reported by position, not by content
+    {
+        ofstream f(fileName);
+        f << "inc\nsecret password\nfor i in 1..2\nsecret $i\nend\n";
+    }
+    oss.str({});
+    BOOST_CHECK(session.Source(fileName));
+    BOOST_CHECK_EQUAL(oss.str(), "wrong command at " + fileName + ":2\n" +
+                                 "wrong command at " + fileName + ":5\n" +
+                                 "wrong command at " + fileName + ":5\n");
+    BOOST_CHECK_EQUAL(oss.str().find("secret"), string::npos);
+    oss.str({});
+    session.Feed("secret");
+    BOOST_CHECK_EQUAL(oss.str(), "wrong command: secret\n");
+
+    // only the files in the directory of the command
+    for (const string& file: vector<string>{"/etc/passwd", "../" + fileName, "sub/../../" + fileName, "..\\" + fileName})
+    {
+        oss.str({});
+        session.Feed("source \"" + file + "\"");
+        BOOST_CHECK_EQUAL(oss.str(), "source: " + file + " is not in the source directory\n");
+        BOOST_CHECK(!session.LastStatus().Ok());
+    }
+
+    remove(fileName.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(CommandStatus)
+{
+    struct RecordingSink : AuditSink
+    {
+        void Store(AuditRecord r) override { records.push_back(move(r)); }
+        vector<AuditRecord> records;
+    };
+
+    auto rootMenu = make_unique<Menu>("cli");
+    size_t count = 0;
+    rootMenu->Insert("inc", [&](std::ostream&){ ++count; });
+    rootMenu->Insert("check", [](std::ostream&, int value) -> cli::Status
+    {
+        if (value < 0) return {cli::Status::failed, "negative"};
+        if (value > 100) return 2;
+        return {};
+    });
+    rootMenu->Insert("throw", [](std::ostream&){ throw CommandError("broken", 3); });
+    // the other return types are not a status
+    rootMenu->Insert("flag", [](std::ostream&){ return true; });
+    rootMenu->Insert("zero", [](std::ostream&, int value){ return value; });
+    rootMenu->Insert("echo", [](std::ostream& out, const vector<string>& args)
+    {
+        for (const auto& a: args) out << a << (&a == &args.back() ? "\n" : " ");
+    });
+    Cli cli(move(rootMenu));
+    auto sink = make_shared<RecordingSink>();
+    cli.SetAuditSink(sink);
+
+    stringstream oss;
+    CliSession session(cli, oss, 10);
+    session.Feed("check 1");
+    BOOST_CHECK(session.LastStatus().Ok());
+    session.Feed("check -1");
+    BOOST_CHECK_EQUAL(session.LastStatus().code, cli::Status::failed);
+    BOOST_CHECK_EQUAL(session.LastStatus().message, "negative");
+    session.Feed("check 1000");
+    BOOST_CHECK_EQUAL(session.LastStatus().code, 2);
+    session.Feed("inc");
+    BOOST_CHECK(session.LastStatus().Ok());
+    session.Feed("nothere");
+    BOOST_CHECK_EQUAL(session.LastStatus().code, cli::Status::notFound);
+    BOOST_CHECK_EQUAL(oss.str(), "wrong command: nothere\n");
+    oss.str({});
+    session.Feed("throw");
+    BOOST_CHECK_EQUAL(session.LastStatus().code, 3);
+    BOOST_CHECK_EQUAL(oss.str(), "broken\n");
+    session.Feed("flag");
+    BOOST_CHECK(session.LastStatus().Ok());
+    session.Feed("zero 5");
+    BOOST_CHECK(session.LastStatus().Ok());
+    BOOST_CHECK_EQUAL(cli.FailedCommands(), 4u);
+
+    BOOST_REQUIRE_EQUAL(sink->records.size(), 8u);
+    BOOST_CHECK_EQUAL(sink->records[1].status, cli::Status::failed);
+    BOOST_CHECK(sink->records[1].executed);
+    BOOST_CHECK_EQUAL(sink->records[3].status, 0);
+    BOOST_CHECK_EQUAL(sink->records[4].status, cli::Status::notFound);
+    BOOST_CHECK(!sink->records[4].executed);
+    BOOST_CHECK_EQUAL(sink->records[5].status, 3);
+
+    // without Scripting, "&&" and "||" are plain arguments
+    oss.str({});
+    session.Feed("echo a && b");
+    BOOST_CHECK_EQUAL(oss.str(), "a && b\n");
+
+    // "&&" and "||"
+    cli.Scripting(true);
+    count = 0;
+    session.Feed("check 1 && inc && check -1 && inc");
+    BOOST_CHECK_EQUAL(count, 1u);
+    BOOST_CHECK(!session.LastStatus().Ok());
+    session.Feed("check -1 || inc");
+    BOOST_CHECK_EQUAL(count, 2u);
+    BOOST_CHECK(session.LastStatus().Ok());
+    // like a shell: the "&&" after the skipped command applies to the status of "check 1"
+    session.Feed("check 1 || inc && inc");
+    BOOST_CHECK_EQUAL(count, 3u);
+    session.Feed("flag && inc");
+    BOOST_CHECK_EQUAL(count, 4u);
+    oss.str({});
+    session.Feed("inc &&");
+    BOOST_CHECK_EQUAL(oss.str(), "wrong command: inc &&\n");
+    BOOST_CHECK_EQUAL(count, 4u);
+    // quoted, they're arguments
+    oss.str({});
+    session.Feed("echo a \"&&\" b && echo '||'");
+    BOOST_CHECK_EQUAL(oss.str(), "a && b\n||\n");
+
+    // the status line
+    session.StatusLine(true);
+    oss.str({});
+    session.Feed("check -1");
+    session.Feed("inc");
+    BOOST_CHECK_EQUAL(oss.str(), "%status 1 negative\n%status 0\n");
+    session.StatusLine(false);
+
+    // a script stopping at the first failure
+    count = 0;
+    session.StopOnError(true);
+    session.Feed("for i in 1..5");
+    session.Feed("inc");
+    session.Feed("check -$i");
+    session.Feed("end");
+    BOOST_CHECK_EQUAL(count, 1u);
+    BOOST_CHECK(!session.LastStatus().Ok());
+    session.StopOnError(false);
+    session.Feed("for i in 1..5");
+    session.Feed("inc");
+    session.Feed("check -$i");
+    session.Feed("end");
+    BOOST_CHECK_EQUAL(count, 6u);
+
+    // a file session stopping at the first failure
+    count = 0;
+    stringstream iss("inc\ncheck -1\ninc\n");
+    oss.str({});
+    CliFileSession fileSession(cli, iss, oss);
+    fileSession.StopOnError(true);
+    fileSession.Start();
+    BOOST_CHECK_EQUAL(count, 1u);
+}
+
+BOOST_AUTO_TEST_CASE(SlowCommands)
+{
+    auto rootMenu = make_unique<Menu>("cli");
+    rootMenu->Insert("sleep", [](std::ostream& out, int ms)
+    {
+        this_thread::sleep_for(chrono::milliseconds(ms));
+        out << "awake\n";
+    });
+    Cli cli(move(rootMenu));
+    vector<AuditRecord> logged;
+    cli.SlowCommandLog(chrono::milliseconds(20), [&logged](const AuditRecord& r){ logged.push_back(r); });
+
+    stringstream oss;
+    UserInput(cli, oss, "sleep 1");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "awake");
+    BOOST_CHECK(logged.empty());
+
+    UserInput(cli, oss, "sleep 30");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "awake");
+    BOOST_REQUIRE_EQUAL(logged.size(), 1u);
+    BOOST_CHECK_EQUAL(logged[0].command, "sleep 30");
+    BOOST_CHECK(logged[0].executed);
+    BOOST_CHECK(logged[0].duration >= chrono::milliseconds(30));
+    BOOST_CHECK_EQUAL(cli.SlowCommands(), 1u);
+
+    // a zero threshold disables the log
+    cli.SlowCommandLog(chrono::milliseconds(0));
+    UserInput(cli, oss, "sleep 30");
+    BOOST_CHECK_EQUAL(cli.SlowCommands(), 1u);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,136 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#include <boost/test/unit_test.hpp>
+#include "cli/detail/commandlog.h"
+
+using namespace cli;
+using namespace cli::detail;
+using namespace std;
+
+namespace
+{
+chrono::system_clock::time_point At(long long s)
+{
+    return chrono::system_clock::time_point(chrono::seconds(s));
+}
+
+HistoryEntry Entry(const string& command, long long time, long long us, bool success = true)
+{
+    HistoryEntry e;
+    e.command = command;
+    e.time = At(time);
+    e.duration = chrono::microseconds(us);
+    e.success = success;
+    return e;
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(CommandLogSuite)
+
+BOOST_AUTO_TEST_CASE(AddAndComplete)
+{
+    CommandLog log(3);
+    BOOST_CHECK(log.Entries().empty());
+    const auto a = log.Add("a", At(100));
+    log.Complete(a, chrono::microseconds(10), 20, true);
+    const auto b = log.Add("b", At(101));
+    const auto b2 = log.Add("b", At(102)); // same as the last one: replaced
+    BOOST_CHECK_EQUAL(b, b2);
+    log.Complete(b, chrono::microseconds(30), 1ull << 40, false); // saturated
+
+    auto entries = log.Entries();
+    BOOST_REQUIRE_EQUAL(entries.size(), 2u);
+    BOOST_CHECK_EQUAL(entries[0].command, "a");
+    BOOST_CHECK(entries[0].time == At(100));
+    BOOST_CHECK(entries[0].duration == chrono::microseconds(10));
+    BOOST_CHECK_EQUAL(entries[0].outputSize, 20u);
+    BOOST_CHECK(entries[0].success);
+    BOOST_CHECK(entries[1].time == At(102));
+    BOOST_CHECK_EQUAL(entries[1].outputSize, 0x7FFFFFFFu);
+    BOOST_CHECK(!entries[1].success);
+
+    // the oldest entries are discarded
+    log.Add("c", At(103));
+    log.Add("d", At(104));
+    log.Complete(a, chrono::microseconds(99), 0, false); // no more in the log
+    entries = log.Entries();
+    BOOST_REQUIRE_EQUAL(entries.size(), 3u);
+    BOOST_CHECK_EQUAL(entries[0].command, "b");
+    BOOST_CHECK_EQUAL(entries[2].command, "d");
+}
+
+BOOST_AUTO_TEST_CASE(NewEntries)
+{
+    CommandLog log(10);
+    log.Load({Entry("x", 1, 5), Entry("y", 2, 5)});
+    BOOST_CHECK(log.NewEntries().empty());
+    const auto id = log.Add("y", At(3)); // the last loaded one is not replaced
+    log.Add("z", At(4));
+    const auto added = log.NewEntries();
+    BOOST_REQUIRE_EQUAL(added.size(), 2u);
+    BOOST_CHECK_EQUAL(added[0].command, "y");
+    BOOST_CHECK_EQUAL(added[1].command, "z");
+    BOOST_CHECK_EQUAL(log.Size(), 4u);
+
+    // a new load forgets the ids of the previous entries
+    log.Load({Entry("x", 1, 5)});
+    log.Complete(id, chrono::microseconds(1), 1, false);
+    BOOST_CHECK(log.Entries()[0].success);
+    BOOST_CHECK(log.NewEntries().empty());
+}
+
+BOOST_AUTO_TEST_CASE(Queries)
+{
+    CommandLog log(10);
+    log.Load({
+        Entry("plain", 0, 0),
+        Entry("fast", 100, 5),
+        Entry("slow", 200, 5000),
+        Entry("bad", 300, 50, false),
+        Entry("medium", 400, 500)
+    });
+
+    const auto slowest = log.Slowest(2);
+    BOOST_REQUIRE_EQUAL(slowest.size(), 2u);
+    BOOST_CHECK_EQUAL(slowest[0].command, "slow");
+    BOOST_CHECK_EQUAL(slowest[1].command, "medium");
+    BOOST_CHECK_EQUAL(log.Slowest(100).size(), 5u);
+
+    const auto failures = log.Failures();
+    BOOST_REQUIRE_EQUAL(failures.size(), 1u);
+    BOOST_CHECK_EQUAL(failures[0].command, "bad");
+
+    const auto since = log.Since(At(200));
+    BOOST_REQUIRE_EQUAL(since.size(), 3u);
+    BOOST_CHECK_EQUAL(since[0].command, "slow");
+    BOOST_CHECK(log.Since(At(500)).empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,123 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#include <boost/test/unit_test.hpp>
+#include "cli/fileauditsink.h"
+#include <algorithm>
+#include <cstdio>
+
+using namespace cli;
+
+namespace
+{
+
+std::vector<std::string> ReadLines(const std::string& fileName)
+{
+    std::vector<std::string> lines;
+    std::ifstream in(fileName);
+    std::string line;
+    while (std::getline(in, line))
+        lines.push_back(line);
+    return lines;
+}
+
+AuditRecord MakeRecord(std::size_t session, const std::string& cmd)
+{
+    AuditRecord r;
+    r.time = std::chrono::system_clock::now();
+    r.sessionId = session;
+    r.peer = "127.0.0.1:1234";
+    r.menuPath = "/sub";
+    r.command = cmd;
+    r.executed = true;
+    r.duration = std::chrono::microseconds(42);
+    return r;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(FileAuditSinkSuite)
+
+BOOST_AUTO_TEST_CASE(Basics)
+{
+    const std::string fileName = "cli_test_audit";
+    std::remove(fileName.c_str());
+    {
+        FileAuditSink sink(fileName);
+        sink.Store(MakeRecord(1, "foo 42"));
+        sink.Store(MakeRecord(2, "bar\t'a b'"));
+        sink.Flush();
+
+        auto lines = ReadLines(fileName);
+        BOOST_REQUIRE_EQUAL(lines.size(), 2);
+        BOOST_CHECK(lines[0].find("\t1\t127.0.0.1:1234\t/sub\tok\t42\tfoo 42") != std::string::npos);
+        BOOST_CHECK(lines[1].find("\t2\t127.0.0.1:1234\t/sub\tok\t42\tbar 'a b'") != std::string::npos);
+
+        auto failed = MakeRecord(3, "baz");
+        failed.status = 2;
+        sink.Store(failed);
+        auto missing = MakeRecord(4, "nothere");
+        missing.executed = false;
+        missing.status = 127;
+        sink.Store(missing);
+        sink.Flush();
+        lines = ReadLines(fileName);
+        BOOST_REQUIRE_EQUAL(lines.size(), 4);
+        BOOST_CHECK(lines[2].find("\t/sub\tfailed_2\t42\tbaz") != std::string::npos);
+        BOOST_CHECK(lines[3].find("\t/sub\tnot_found\t42\tnothere") != std::string::npos);
+
+        sink.Store(MakeRecord(5, "last"));
+    }
+    // the destructor writes the pending records
+    auto lines = ReadLines(fileName);
+    BOOST_REQUIRE_EQUAL(lines.size(), 5);
+    BOOST_CHECK(lines[4].find("\t5\t") != std::string::npos);
+    std::remove(fileName.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(BoundedQueue)
+{
+    const std::string fileName = "cli_test_audit";
+    std::remove(fileName.c_str());
+    {
+        // long flush interval: the writer wakes up when half the queue is used
+        FileAuditSink sink(fileName, 4, std::chrono::hours(1));
+        for (std::size_t i = 0; i < 1000; ++i)
+            sink.Store(MakeRecord(i, "cmd"));
+        sink.Flush();
+        const auto lines = ReadLines(fileName);
+        const auto records = std::count_if(lines.begin(), lines.end(), [](const std::string& l){ return l[0] != '#'; });
+        BOOST_CHECK_EQUAL(static_cast<std::size_t>(records) + sink.Dropped(), 1000);
+        if (sink.Dropped() > 0)
+            BOOST_CHECK(std::any_of(lines.begin(), lines.end(), [](const std::string& l){ return l.find("records dropped") != std::string::npos; }));
+    }
+    std::remove(fileName.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
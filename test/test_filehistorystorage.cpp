@@ -83,4 +83,32 @@ BOOST_AUTO_TEST_CASE(Persistence)
     BOOST_CHECK(s2.Commands().empty()); // check clear
 }
 
+BOOST_AUTO_TEST_CASE(Entries)
+{
+    FileHistoryStorage s("cli_test_history", 10);
+    s.Clear(); // in case the test runs multiple times
+
+    HistoryEntry e;
+    e.command = "show all";
+    e.time = std::chrono::system_clock::time_point(std::chrono::milliseconds(1600000000123));
+    e.duration = std::chrono::microseconds(4567);
+    e.outputSize = 89;
+    e.success = false;
+    s.StoreEntries({}, {e});
+    s.Store({"plain"});
+
+    FileHistoryStorage s2("cli_test_history", 10);
+    const auto result = s2.EntriesFor({});
+    BOOST_REQUIRE_EQUAL(result.size(), 2u);
+    BOOST_CHECK_EQUAL(result[0].command, "show all");
+    BOOST_CHECK(result[0].time == e.time);
+    BOOST_CHECK(result[0].duration == e.duration);
+    BOOST_CHECK_EQUAL(result[0].outputSize, 89u);
+    BOOST_CHECK(!result[0].success);
+    BOOST_CHECK_EQUAL(result[1].command, "plain");
+    BOOST_CHECK(result[1].success);
+    BOOST_CHECK(s2.Commands() == (std::vector<std::string>{"show all", "plain"}));
+    s2.Clear();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
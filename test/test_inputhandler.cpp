@@ -0,0 +1,244 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#include <boost/test/unit_test.hpp>
+#include "cli/detail/inputhandler.h"
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+using namespace std;
+using namespace cli;
+using namespace cli::detail;
+
+namespace
+{
+
+class FakeDevice : public InputDevice
+{
+public:
+    explicit FakeDevice(asio::BoostExecutor::ContextType& ios) : InputDevice(asio::BoostExecutor(ios)) {}
+    void Type(const string& s)
+    {
+        for (char c: s)
+            Notify(make_pair(KeyType::ascii, c));
+    }
+    void Tab() { Notify(make_pair(KeyType::ascii, '\t')); }
+    void Enter() { Notify(make_pair(KeyType::ret, ' ')); }
+    void Paste(const string& s) { NotifyPaste(s); }
+};
+
+// answers from another thread after the given delay
+class SlowProvider : public CompletionProvider
+{
+public:
+    SlowProvider(vector<string> _all, chrono::milliseconds _delay) : all(move(_all)), delay(_delay) {}
+    ~SlowProvider() override { for (auto& t: threads) t.join(); }
+    void Complete(const string& params, Callback cb) override
+    {
+        ++calls;
+        vector<string> result;
+        for (const auto& c: all)
+            if (c.rfind(params, 0) == 0) result.push_back(c);
+        threads.emplace_back([=](){ this_thread::sleep_for(delay); cb(result, true); });
+    }
+    int calls = 0;
+private:
+    const vector<string> all;
+    const chrono::milliseconds delay;
+    vector<thread> threads;
+};
+
+// sends the first result immediately, then nothing
+class PartialProvider : public CompletionProvider
+{
+public:
+    void Complete(const string&, Callback cb) override { cb({"10.0.0.1"}, false); }
+};
+
+// runs the loop for the whole duration, even when it has nothing to do
+void Run(boost::asio::io_context& ios, chrono::milliseconds d)
+{
+    auto work = boost::asio::make_work_guard(ios);
+    ios.restart();
+    ios.run_for(d);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(InputHandlerSuite)
+
+BOOST_AUTO_TEST_CASE(AsyncCompletion)
+{
+    boost::asio::io_context ios;
+    auto rootMenu = make_unique<Menu>("cli");
+    auto ping = rootMenu->Insert("ping", [](ostream&, const string&){});
+    auto provider = make_shared<SlowProvider>(vector<string>{"10.0.0.1", "10.0.0.2", "192.168.1.1"}, chrono::milliseconds(20));
+    ping.SetCompletionProvider(provider);
+    Cli cli(move(rootMenu));
+
+    stringstream oss;
+    CliSession session(cli, oss);
+    session.CompletionDeadline(chrono::milliseconds(500));
+    FakeDevice device(ios);
+    InputHandler handler(session, device);
+
+    // the final results arrive before the deadline
+    device.Type("ping 19");
+    device.Tab();
+    Run(ios, chrono::milliseconds(200));
+    BOOST_CHECK_EQUAL(provider->calls, 1);
+    BOOST_CHECK(oss.str().find("ping 192.168.1.1 ") != string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(Deadline)
+{
+    boost::asio::io_context ios;
+    auto rootMenu = make_unique<Menu>("cli");
+    auto subMenu = make_unique<Menu>("sub");
+    auto ping = subMenu->Insert("ping", [](ostream&, const string&){});
+    rootMenu->Insert(move(subMenu));
+    auto provider = make_shared<SlowProvider>(vector<string>{"10.0.0.1", "192.168.1.1"}, chrono::milliseconds(100));
+    ping.SetCompletionProvider(provider);
+    Cli cli(move(rootMenu));
+
+    stringstream oss;
+    CliSession session(cli, oss);
+    session.CompletionDeadline(chrono::milliseconds(10));
+    FakeDevice device(ios);
+    InputHandler handler(session, device);
+
+    // the deadline passes without results: nothing is shown
+    device.Type("sub ping 10");
+    device.Tab();
+    Run(ios, chrono::milliseconds(300));
+    BOOST_CHECK(oss.str().find("10.0.0.1") == string::npos);
+
+    // the next time the cached results are used
+    device.Tab();
+    Run(ios, chrono::milliseconds(50));
+    BOOST_CHECK(oss.str().find("sub ping 10.0.0.1 ") != string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(PartialResults)
+{
+    boost::asio::io_context ios;
+    auto rootMenu = make_unique<Menu>("cli");
+    auto ping = rootMenu->Insert("ping", [](ostream&, const string&){});
+    ping.SetCompletionProvider(make_shared<PartialProvider>());
+    Cli cli(move(rootMenu));
+
+    stringstream oss;
+    CliSession session(cli, oss);
+    session.CompletionDeadline(chrono::milliseconds(10));
+    FakeDevice device(ios);
+    InputHandler handler(session, device);
+
+    device.Type("ping ");
+    device.Tab();
+    Run(ios, chrono::milliseconds(100));
+    BOOST_CHECK(oss.str().find("ping 10.0.0.1 ") != string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(Paste)
+{
+    boost::asio::io_context ios;
+    auto rootMenu = make_unique<Menu>("cli");
+    vector<string> received;
+    rootMenu->Insert("echo", [&](ostream&, const string& arg){ received.push_back(arg); }, "", {"arg"});
+    Cli cli(move(rootMenu));
+
+    stringstream oss;
+    CliSession session(cli, oss);
+    FakeDevice device(ios);
+    InputHandler handler(session, device);
+
+    // every complete line is executed (the tab is not a completion request),
+    // and the last one remains in the line after a single prompt
+    device.Type("ec");
+    device.Paste("ho\tone\r\necho two\necho thr");
+    Run(ios, chrono::milliseconds(50));
+    const vector<string> expected{"one", "two"};
+    BOOST_CHECK_EQUAL_COLLECTIONS(received.begin(), received.end(), expected.begin(), expected.end());
+    const string out = oss.str();
+    BOOST_CHECK(out.find("cli> echo thr") != string::npos);
+    BOOST_CHECK_EQUAL(out.find("cli>"), out.rfind("cli>"));
+
+    device.Type("ee");
+    device.Enter();
+    Run(ios, chrono::milliseconds(50));
+    BOOST_CHECK_EQUAL(received.back(), "three");
+}
+
+BOOST_AUTO_TEST_CASE(PasteExit)
+{
+    boost::asio::io_context ios;
+    auto rootMenu = make_unique<Menu>("cli");
+    vector<string> received;
+    rootMenu->Insert("echo", [&](ostream&, const string& arg){ received.push_back(arg); }, "", {"arg"});
+    Cli cli(move(rootMenu));
+
+    stringstream oss;
+    CliSession session(cli, oss);
+    int exits = 0;
+    session.ExitAction([&exits](ostream&){ ++exits; });
+    FakeDevice device(ios);
+    InputHandler handler(session, device);
+
+    // the lines after "exit" are not executed, and no prompt is shown
+    device.Paste("echo one\nexit\necho two\necho thr");
+    Run(ios, chrono::milliseconds(50));
+    BOOST_CHECK(received == vector<string>{"one"});
+    BOOST_CHECK_EQUAL(exits, 1);
+    BOOST_CHECK(session.Exited());
+    BOOST_CHECK(oss.str().find("cli>") == string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(CompletionColumns)
+{
+    boost::asio::io_context ios;
+    auto rootMenu = make_unique<Menu>("cli");
+    for (const auto& name: {"show", "shape", "shift", "shutdown", "shell"})
+        rootMenu->Insert(name, [](ostream&){});
+    Cli cli(move(rootMenu));
+
+    stringstream oss;
+    CliSession session(cli, oss);
+    session.TerminalSize(25, 24);
+    FakeDevice device(ios);
+    InputHandler handler(session, device);
+
+    // the completions are laid out in columns that fit the terminal width
+    device.Type("sh");
+    device.Tab();
+    Run(ios, chrono::milliseconds(50));
+    BOOST_CHECK(oss.str().find("\nshape     show\nshell     shutdown\nshift\n") != string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
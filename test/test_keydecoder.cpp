@@ -0,0 +1,185 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#include <boost/test/unit_test.hpp>
+#include "cli/detail/keydecoder.h"
+
+using namespace std;
+using namespace cli::detail;
+
+namespace
+{
+
+vector<KeyDecoder::Key> Decode(KeyDecoder& decoder, const string& input)
+{
+    vector<KeyDecoder::Key> keys;
+    decoder.Decode(input, [&](const KeyDecoder::Key& k){ keys.push_back(k); });
+    return keys;
+}
+
+vector<KeyType> Types(const vector<KeyDecoder::Key>& keys)
+{
+    vector<KeyType> types;
+    for (const auto& k: keys)
+        types.push_back(k.first);
+    return types;
+}
+
+} // namespace
+
+BOOST_TEST_DONT_PRINT_LOG_VALUE(KeyType)
+
+BOOST_AUTO_TEST_SUITE(KeyDecoderSuite)
+
+BOOST_AUTO_TEST_CASE(Ascii)
+{
+    KeyDecoder decoder;
+    const auto keys = Decode(decoder, "ab 1");
+    BOOST_REQUIRE_EQUAL(keys.size(), 4u);
+    for (const auto& k: keys)
+        BOOST_CHECK(k.first == KeyType::ascii);
+    BOOST_CHECK_EQUAL(keys[0].second, 'a');
+    BOOST_CHECK_EQUAL(keys[2].second, ' ');
+}
+
+BOOST_AUTO_TEST_CASE(ControlKeys)
+{
+    KeyDecoder decoder;
+    const vector<KeyType> expected{KeyType::backspace, KeyType::backspace, KeyType::eof};
+    const auto types = Types(Decode(decoder, "\x7F\x08\x04"));
+    BOOST_CHECK_EQUAL_COLLECTIONS(types.begin(), types.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(Enter)
+{
+    // LF (local terminal), CR NUL and CR LF (telnet), CR alone
+    KeyDecoder decoder;
+    const vector<KeyType> expected{KeyType::ret, KeyType::ret, KeyType::ret, KeyType::ret, KeyType::ascii};
+    const auto types = Types(Decode(decoder, string("\n\r\0\r\n\ra", 7)));
+    BOOST_CHECK_EQUAL_COLLECTIONS(types.begin(), types.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(EscapeSequences)
+{
+    KeyDecoder decoder;
+    const vector<KeyType> expected{
+        KeyType::up, KeyType::down, KeyType::right, KeyType::left,
+        KeyType::up, KeyType::left, // application mode
+        KeyType::home, KeyType::end, KeyType::home, KeyType::end, KeyType::home, KeyType::end,
+        KeyType::canc,
+        KeyType::right, KeyType::canc // with modifiers
+    };
+    const auto types = Types(Decode(decoder,
+        "\x1B[A\x1B[B\x1B[C\x1B[D"
+        "\x1BOA\x1BOD"
+        "\x1B[H\x1B[F\x1BOH\x1BOF\x1B[1~\x1B[4~"
+        "\x1B[3~"
+        "\x1B[1;5C\x1B[3;2~"
+    ));
+    BOOST_CHECK_EQUAL_COLLECTIONS(types.begin(), types.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(SplitSequence)
+{
+    // a sequence can arrive in more bursts
+    KeyDecoder decoder;
+    BOOST_CHECK(Decode(decoder, "\x1B").empty());
+    BOOST_CHECK(decoder.Pending());
+    BOOST_CHECK(Decode(decoder, "[3").empty());
+    const auto types = Types(Decode(decoder, "~x"));
+    const vector<KeyType> expected{KeyType::canc, KeyType::ascii};
+    BOOST_CHECK_EQUAL_COLLECTIONS(types.begin(), types.end(), expected.begin(), expected.end());
+    BOOST_CHECK(!decoder.Pending());
+}
+
+BOOST_AUTO_TEST_CASE(UnknownSequences)
+{
+    KeyDecoder decoder;
+    // function keys, unknown CSI sequences (skipped up to the final byte)
+    // and ESC followed by a character produce a single ignored key each
+    const vector<KeyType> expected{
+        KeyType::ignored, KeyType::ascii,
+        KeyType::ignored, KeyType::ascii,
+        KeyType::ignored, KeyType::ascii,
+        KeyType::ignored, KeyType::ascii,
+        KeyType::ignored, KeyType::up
+    };
+    const auto keys = Decode(decoder, "\x1B[15~a\x1B[99;42Zb\x1Bxc\x1BOzd\x1B\x1B[A");
+    const auto types = Types(keys);
+    BOOST_CHECK_EQUAL_COLLECTIONS(types.begin(), types.end(), expected.begin(), expected.end());
+    BOOST_CHECK_EQUAL(keys[1].second, 'a');
+    BOOST_CHECK_EQUAL(keys[3].second, 'b');
+    BOOST_CHECK_EQUAL(keys[5].second, 'c');
+    BOOST_CHECK_EQUAL(keys[7].second, 'd');
+}
+
+BOOST_AUTO_TEST_CASE(BracketedPaste)
+{
+    KeyDecoder decoder;
+    vector<KeyDecoder::Key> keys;
+    vector<string> pasted;
+    auto key = [&](const KeyDecoder::Key& k){ keys.push_back(k); };
+    auto paste = [&](string text){ pasted.push_back(move(text)); };
+
+    // the pasted text (with its sequences) is passed as a whole,
+    // even when the end marker is split across bursts
+    decoder.Decode(string("a\x1B[200~x\ty\r\n\x1B[Az\x1B[20"), key, paste);
+    BOOST_CHECK(decoder.Pending());
+    BOOST_CHECK(pasted.empty());
+    decoder.Decode(string("1~b"), key, paste);
+    BOOST_CHECK(!decoder.Pending());
+    BOOST_REQUIRE_EQUAL(pasted.size(), 1u);
+    BOOST_CHECK_EQUAL(pasted[0], "x\ty\r\n\x1B[Az");
+    BOOST_REQUIRE_EQUAL(keys.size(), 2u);
+    BOOST_CHECK_EQUAL(keys[0].second, 'a');
+    BOOST_CHECK_EQUAL(keys[1].second, 'b');
+
+    // a long text is passed in parts of bounded size
+    pasted.clear();
+    string text(200000, 'x');
+    text[65535] = '\r';
+    text[65536] = '\n';
+    decoder.Decode("\x1B[200~" + text + "\x1B[201~", key, paste);
+    BOOST_REQUIRE(pasted.size() > 1u);
+    string joined;
+    for (const auto& p: pasted)
+    {
+        BOOST_CHECK(p.size() <= 64u * 1024u);
+        joined += p;
+    }
+    BOOST_CHECK(joined == text);
+    BOOST_CHECK_EQUAL(pasted[1].substr(0, 2), "\r\n"); // CR LF in the same part
+
+    // without a paste callback, the text is decoded as typed
+    const auto types = Types(Decode(decoder, "\x1B[200~x\x1B[A\x1B[201~"));
+    const vector<KeyType> expected{KeyType::ascii, KeyType::up};
+    BOOST_CHECK_EQUAL_COLLECTIONS(types.begin(), types.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
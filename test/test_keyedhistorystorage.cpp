@@ -0,0 +1,179 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#include <boost/test/unit_test.hpp>
+#include <fstream>
+#include "cli/keyedhistorystorage.h"
+
+using namespace cli;
+using namespace std;
+
+namespace
+{
+const char* fileName = "cli_test_keyed_history";
+
+size_t FileSize()
+{
+    ifstream f(fileName, ios_base::binary | ios_base::ate);
+    return static_cast<size_t>(f.tellg());
+}
+}
+
+BOOST_AUTO_TEST_SUITE(KeyedHistoryStorageSuite)
+
+BOOST_AUTO_TEST_CASE(Keys)
+{
+    KeyedHistoryStorage s(fileName, 4);
+    s.Clear(); // in case the test runs multiple times
+
+    BOOST_CHECK(s.CommandsFor("alice").empty());
+    s.StoreFor("alice", {"a1", "a2", "a3"});
+    s.StoreFor("bob", {"b1"});
+    s.Store({"anonymous"});
+    s.StoreFor("alice", {"a4", "a5"});
+
+    const vector<string> alice = {"a2", "a3", "a4", "a5"};
+    auto result = s.CommandsFor("alice");
+    BOOST_CHECK_EQUAL_COLLECTIONS(alice.begin(), alice.end(), result.begin(), result.end());
+    BOOST_CHECK(s.CommandsFor("bob") == vector<string>{"b1"});
+    BOOST_CHECK(s.Commands() == vector<string>{"anonymous"});
+    BOOST_CHECK(s.CommandsFor("") == vector<string>{"anonymous"});
+    BOOST_CHECK_EQUAL(s.Keys(), 3u);
+
+    // another object, same file => same histories
+    KeyedHistoryStorage s2(fileName, 4);
+    result = s2.CommandsFor("alice");
+    BOOST_CHECK_EQUAL_COLLECTIONS(alice.begin(), alice.end(), result.begin(), result.end());
+    BOOST_CHECK(s2.CommandsFor("bob") == vector<string>{"b1"});
+
+    s2.Clear();
+    BOOST_CHECK(s2.CommandsFor("alice").empty());
+    BOOST_CHECK_EQUAL(s2.Keys(), 0u);
+    BOOST_CHECK_EQUAL(FileSize(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(Eviction)
+{
+    KeyedHistoryStorage s(fileName, 10, 2);
+    s.Clear();
+    for (int i = 0; i < 10; ++i)
+        s.StoreFor("user" + to_string(i), {"cmd" + to_string(i)});
+    // only the last keys used stay in memory
+    BOOST_CHECK_EQUAL(s.CachedKeys(), 2u);
+    BOOST_CHECK_EQUAL(s.Keys(), 10u);
+    // the others are loaded again from the file
+    for (int i = 0; i < 10; ++i)
+        BOOST_CHECK(s.CommandsFor("user" + to_string(i)) == vector<string>{"cmd" + to_string(i)});
+    BOOST_CHECK_EQUAL(s.CachedKeys(), 2u);
+    s.Clear();
+}
+
+BOOST_AUTO_TEST_CASE(Compaction)
+{
+    KeyedHistoryStorage s(fileName, 10);
+    s.Clear();
+    const string command(100, 'x');
+    for (int i = 0; i < 2000; ++i)
+        s.StoreFor("user" + to_string(i % 3), {command});
+    // the file keeps mainly the current records
+    BOOST_CHECK(FileSize() < 128 * 1024);
+    BOOST_CHECK_EQUAL(s.CommandsFor("user0").size(), 10u);
+
+    KeyedHistoryStorage s2(fileName, 10);
+    BOOST_CHECK_EQUAL(s2.Keys(), 3u);
+    BOOST_CHECK(s2.CommandsFor("user2") == vector<string>(10, command));
+    s2.Clear();
+}
+
+BOOST_AUTO_TEST_CASE(AppendedCommands)
+{
+    KeyedHistoryStorage s(fileName, 100);
+    s.Clear();
+    for (int i = 0; i < 50; ++i)
+        s.StoreFor("alice", {"a" + to_string(i)});
+    const auto size = FileSize();
+    s.StoreFor("alice", {"new"});
+    // just the new command is written
+    BOOST_CHECK(FileSize() - size < 20);
+
+    KeyedHistoryStorage s2(fileName, 10);
+    vector<string> expected;
+    for (int i = 41; i < 50; ++i)
+        expected.push_back("a" + to_string(i));
+    expected.push_back("new");
+    BOOST_CHECK(s2.CommandsFor("alice") == expected);
+    s2.Clear();
+}
+
+BOOST_AUTO_TEST_CASE(IncompleteRecord)
+{
+    {
+        KeyedHistoryStorage s(fileName, 10);
+        s.Clear();
+        s.StoreFor("alice", {"a1"});
+        s.StoreFor("bob", {"b1"});
+    }
+    {
+        // e.g., a write interrupted
+        ofstream f(fileName, ios_base::app | ios_base::binary);
+        f << "5 100\nalice\nshort";
+    }
+    KeyedHistoryStorage s(fileName, 10);
+    BOOST_CHECK_EQUAL(s.Keys(), 2u);
+    BOOST_CHECK(s.CommandsFor("alice") == vector<string>{"a1"});
+    s.StoreFor("bob", {"b2"});
+    KeyedHistoryStorage s2(fileName, 10);
+    BOOST_CHECK(s2.CommandsFor("bob") == (vector<string>{"b1", "b2"}));
+    s2.Clear();
+}
+
+BOOST_AUTO_TEST_CASE(Entries)
+{
+    {
+        KeyedHistoryStorage s(fileName, 10);
+        s.Clear();
+        HistoryEntry e;
+        e.command = "slow";
+        e.time = chrono::system_clock::time_point(chrono::milliseconds(1600000000000));
+        e.duration = chrono::microseconds(2000000);
+        e.outputSize = 12;
+        s.StoreEntries("alice", {e});
+        s.StoreFor("alice", {"plain"});
+    }
+    KeyedHistoryStorage s(fileName, 10);
+    const auto result = s.EntriesFor("alice");
+    BOOST_REQUIRE_EQUAL(result.size(), 2u);
+    BOOST_CHECK(result[0].duration == chrono::microseconds(2000000));
+    BOOST_CHECK_EQUAL(result[0].outputSize, 12u);
+    BOOST_CHECK(result[1].time.time_since_epoch().count() == 0);
+    BOOST_CHECK(s.CommandsFor("alice") == (vector<string>{"slow", "plain"}));
+    s.Clear();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,85 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+#include "cli/detail/lagmonitor.h"
+
+using namespace std;
+using namespace cli::detail;
+
+BOOST_AUTO_TEST_SUITE(LagMonitorSuite)
+
+BOOST_AUTO_TEST_CASE(BlockingHandler)
+{
+    asio::BoostExecutor::ContextType ios;
+    LagMonitor monitor(ios);
+    vector<LagMonitor::Duration> lags;
+    monitor.OnLag([&lags](LagMonitor::Duration lag){ lags.push_back(lag); });
+    monitor.Start(chrono::milliseconds(20), chrono::milliseconds(5));
+    BOOST_CHECK(!monitor.Overloaded());
+
+    asio::BoostExecutor executor(ios);
+    bool overloaded = false;
+    bool recovered = false;
+    // a handler blocks the io context, then the lag is checked and the
+    // io context is left idle until it's back to normal
+    // (after 10 samples under half the threshold: checked for up to 2 seconds,
+    // since a loaded machine can delay the samples)
+    int checks = 0;
+    function<void()> checkRecovered = [&]()
+    {
+        recovered = !monitor.Overloaded();
+        if (recovered || ++checks == 100)
+            monitor.Stop();
+        else
+            executor.PostAfter(chrono::milliseconds(20), checkRecovered);
+    };
+    executor.PostAfter(chrono::milliseconds(10), [&]()
+    {
+        this_thread::sleep_for(chrono::milliseconds(60));
+        executor.PostAfter(chrono::milliseconds(10), [&]()
+        {
+            overloaded = monitor.Overloaded();
+            executor.PostAfter(chrono::milliseconds(100), checkRecovered);
+        });
+    });
+    ios.run();
+
+    BOOST_CHECK(overloaded);
+    BOOST_REQUIRE(!lags.empty());
+    BOOST_CHECK(lags.front() >= chrono::milliseconds(30));
+    BOOST_CHECK(monitor.MaxLag() >= chrono::milliseconds(30));
+    BOOST_CHECK(recovered);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
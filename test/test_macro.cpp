@@ -0,0 +1,121 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#include <boost/test/unit_test.hpp>
+#include "cli/detail/macro.h"
+#include "cli/detail/split.h"
+
+using namespace cli;
+using namespace cli::detail;
+using namespace std;
+
+namespace
+{
+Macro Make(const string& definition)
+{
+    vector<string> tokens;
+    split(tokens, definition);
+    return Macro(tokens);
+}
+
+vector<string> Expand(const Macro& m, size_t i, const vector<string>& args)
+{
+    vector<string> tokens;
+    const auto& argTokens = ToTokens(args);
+    m.Expand(i, CmdLine(argTokens), tokens);
+    return tokens;
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(MacroSuite)
+
+BOOST_AUTO_TEST_CASE(WithoutParameters)
+{
+    const auto m = Make("show interfaces");
+    BOOST_CHECK_EQUAL(m.Size(), 1u);
+    BOOST_CHECK_EQUAL(m.Parameters(), 0u);
+    BOOST_CHECK(Expand(m, 0, {}) == (vector<string>{"show", "interfaces"}));
+    // the arguments go to the last command
+    BOOST_CHECK(Expand(m, 0, {"eth0", "brief"}) == (vector<string>{"show", "interfaces", "eth0", "brief"}));
+
+    BOOST_CHECK(Make("").Empty());
+    BOOST_CHECK(Make(" ; ; ").Empty());
+}
+
+BOOST_AUTO_TEST_CASE(Commands)
+{
+    const auto m = Make("; interface $1 ; ; no shutdown ; exit ;");
+    BOOST_REQUIRE_EQUAL(m.Size(), 3u);
+    BOOST_CHECK_EQUAL(m.Parameters(), 1u);
+    BOOST_CHECK(Expand(m, 0, {"eth0"}) == (vector<string>{"interface", "eth0"}));
+    BOOST_CHECK(Expand(m, 1, {"eth0"}) == (vector<string>{"no", "shutdown"}));
+    BOOST_CHECK(Expand(m, 2, {"eth0"}) == (vector<string>{"exit"}));
+}
+
+BOOST_AUTO_TEST_CASE(Parameters)
+{
+    const auto m = Make("set vlan$2 \"name $1\" $1 $ $x 10$ $12");
+    BOOST_CHECK_EQUAL(m.Parameters(), 12u);
+    vector<string> args(12, "-");
+    args[0] = "a b";
+    args[1] = "42";
+    args[11] = "last";
+    BOOST_CHECK(Expand(m, 0, args) == (vector<string>{"set", "vlan42", "name a b", "a b", "$", "$x", "10$", "last"}));
+
+    const auto all = Make("echo [ $* ]");
+    BOOST_CHECK_EQUAL(all.Parameters(), 0u);
+    BOOST_CHECK(Expand(all, 0, {"x", "y"}) == (vector<string>{"echo", "[", "x", "y", "]"}));
+    BOOST_CHECK(Expand(all, 0, {}) == (vector<string>{"echo", "[", "]"}));
+}
+
+BOOST_AUTO_TEST_CASE(Definition)
+{
+    BOOST_CHECK_EQUAL(Make("a   'b c' ; d\\\"e").Definition(), "a \"b c\" ; \"d\\\"e\"");
+}
+
+BOOST_AUTO_TEST_CASE(Table)
+{
+    MacroTable table;
+    BOOST_CHECK(table.Empty());
+    BOOST_CHECK(!table.Find("x"));
+    table.Define("x", vector<string>{"show", "x"});
+    table.Define("a", vector<string>{"a"});
+    BOOST_REQUIRE(table.Find("x"));
+    BOOST_CHECK_EQUAL(table.Find("x")->Definition(), "show x");
+    const auto list = table.List();
+    BOOST_REQUIRE_EQUAL(list.size(), 2u);
+    BOOST_CHECK_EQUAL(list[0].first, "a");
+    table.Define("a", vector<string>{}); // removes
+    BOOST_CHECK(!table.Find("a"));
+    BOOST_CHECK(table.Remove("x"));
+    BOOST_CHECK(!table.Remove("x"));
+    BOOST_CHECK(table.Empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
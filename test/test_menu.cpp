@@ -29,6 +29,7 @@
 
 #include <boost/test/unit_test.hpp>
 #include "cli/cli.h"
+#include <sstream>
 
 using namespace std;
 using namespace cli;
@@ -121,4 +122,48 @@ BOOST_AUTO_TEST_CASE(Basics)
     BOOST_CHECK_EQUAL_COLLECTIONS(completions.begin(), completions.end(), expected.begin(), expected.end());
 }
 
+BOOST_AUTO_TEST_CASE(Path)
+{
+    Menu menu("menu");
+    auto subMenu = make_unique<Menu>("submenu");
+    auto subSubMenu = make_unique<Menu>("subsubmenu");
+    auto subSubMenuPtr = subSubMenu.get();
+    auto subMenuPtr = subMenu.get();
+    subMenu->Insert(move(subSubMenu));
+    menu.Insert(move(subMenu));
+
+    BOOST_CHECK_EQUAL(menu.Path(), "/");
+    BOOST_CHECK_EQUAL(subMenuPtr->Path(), "/submenu");
+    BOOST_CHECK_EQUAL(subSubMenuPtr->Path(), "/submenu/subsubmenu");
+}
+
+BOOST_AUTO_TEST_CASE(Symbols)
+{
+    Menu menu("menu");
+    menu.Insert("foo", [](ostream&){});
+    auto subMenu = make_unique<Menu>("submenu");
+    subMenu->Insert("foo", [](ostream&){});
+    subMenu->Insert("bar", [](ostream&){});
+    auto subMenuPtr = subMenu.get();
+    BOOST_CHECK(subMenuPtr->Symbols() != menu.Symbols());
+    menu.Insert(move(subMenu));
+
+    // the inserted menu uses the table of the parent, and the same name is stored once
+    BOOST_CHECK(subMenuPtr->Symbols() == menu.Symbols());
+    BOOST_CHECK_EQUAL(menu.Symbols()->Size(), 4u); // menu, foo, submenu, bar
+    BOOST_CHECK(menu.Symbols()->Find("bar") != noSymbol);
+
+    // the commands are found both with the symbols and without them
+    Cli cli(make_unique<Menu>("cli"));
+    stringstream oss;
+    CliSession session(cli, oss);
+    const vector<Token> cmdLine{"submenu", "bar"};
+    vector<SymbolId> symbols(cmdLine.size());
+    menu.Symbols()->Find(cmdLine.begin(), cmdLine.end(), symbols.begin());
+    BOOST_CHECK(menu.ScanCmds(CmdLine(cmdLine, symbols), session));
+    BOOST_CHECK(menu.ScanCmds(CmdLine(cmdLine), session));
+    symbols[1] = noSymbol;
+    BOOST_CHECK(!menu.ScanCmds(CmdLine(cmdLine, symbols), session));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
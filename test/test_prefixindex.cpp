@@ -0,0 +1,140 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#include <boost/test/unit_test.hpp>
+#include "cli/detail/prefixindex.h"
+
+using namespace std;
+using namespace cli::detail;
+
+namespace
+{
+
+using Index = PrefixIndex<int>;
+
+Index::Match Lookup(const Index& index, const string& prefix, bool ignoreCase = false)
+{
+    Index::Match m;
+    index.Find(prefix, ignoreCase, m);
+    return m;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(PrefixIndexSuite)
+
+BOOST_AUTO_TEST_CASE(Find)
+{
+    int value = 42;
+    Index index;
+    index.Insert("show");
+    index.Insert("shutdown");
+    index.Insert("interfaces", &value);
+    index.Insert("showall");
+
+    auto m = Lookup(index, "in");
+    BOOST_CHECK(m.Unique());
+    BOOST_CHECK(!m.exact);
+    BOOST_CHECK_EQUAL(m.name, "interfaces");
+    BOOST_CHECK_EQUAL(m.value, &value);
+
+    m = Lookup(index, "sh");
+    BOOST_CHECK(!m.Unique());
+    BOOST_CHECK_EQUAL(m.count, 3u);
+
+    m = Lookup(index, "shu");
+    BOOST_CHECK(m.Unique());
+    BOOST_CHECK_EQUAL(m.name, "shutdown");
+
+    // an exact name wins over the longer ones
+    m = Lookup(index, "show");
+    BOOST_CHECK(m.exact);
+    BOOST_CHECK_EQUAL(m.name, "show");
+
+    m = Lookup(index, "showa");
+    BOOST_CHECK_EQUAL(m.name, "showall");
+
+    m = Lookup(index, "foo");
+    BOOST_CHECK(!m.Unique());
+    BOOST_CHECK_EQUAL(m.count, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(IgnoreCase)
+{
+    Index index;
+    index.Insert("Show");
+    index.Insert("shutdown");
+
+    BOOST_CHECK_EQUAL(Lookup(index, "SHU", true).name, "shutdown");
+    BOOST_CHECK(!Lookup(index, "SHU").Unique());
+    BOOST_CHECK(!Lookup(index, "sh", true).Unique());
+    BOOST_CHECK(Lookup(index, "show", true).exact);
+    BOOST_CHECK_EQUAL(Lookup(index, "show", true).name, "Show");
+    BOOST_CHECK_EQUAL(Lookup(index, "Sh").name, "Show");
+}
+
+BOOST_AUTO_TEST_CASE(Remove)
+{
+    Index index;
+    index.Insert("show");
+    index.Insert("show"); // overloads
+    index.Insert("shutdown");
+
+    index.Remove("show");
+    BOOST_CHECK(Lookup(index, "show").exact);
+    BOOST_CHECK(!Lookup(index, "sh").Unique());
+
+    index.Remove("show");
+    BOOST_CHECK(!Lookup(index, "show").Unique());
+    BOOST_CHECK_EQUAL(Lookup(index, "sh").name, "shutdown");
+
+    index.Remove("foo"); // not present
+    BOOST_CHECK_EQUAL(Lookup(index, "s").name, "shutdown");
+}
+
+BOOST_AUTO_TEST_CASE(MoreIndexes)
+{
+    Index index1;
+    index1.Insert("help");
+    Index index2;
+    index2.Insert("help");
+    index2.Insert("reset");
+
+    // the same name in two indexes is not ambiguous
+    Index::Match m;
+    index1.Find("he", false, m);
+    index2.Find("he", false, m);
+    BOOST_CHECK(m.Unique());
+    BOOST_CHECK_EQUAL(m.name, "help");
+
+    m.Add("heap", nullptr, "he", false);
+    BOOST_CHECK(!m.Unique());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
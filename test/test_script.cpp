@@ -0,0 +1,211 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#include <boost/test/unit_test.hpp>
+#include "cli/detail/script.h"
+#include "cli/detail/split.h"
+
+using namespace cli;
+using namespace cli::detail;
+using namespace std;
+
+namespace
+{
+// adds the lines to the script, running the complete statements:
+// returns the commands executed (the ones starting with "fail" fail)
+string Run(Script& script, const vector<string>& lines)
+{
+    string result;
+    for (const auto& l: lines)
+    {
+        vector<string> tokens;
+        split(tokens, l);
+        switch (script.Add(tokens))
+        {
+            case Script::Line::command:
+                result += l + '|';
+                break;
+            case Script::Line::complete:
+                script.Run([&](vector<cli::detail::Token>& cmd, const vector<size_t>&)
+                {
+                    for (const auto& t: cmd) result += t + (&t == &cmd.back() ? "" : " ");
+                    result += '|';
+                    return cmd[0].find("fail") != 0;
+                });
+                break;
+            case Script::Line::error:
+                result += "error: " + script.Error() + '|';
+                break;
+            case Script::Line::incomplete:
+                break;
+        }
+    }
+    return result;
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(ScriptSuite)
+
+BOOST_AUTO_TEST_CASE(Token)
+{
+    ScriptToken plain("eth0");
+    BOOST_CHECK(!plain.HasVariables());
+    ScriptToken::Variables vars{{"a", "1"}, {"b_2", "x"}};
+    BOOST_CHECK_EQUAL(ScriptToken("$a-${b_2}z$b_2$c$1$ ${}").Eval(vars), "1-xzx$1$ ${}");
+    BOOST_CHECK(ScriptToken("$a").HasVariables());
+    BOOST_CHECK(!ScriptToken("$1").HasVariables());
+}
+
+BOOST_AUTO_TEST_CASE(Variables)
+{
+    Script script;
+    BOOST_CHECK_EQUAL(Run(script, {"show all", "name=eth0", "show $name", "x=a b", "echo \"[$x]\""}),
+                      "show all|show eth0|echo [a b]|");
+    BOOST_CHECK_EQUAL(script.Vars()["name"], "eth0");
+    // an undefined variable is empty (and removed, if it's the whole token)
+    BOOST_CHECK_EQUAL(Run(script, {"show $nothere x"}), "show x|");
+}
+
+BOOST_AUTO_TEST_CASE(Loops)
+{
+    Script script;
+    BOOST_CHECK_EQUAL(Run(script, {"for i in 1..3", "vlan add $i", "end"}), "vlan add 1|vlan add 2|vlan add 3|");
+    BOOST_CHECK_EQUAL(Run(script, {"n=-1", "for i in 1..$n", "x $i", "end"}), "x 1|x 0|x -1|");
+    BOOST_CHECK_EQUAL(Run(script, {"for if in eth0 eth1", "for i in 0..1", "set $if.$i", "end", "end"}),
+                      "set eth0.0|set eth0.1|set eth1.0|set eth1.1|");
+    BOOST_CHECK(script.Vars()["if"] == "eth1");
+}
+
+BOOST_AUTO_TEST_CASE(Conditions)
+{
+    Script script;
+    BOOST_CHECK_EQUAL(Run(script, {"if ping a", "yes", "else", "no", "end"}), "ping a|yes|");
+    BOOST_CHECK_EQUAL(Run(script, {"if failping a", "yes", "else", "no", "end"}), "failping a|no|");
+    BOOST_CHECK_EQUAL(Run(script, {"if ! failping a", "yes", "end"}), "failping a|yes|");
+    BOOST_CHECK_EQUAL(Run(script, {"for i in 1..3", "if fail$i", "x", "else", "ok $i", "end", "end"}),
+                      "fail1|ok 1|fail2|ok 2|fail3|ok 3|");
+}
+
+BOOST_AUTO_TEST_CASE(Errors)
+{
+    Script script;
+    BOOST_CHECK_EQUAL(Run(script, {"end"}), "error: end without for or if|");
+    BOOST_CHECK_EQUAL(Run(script, {"else"}), "error: else without if|");
+    BOOST_CHECK_EQUAL(Run(script, {"for i of 1..3"}), "error: usage: for <name> in <first>..<last> | <items>|");
+    BOOST_CHECK_EQUAL(Run(script, {"if"}), "error: usage: if [!] <command>|");
+    // a wrong line discards the block
+    BOOST_CHECK_EQUAL(Run(script, {"for i in 1..2", "x", "else", "y"}), "error: else without if|y|");
+    BOOST_CHECK(!script.Pending());
+    Run(script, {"for i in 1..2"});
+    BOOST_CHECK(script.Pending());
+    script.Discard();
+
+    // the ranges that overflow or too long
+    BOOST_CHECK_EQUAL(Run(script, {"for i in 1..99999999999999999999", "x $i", "end"}), "");
+    BOOST_CHECK(script.Error().find("for: the range") == 0);
+    BOOST_CHECK_EQUAL(Run(script, {"for i in -9223372036854775807..9223372036854775807", "x", "end"}), "");
+    BOOST_CHECK(!script.Error().empty());
+    BOOST_CHECK_EQUAL(Run(script, {"for i in 1..x", "x $i", "end"}), "x 1..x|");
+    BOOST_CHECK(script.Error().empty());
+}
+
+BOOST_AUTO_TEST_CASE(Status)
+{
+    Script script;
+    vector<string> tokens{"for", "i", "in", "1..2"};
+    script.Add(tokens);
+    tokens = {"fail$i"};
+    script.Add(tokens);
+    tokens = {"end"};
+    BOOST_CHECK(script.Add(tokens) == Script::Line::complete);
+    BOOST_CHECK(!script.Run([](vector<cli::detail::Token>& cmd, const vector<size_t>&){ return cmd[0] != "fail1"; }));
+    BOOST_CHECK(script.Run([](vector<cli::detail::Token>&, const vector<size_t>&){ return false; })); // nothing to run
+}
+
+BOOST_AUTO_TEST_CASE(Operators)
+{
+    Script script;
+    vector<string> tokens;
+    vector<size_t> operators;
+    split(tokens, operators, "for i in 1..2");
+    script.Add(tokens, operators);
+    split(tokens, operators, "if $i \"&&\" && $x || \"$i\"");
+    script.Add(tokens, operators);
+    split(tokens, operators, "end");
+    script.Add(tokens, operators);
+    split(tokens, operators, "end");
+    BOOST_CHECK(script.Add(tokens, operators) == Script::Line::complete);
+    vector<vector<size_t>> executed;
+    script.Run([&](vector<cli::detail::Token>& cmd, const vector<size_t>& ops)
+    {
+        BOOST_CHECK_EQUAL(cmd.size(), 5u); // $x is undefined
+        executed.push_back(ops);
+        return true;
+    });
+    BOOST_REQUIRE_EQUAL(executed.size(), 2u);
+    BOOST_CHECK(executed[0] == vector<size_t>({2, 3}));
+}
+
+BOOST_AUTO_TEST_CASE(Quoted)
+{
+    Script script;
+    script.Vars()["x"] = "1";
+    vector<string> tokens;
+    vector<size_t> operators;
+    vector<size_t> quoted;
+    const auto run = [&](const string& line)
+    {
+        split(tokens, operators, quoted, line);
+        string result;
+        if (script.Add(tokens, operators, quoted) == Script::Line::command)
+            return string("command");
+        script.Run([&](vector<cli::detail::Token>& cmd, const vector<size_t>&)
+        {
+            for (const auto& t: cmd) result += t + (&t == &cmd.back() ? "" : " ");
+            result += '|';
+            return true;
+        });
+        return result;
+    };
+
+    // the quoted tokens are not expanded
+    BOOST_CHECK_EQUAL(run(R"(echo $x '$x' "$x" "" ${x})"), "echo 1 $x $x 1|");
+    BOOST_CHECK(quoted == vector<size_t>({2, 3})); // the empty one is removed
+    // a line with just quoted variables is a plain command
+    BOOST_CHECK_EQUAL(run("echo '$x costs $5'"), "command");
+    BOOST_CHECK_EQUAL(tokens[1], "$x costs $5");
+    // in the assignments and in the items of the loops
+    run("y=$x '$x'");
+    BOOST_CHECK_EQUAL(script.Vars()["y"], "1 $x");
+    run("for i in '$x' $x");
+    run("echo $i");
+    BOOST_CHECK_EQUAL(run("end"), "echo $x|echo 1|");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
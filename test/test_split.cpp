@@ -29,6 +29,7 @@
 
 #include <boost/test/unit_test.hpp>
 #include "cli/detail/split.h"
+#include "cli/detail/commandmemory.h"
 
 using namespace std;
 using namespace cli;
@@ -241,4 +242,100 @@ BOOST_AUTO_TEST_CASE(EscapedCases)
     BOOST_CHECK_EQUAL(strs[0], R"(foo\"bar)");
 }
 
+BOOST_AUTO_TEST_CASE(Operators)
+{
+    VS strs;
+    vector<size_t> operators;
+
+    split(strs, operators, "a && b || c");
+    BOOST_CHECK(strs == VS({"a", "&&", "b", "||", "c"}));
+    BOOST_CHECK(operators == vector<size_t>({1, 3}));
+
+    // quoted or escaped, they're plain tokens
+    split(strs, operators, R"(echo a "&&" '||' \&& b&& "" ||)");
+    BOOST_CHECK(strs == VS({"echo", "a", "&&", "||", "\\&&", "b&&", "||"}));
+    BOOST_CHECK(operators == vector<size_t>({6})); // after the empty entry removed
+
+    split(strs, operators, "a b");
+    BOOST_CHECK(operators.empty());
+}
+
+BOOST_AUTO_TEST_CASE(CommandMemoryContainer)
+{
+    CommandMemory memory;
+    {
+        CommandMemory::Scope scope(memory);
+        auto strs = memory.MakeVector<string>();
+
+        split(strs, " first   \t\t 'foo \tbar'     \t last");
+        BOOST_CHECK_EQUAL(strs.size(), 3);
+        BOOST_CHECK_EQUAL(strs[0], "first");
+        BOOST_CHECK_EQUAL(strs[1], "foo \tbar");
+        BOOST_CHECK_EQUAL(strs[2], "last");
+
+        // a nested scope must not release the memory of the outer one
+        {
+            CommandMemory::Scope nested(memory);
+            auto others = memory.MakeVector<string>();
+            split(others, "a b c d e f g h");
+            BOOST_CHECK_EQUAL(others.size(), 8);
+        }
+        BOOST_CHECK_EQUAL(strs[0], "first");
+        BOOST_CHECK_EQUAL(strs[2], "last");
+    }
+}
+
+#ifdef CLI_HAS_PMR
+BOOST_AUTO_TEST_CASE(CommandMemoryNestedScopes)
+{
+    // a resource counting the bytes in use
+    struct Counting : pmr::memory_resource
+    {
+        size_t used = 0;
+        void* do_allocate(size_t bytes, size_t align) override
+        {
+            used += bytes;
+            return pmr::new_delete_resource()->allocate(bytes, align);
+        }
+        void do_deallocate(void* p, size_t bytes, size_t align) override
+        {
+            used -= bytes;
+            pmr::new_delete_resource()->deallocate(p, bytes, align);
+        }
+        bool do_is_equal(const pmr::memory_resource& other) const noexcept override { return this == &other; }
+    } counting;
+    auto previous = pmr::set_default_resource(&counting);
+
+    CommandMemory memory;
+    {
+        CommandMemory::Scope scope(memory);
+        auto strs = memory.MakeVector<string>();
+        split(strs, "for i in 1..100000");
+        // e.g. the iterations of a loop: the memory is released after each one
+        for (int i = 0; i < 1000; ++i)
+        {
+            CommandMemory::Scope nested(memory);
+            auto tokens = memory.MakeVector<string>();
+            tokens.resize(1000);
+        }
+        BOOST_CHECK_EQUAL(counting.used, 0u);
+        BOOST_CHECK_EQUAL(strs[3], "1..100000");
+    }
+    pmr::set_default_resource(previous);
+}
+
+BOOST_AUTO_TEST_CASE(CommandMemoryTokens)
+{
+    CommandMemory memory;
+    CommandMemory::Scope scope(memory);
+    auto strs = memory.MakeTokens();
+    split(strs, "show 'a token longer than the small string buffer'");
+    BOOST_REQUIRE_EQUAL(strs.size(), 2u);
+    BOOST_CHECK_EQUAL(strs[1], "a token longer than the small string buffer");
+    // the characters of the tokens are in the arena too
+    for (const auto& s: strs)
+        BOOST_CHECK(s.get_allocator().resource() == memory.Resource());
+}
+#endif
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
@@ -0,0 +1,125 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#include <boost/test/unit_test.hpp>
+#include "cli/detail/symboltable.h"
+#include <atomic>
+#include <thread>
+
+using namespace std;
+using namespace cli::detail;
+
+BOOST_AUTO_TEST_SUITE(SymbolTableSuite)
+
+BOOST_AUTO_TEST_CASE(Basics)
+{
+    SymbolTable table;
+    const auto foo = table.Intern("foo");
+    const auto bar = table.Intern("bar");
+    BOOST_CHECK(foo != noSymbol);
+    BOOST_CHECK(bar != noSymbol);
+    BOOST_CHECK(foo != bar);
+    BOOST_CHECK_EQUAL(table.Intern("foo"), foo);
+    BOOST_CHECK_EQUAL(table.Size(), 2u);
+
+    BOOST_CHECK_EQUAL(table.Find("foo"), foo);
+    BOOST_CHECK_EQUAL(table.Find("bar"), bar);
+    BOOST_CHECK_EQUAL(table.Find("foobar"), noSymbol);
+
+    // the lookup stops at the first parameter
+    const vector<string> tokens{"bar", "foo", "42", "foo"};
+    vector<SymbolId> ids(tokens.size());
+    table.Find(tokens.begin(), tokens.end(), ids.begin());
+    const vector<SymbolId> expected{bar, foo, noSymbol, noSymbol};
+    BOOST_CHECK_EQUAL_COLLECTIONS(ids.begin(), ids.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(Frozen)
+{
+    SymbolTable table;
+    const auto foo = table.Intern("foo");
+    table.Freeze();
+    BOOST_CHECK_EQUAL(table.Find("foo"), foo);
+    BOOST_CHECK_EQUAL(table.Find("bar"), noSymbol);
+
+    // the names added later are published
+    const auto bar = table.Intern("bar");
+    BOOST_CHECK_EQUAL(table.Find("bar"), bar);
+    BOOST_CHECK_EQUAL(table.Find("foo"), foo);
+    BOOST_CHECK_EQUAL(table.Intern("foo"), foo);
+    BOOST_CHECK_EQUAL(table.Size(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(Batch)
+{
+    SymbolTable table;
+    table.Freeze();
+    {
+        SymbolTable::Batch batch(table);
+        table.Intern("foo");
+        table.Intern("bar");
+        // published at the end of the batch
+        BOOST_CHECK_EQUAL(table.Find("foo"), noSymbol);
+    }
+    BOOST_CHECK(table.Find("foo") != noSymbol);
+    BOOST_CHECK(table.Find("bar") != noSymbol);
+    BOOST_CHECK_EQUAL(table.Snapshots(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(OldSnapshots)
+{
+    SymbolTable table;
+    table.Freeze();
+    for (int i = 0; i < 100; ++i)
+        table.Intern("cmd" + to_string(i));
+    BOOST_CHECK_EQUAL(table.Snapshots(), 1u);
+
+    // the lookups in progress keep the old snapshots until the next name
+    atomic<bool> stop{false};
+    atomic<bool> found{true};
+    thread reader([&]()
+    {
+        while (!stop)
+            if (table.Find("cmd0") == noSymbol)
+                found = false;
+    });
+    for (int i = 0; i < 1000; ++i)
+    {
+        const auto name = "new" + to_string(i);
+        const auto id = table.Intern(name);
+        BOOST_REQUIRE_EQUAL(table.Find(name), id);
+    }
+    stop = true;
+    reader.join();
+    BOOST_CHECK(found);
+    table.Intern("last");
+    BOOST_CHECK_EQUAL(table.Snapshots(), 1u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,101 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#include <boost/test/unit_test.hpp>
+#include <sstream>
+#include "cli/detail/terminal.h"
+
+using namespace std;
+using namespace cli::detail;
+
+namespace
+{
+
+// types the string and returns the output of the terminal
+string Type(Terminal& terminal, stringstream& oss, const string& input)
+{
+    oss.str("");
+    for (char c: input)
+        terminal.Keypressed(make_pair(KeyType::ascii, c));
+    return oss.str();
+}
+
+string Press(Terminal& terminal, stringstream& oss, KeyType key, size_t times = 1)
+{
+    oss.str("");
+    for (size_t i = 0; i < times; ++i)
+        terminal.Keypressed(make_pair(key, ' '));
+    return oss.str();
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(TerminalSuite)
+
+BOOST_AUTO_TEST_CASE(UnknownWidth)
+{
+    // without the width, the cursor goes back with backspaces
+    stringstream oss;
+    Terminal terminal(oss);
+    Type(terminal, oss, "abcdef");
+    BOOST_CHECK_EQUAL(Press(terminal, oss, KeyType::home), "\b\b\b\b\b\b");
+    BOOST_CHECK_EQUAL(Type(terminal, oss, "x"), "xabcdef\b\b\b\b\b\b");
+    BOOST_CHECK_EQUAL(terminal.GetLine(), "xabcdef");
+}
+
+BOOST_AUTO_TEST_CASE(ShortestMoves)
+{
+    stringstream oss;
+    Terminal terminal(oss);
+    terminal.Layout(80, 5);
+    Type(terminal, oss, string(40, 'a'));
+    // a few columns: backspaces, more columns: a single sequence
+    BOOST_CHECK_EQUAL(Press(terminal, oss, KeyType::left, 2), "\b\b");
+    BOOST_CHECK_EQUAL(Press(terminal, oss, KeyType::home), "\x1B[38D");
+    BOOST_CHECK_EQUAL(Type(terminal, oss, "b"), "b" + string(40, 'a') + "\x1B[40D");
+}
+
+BOOST_AUTO_TEST_CASE(WrappedLine)
+{
+    // the line (after a prompt of 5 columns) takes three rows of 10 columns
+    stringstream oss;
+    Terminal terminal(oss);
+    terminal.Layout(10, 5);
+    Type(terminal, oss, "0123456789abcdefghij");
+    // backspaces can't go to the previous row: the cursor goes up
+    BOOST_CHECK_EQUAL(Press(terminal, oss, KeyType::home), "\x1B[2A");
+    BOOST_CHECK_EQUAL(Press(terminal, oss, KeyType::end), "0123456789abcdefghij");
+    // the char written in the last column moves the cursor to the next row
+    BOOST_CHECK_EQUAL(Type(terminal, oss, "klmno"), "k" "l" "m" "n" "o \b");
+    // back to the previous row, clear the last char, and back again
+    BOOST_CHECK_EQUAL(Press(terminal, oss, KeyType::backspace), "\x1B[1A\x1B[9C  \b\x1B[1A\x1B[9C");
+    BOOST_CHECK_EQUAL(terminal.GetLine(), "0123456789abcdefghijklmn");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
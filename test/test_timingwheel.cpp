@@ -0,0 +1,122 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2020 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <vector>
+#include "cli/detail/timingwheel.h"
+#include "cli/detail/timerservice.h"
+
+using namespace std;
+using namespace cli::detail;
+
+BOOST_AUTO_TEST_SUITE(TimingWheelSuite)
+
+BOOST_AUTO_TEST_CASE(ExactTicks)
+{
+    TimingWheel wheel;
+    vector<pair<uint64_t, uint64_t>> fired; // (expected, actual)
+    // delays in all the wheels, and on the borders between them
+    const vector<uint64_t> delays{1, 2, 255, 256, 257, 1000, 65535, 65536, 65537, 70000, 16777216 + 3};
+    for (auto d: delays)
+        wheel.Add(d, [&wheel, &fired, d](){ fired.emplace_back(d, wheel.Now()); });
+    BOOST_CHECK_EQUAL(wheel.Size(), delays.size());
+
+    wheel.Advance(16777216 + 10);
+    BOOST_CHECK_EQUAL(wheel.Size(), 0u);
+    BOOST_REQUIRE_EQUAL(fired.size(), delays.size());
+    for (size_t i = 0; i < fired.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(fired[i].first, delays[i]); // in order
+        BOOST_CHECK_EQUAL(fired[i].second, delays[i]); // at their tick
+    }
+}
+
+BOOST_AUTO_TEST_CASE(StartAfterAdvance)
+{
+    // the timers are placed relative to the current tick
+    TimingWheel wheel;
+    wheel.Advance(300);
+    uint64_t firedAt = 0;
+    wheel.Add(65280, [&](){ firedAt = wheel.Now(); });
+    wheel.Advance(70000);
+    BOOST_CHECK_EQUAL(firedAt, 300u + 65280u);
+}
+
+BOOST_AUTO_TEST_CASE(Cancel)
+{
+    TimingWheel wheel;
+    int fired = 0;
+    const auto a = wheel.Add(10, [&](){ ++fired; });
+    const auto b = wheel.Add(1000, [&](){ ++fired; });
+    BOOST_CHECK(wheel.Cancel(b));
+    BOOST_CHECK(!wheel.Cancel(b));
+    BOOST_CHECK_EQUAL(wheel.Size(), 1u);
+    wheel.Advance(10);
+    BOOST_CHECK_EQUAL(fired, 1);
+    // the id of a fired timer is not valid, even if its node is reused
+    BOOST_CHECK(!wheel.Cancel(a));
+    const auto c = wheel.Add(5, [&](){ ++fired; });
+    BOOST_CHECK(c != a);
+    BOOST_CHECK(!wheel.Cancel(a));
+    BOOST_CHECK(wheel.Cancel(c));
+    wheel.Advance(2000);
+    BOOST_CHECK_EQUAL(fired, 1);
+}
+
+BOOST_AUTO_TEST_CASE(Rescheduling)
+{
+    // a callback can add a timer (e.g. a periodic one)
+    TimingWheel wheel;
+    vector<uint64_t> ticks;
+    function<void()> periodic = [&](){ ticks.push_back(wheel.Now()); if (ticks.size() < 4) wheel.Add(100, periodic); };
+    wheel.Add(100, periodic);
+    wheel.Advance(1000);
+    const vector<uint64_t> expected{100, 200, 300, 400};
+    BOOST_CHECK_EQUAL_COLLECTIONS(ticks.begin(), ticks.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(Service)
+{
+    boost::asio::io_context ios;
+    TimerService service(ios, chrono::milliseconds(5));
+    const auto start = chrono::steady_clock::now();
+    chrono::steady_clock::duration elapsed{};
+    bool cancelledFired = false;
+    service.Add(chrono::milliseconds(30), [&](){ elapsed = chrono::steady_clock::now() - start; });
+    const auto id = service.Add(chrono::milliseconds(20), [&](){ cancelledFired = true; });
+    BOOST_CHECK(service.Cancel(id));
+    // the loop ends when there are no more timers
+    ios.run();
+    BOOST_CHECK(elapsed >= chrono::milliseconds(30));
+    BOOST_CHECK(!cancelledFired);
+    BOOST_CHECK_EQUAL(service.Size(), 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()